@@ -0,0 +1,71 @@
+// Microbenchmark: tree-normal-form enumeration (tm_enum.h), resuming vs re-running from the blank tape
+
+// Enumerates every machine of a few sizes twice: children forking their
+// parent's copy-on-write snapshot, then every node re-simulated from step 0.
+// Checks that both give the same tree and the known busy beaver champions,
+// and reports steps simulated and time for each. (Step totals need not add
+// up exactly: a re-run can see a runaway at an earlier checkpoint than the
+// step its parent stopped at.)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "tm_enum.h"
+
+typedef struct {
+    int states, symbols;
+    uint64_t max_steps;        // Budget per machine (above the champion)
+    uint64_t steps, marks;     // Known champions: most steps, most marks
+} Size;
+
+static const Size sizes[] = {
+    {2, 2, 100, 6, 4},
+    {3, 2, 1000, 21, 6},
+    {2, 3, 1000, 38, 9},
+    {4, 2, 1000, 107, 13},
+};
+
+double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+double enumerate(TmEnum *en, const Size *s, int resume) {
+    Arena arena = {0};
+    tm_enum_init(en, &arena, s->states, s->symbols, s->max_steps);
+    en->resume = resume;
+    double start = now_seconds();
+    tm_enum_all(en);
+    double secs = now_seconds() - start;
+    arena_free_all(&arena);
+    return secs;
+}
+
+int main() {
+    long mismatches = 0;
+    printf("%-5s %-6s %10s %10s %10s %10s %14s %14s %9s %9s %10s %s\n", "Size", "Steps", "Nodes", "Halting",
+           "Runaway", "Undecided", "Steps (fork)", "Steps (blank)", "Fork s", "Blank s", "Pages cp", "Champions");
+    for (int i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++) {
+        const Size *s = &sizes[i];
+        TmEnum fork, blank;
+        double fork_secs = enumerate(&fork, s, 1);
+        double blank_secs = enumerate(&blank, s, 0);
+        int same = fork.nodes == blank.nodes && fork.halting == blank.halting && fork.undecided == blank.undecided &&
+                   fork.never_halts == blank.never_halts &&
+                   fork.best_steps == blank.best_steps && fork.best_marks == blank.best_marks &&
+                   fork.steps_run <= blank.steps_run;
+        int known = fork.best_steps == s->steps && fork.best_marks == s->marks;
+        mismatches += !same + !known;
+        printf("%dx%-3d %-6llu %10llu %10llu %10llu %10llu %14llu %14llu %9.3f %9.3f %10llu %llu/%llu %s\n", s->states,
+               s->symbols, (unsigned long long)s->max_steps, (unsigned long long)fork.nodes,
+               (unsigned long long)fork.halting, (unsigned long long)fork.never_halts, (unsigned long long)fork.undecided,
+               (unsigned long long)fork.steps_run, (unsigned long long)blank.steps_run, fork_secs, blank_secs,
+               (unsigned long long)fork.pages_copied, (unsigned long long)fork.best_steps,
+               (unsigned long long)fork.best_marks, same && known ? "yes" : "NO");
+    }
+    printf("Mismatches: %ld\n", mismatches);
+    return mismatches != 0;
+}
@@ -0,0 +1,147 @@
+// Microbenchmark: exponent-notation tape (tm_exptape.h) vs the tm_core.h kernels
+
+// Checks that random machines which halt under the plain kernel halt after
+// the same number of steps, in the same state and with the same number of
+// marks under the exponent tape (and that none it proves infinite halts),
+// then runs busy beaver champions: the plain kernel where it can finish, the
+// exponent tape on all of them.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "tm_exptape.h"
+
+// Configuration
+#define CHECK_MACHINES 20000  // Random machines in the agreement check
+#define CHECK_STEPS 50000     // Plain-kernel budget per checked machine
+#define PLAIN_MAX_STEPS 1000000000ULL // Champions the plain kernel runs (by expected steps)
+#define MACRO_STEPS 100000000 // Macro-step budget per champion
+
+typedef struct {
+    const char *name;
+    const char *table;        // Standard text: per state, per symbol "1RB" (Z halts), states split by "_"
+    const char *steps, *marks; // Known results
+    uint64_t plain_steps;     // Steps if small enough for the plain kernel, else 0
+    int block;                // Macro cell size for the exponent tape
+} Champion;
+
+static const Champion champions[] = {
+    {"BB(2)", "1RB1LB_1LA1RZ", "6", "4", 6, 1},
+    {"BB(3)", "1RB1RZ_1LB0RC_1LC1LA", "21", "5", 21, 1},
+    {"BB(4)", "1RB1LB_1LA0LC_1RZ1LD_1RD0RA", "107", "13", 107, 1},
+    {"BB(5)", "1RB1LC_1RC1RB_1RD0LE_1LA1LD_1RZ0LA", "47176870", "4098", 47176870, 3},
+    {"BB(2,4)", "1RB2LA1RA1RA_1LB1LA3RB1RZ", "3932964", "2050", 3932964, 1},
+    {"3x3 (2007)", "1RB2RA2RC_1LC1RZ1LA_1RA2LB1LC", "310341163", "36089", 310341163, 2},
+};
+
+double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Set up a blank-tape machine from the standard text; returns 0 if malformed
+int parse_table(TmMachine *m, Arena *arena, const char *table) {
+    int states = 1, symbols = 0;
+    for (const char *p = table; *p && *p != '_'; p += 3) symbols++;
+    for (const char *p = table; *p; p++) states += *p == '_';
+    tm_init(m, arena, states, symbols, 0, 0);
+    const char *p = table;
+    for (int state = 0; state < states; state++) {
+        for (int sym = 0; sym < symbols; sym++, p += 3) {
+            if (strlen(p) < 3 || p[0] < '0' || p[0] >= '0' + symbols || (p[1] != 'L' && p[1] != 'R')) return 0;
+            int next = (p[2] == 'Z' || p[2] == 'H') ? states : p[2] - 'A';
+            if (next < 0 || next > states) return 0;
+            tm_set_rule(m, state, sym, p[0] - '0', p[1] == 'R' ? 1 : -1, next);
+        }
+        if (*p == '_') p++;
+    }
+    return 1;
+}
+
+// Random machine with some random tape around the head
+void random_machine(TmMachine *m, Arena *arena) {
+    int states = 1 + rand() % 5, symbols = 2 + rand() % 2;
+    tm_init(m, arena, states, symbols, 0, 0);
+    for (int state = 0; state < states; state++) {
+        for (int sym = 0; sym < symbols; sym++) {
+            tm_set_rule(m, state, sym, rand() % symbols, rand() % 3 - 1, rand() % (states + 1));
+        }
+    }
+    for (int64_t p = -4; p <= 4; p++) {
+        if (rand() % 2) tm_write(m, p, rand() % symbols);
+    }
+}
+
+// Marks on a plain tape
+uint64_t plain_marks(const TmMachine *m) {
+    uint64_t marks = 0;
+    for (uint32_t i = 0; i < m->length; i++) marks += m->cells[i] != 0;
+    return marks;
+}
+
+// Halting machines against the plain kernel; returns mismatches, counts infinite proofs
+long check_machines(long *infinite) {
+    long mismatches = 0;
+    for (int i = 0; i < CHECK_MACHINES; i++) {
+        Arena arena = {0};
+        TmMachine m;
+        TmExpTape e;
+        random_machine(&m, &arena);
+        tm_exp_init(&e, &m, 1 + rand() % 3);
+        tm_run(&m, CHECK_STEPS);
+        tm_exp_run(&e, CHECK_STEPS);
+        *infinite += e.infinite;
+        if (e.infinite && m.halted) mismatches++;
+        if (m.halted) {
+            TmBig marks = tm_exp_marks(&e);
+            mismatches += !(e.halted && tm_big_is(&e.steps, m.steps) && e.state >> 1 == m.state &&
+                            tm_big_is(&marks, plain_marks(&m)));
+        }
+        tm_exp_free(&e);
+        arena_free_all(&arena);
+    }
+    return mismatches;
+}
+
+int main() {
+    srand(12345); // Fixed seed so runs are comparable
+    long infinite = 0;
+    long mismatches = check_machines(&infinite);
+    printf("%-12s %-18s %-10s %10s %10s %10s %8s %s\n", "Machine", "Steps", "Marks", "Plain s", "Exp s",
+           "Macro", "Rules", "Known");
+    for (int i = 0; i < (int)(sizeof(champions) / sizeof(champions[0])); i++) {
+        const Champion *c = &champions[i];
+        Arena arena = {0};
+        TmMachine m;
+        TmExpTape e;
+        char steps[TM_BIG_DIGITS], marks[TM_BIG_DIGITS], plain[16] = "-";
+        if (!parse_table(&m, &arena, c->table)) {
+            printf("%s: malformed table\n", c->name);
+            return 1;
+        }
+        tm_exp_init(&e, &m, c->block);
+        double start = now_seconds();
+        tm_exp_run(&e, MACRO_STEPS);
+        double exp = now_seconds() - start;
+        tm_big_format(steps, e.steps);
+        tm_big_format(marks, tm_exp_marks(&e));
+        if (c->plain_steps && c->plain_steps <= PLAIN_MAX_STEPS) {
+            start = now_seconds();
+            tm_kernel(&m)(&m, UINT64_MAX);
+            sprintf(plain, "%.4f", now_seconds() - start);
+            if (!tm_big_is(&e.steps, m.steps)) mismatches++;
+        }
+        int known = e.halted && strcmp(steps, c->steps) == 0 && strcmp(marks, c->marks) == 0;
+        printf("%-12s %-18s %-10s %10s %10.4f %10llu %8llu %s\n", c->name, steps, marks, plain, exp,
+               (unsigned long long)e.macro_steps, (unsigned long long)e.rules_proven, known ? "yes" : "NO");
+        mismatches += !known;
+        tm_exp_free(&e);
+        arena_free_all(&arena);
+    }
+    printf("Random machines: %d checked, %ld proven infinite\n", CHECK_MACHINES, infinite);
+    printf("Mismatches: %ld\n", mismatches);
+    return mismatches != 0;
+}
@@ -0,0 +1,118 @@
+// Microbenchmark: hashlife engine (tm_hashlife.h) vs the tm_core.h kernels
+
+// Checks that random machines which halt under the plain kernel halt after
+// the same number of steps with the same tape, head and state under the
+// memoized engine (and that no machine it calls a loop halts), then runs a
+// binary counter between two end markers: the plain kernel at widths it can
+// finish, the memoized engine at widths it never could.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "tm_hashlife.h"
+
+// Configuration
+#define CHECK_MACHINES 20000  // Random machines in the agreement check
+#define CHECK_STEPS 20000     // Plain-kernel budget per checked machine
+#define PLAIN_MAX_WIDTH 24    // Widest counter the plain kernel runs
+#define COUNTER_WIDTHS {8, 16, 20, 24, 32, 40, 48}
+
+double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Random machine with some random tape around the head
+void random_machine(TmMachine *m, Arena *arena) {
+    int states = 1 + rand() % 5, symbols = 2 + rand() % 2;
+    tm_init(m, arena, states, symbols, rand() % 64 - 32, 0);
+    for (int state = 0; state < states; state++) {
+        for (int sym = 0; sym < symbols; sym++) {
+            tm_set_rule(m, state, sym, rand() % symbols, rand() % 3 - 1, rand() % (states + 1));
+        }
+    }
+    for (int64_t p = m->position - 4; p <= m->position + 4; p++) {
+        if (rand() % 2) tm_write(m, p, rand() % symbols);
+    }
+}
+
+// Halting machines against the plain kernel; returns mismatches, counts loops called
+long check_machines(long *loops) {
+    long mismatches = 0;
+    for (int i = 0; i < CHECK_MACHINES; i++) {
+        Arena arena = {0};
+        TmMachine m;
+        TmHashlife h;
+        random_machine(&m, &arena);
+        tm_hl_init(&h, &m, 4096); // Small memo so flushes are exercised too
+        tm_run(&m, CHECK_STEPS);
+        tm_hl_run_until(&h, CHECK_STEPS * 16); // Growing machines never stop by themselves
+        *loops += h.looping;
+        if (h.looping && m.halted) mismatches++;
+        if (m.halted) {
+            int same = h.halted && h.steps == m.steps && h.state == m.state && h.position == m.position;
+            for (int64_t p = m.origin; same && p < m.origin + (int64_t)m.length; p++) {
+                same = tm_hl_read(&h, p) == tm_read(&m, p);
+            }
+            mismatches += !same;
+        }
+        tm_hl_free(&h);
+        arena_free_all(&arena);
+    }
+    return mismatches;
+}
+
+// Binary counter: markers (2) at 0 and width + 1, bits between them, low bit
+// first; state 0 adds one at the low end and halts when the carry reaches the
+// right marker, state 1 walks back to the left marker. With the low end at the
+// tree's origin, the low k bits and the marker share a node, and every node's
+// 2^k increments are one memoized run.
+void counter_machine(TmMachine *m, Arena *arena, int width) {
+    tm_init(m, arena, 2, 3, 0, 1);
+    tm_set_rule(m, 0, 0, 1, -1, 1); // 0 + carry: 1, done, walk back
+    tm_set_rule(m, 0, 1, 0, 1, 0);  // 1 + carry: 0, carry on right
+    tm_set_rule(m, 0, 2, 2, 0, 2);  // Carry out of the top bit: halt
+    tm_set_rule(m, 1, 0, 0, -1, 1);
+    tm_set_rule(m, 1, 1, 1, -1, 1);
+    tm_set_rule(m, 1, 2, 2, 1, 0);  // Left marker: add the next one
+    tm_write(m, 0, 2);
+    tm_write(m, width + 1, 2);
+}
+
+int main() {
+    srand(12345); // Fixed seed so runs are comparable
+    long loops = 0;
+    long mismatches = check_machines(&loops);
+    static const int widths[] = COUNTER_WIDTHS;
+    printf("Binary counter to overflow (2 states, 3 symbols)\n");
+    printf("%-6s %-22s %10s %10s %12s %10s %8s\n", "Width", "Steps", "Plain s", "Memo s", "Hits/lookups", "Nodes", "Marks");
+    for (int i = 0; i < (int)(sizeof(widths) / sizeof(widths[0])); i++) {
+        Arena arena = {0};
+        TmMachine m;
+        TmHashlife h;
+        char steps[40], plain[16] = "-";
+        counter_machine(&m, &arena, widths[i]);
+        tm_hl_init(&h, &m, 0);
+        double start = now_seconds();
+        tm_hl_run_until(&h, 0);
+        double memo = now_seconds() - start;
+        if (widths[i] <= PLAIN_MAX_WIDTH) {
+            start = now_seconds();
+            tm_run_s3(&m, UINT64_MAX);
+            sprintf(plain, "%.4f", now_seconds() - start);
+            if (!m.halted || m.steps != h.steps) mismatches++;
+        }
+        printf("%-6d %-22s %10s %10.4f %11.1f%% %10u %8llu\n", widths[i], tm_hl_format_steps(steps, h.steps),
+               plain, memo, h.lookups ? 100.0 * h.hits / h.lookups : 0.0, h.num_nodes,
+               (unsigned long long)tm_hl_marks(&h));
+        if (!h.halted) mismatches++;
+        tm_hl_free(&h);
+        arena_free_all(&arena);
+    }
+    printf("Random machines: %d checked, %ld called loops\n", CHECK_MACHINES, loops);
+    printf("Mismatches with the plain kernel: %ld\n", mismatches);
+    return mismatches != 0;
+}
@@ -0,0 +1,156 @@
+// Microbenchmark: window rescan vs packed shift-register loop detection
+
+// Replays the same symbol/state streams through the old detect_loop()/check_loop()
+// rescan and through the packed histories now used by the ITTM programs,
+// checks that every verdict agrees, and reports the cost per step.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+// Configuration: matches the ITTM programs' loop detection
+#define MACHINES 32
+#define WINDOW 20
+#define STATE_BITS 2
+#define BENCH_STEPS 200000  // Steps per machine (all past the loop-detection threshold)
+#define BENCH_ROUNDS 5      // Repetitions, best time is reported
+
+// Streams fed to both detectors: a read/write bit and a state per step
+uint8_t sym_stream[MACHINES][BENCH_STEPS];
+uint8_t state_stream[MACHINES][BENCH_STEPS];
+uint8_t verdict_scan[MACHINES][BENCH_STEPS];
+uint8_t verdict_packed[MACHINES][BENCH_STEPS];
+
+// Fill streams with a mix of noise and short periodic runs so both verdicts occur
+void fill_streams() {
+    for (int m = 0; m < MACHINES; m++) {
+        int period = 0, left = 0;
+        uint8_t pattern_sym[WINDOW], pattern_state[WINDOW];
+        for (int t = 0; t < BENCH_STEPS; t++) {
+            if (left == 0) {
+                period = (rand() % 4 == 0) ? 1 + rand() % (WINDOW / 2 + 2) : 0;
+                left = 1 + rand() % 64;
+                for (int i = 0; i < WINDOW; i++) {
+                    pattern_sym[i] = rand() % 2;
+                    pattern_state[i] = rand() % 3;
+                }
+            }
+            if (period) {
+                sym_stream[m][t] = pattern_sym[t % period];
+                state_stream[m][t] = pattern_state[t % period];
+            } else {
+                sym_stream[m][t] = rand() % 2;
+                state_stream[m][t] = rand() % 3;
+            }
+            left--;
+        }
+    }
+}
+
+// Reference: rescan both circular windows for every period (pre-change code)
+int check_loop_scan(uint8_t sim_tape[WINDOW], uint8_t state_window[WINDOW], uint32_t personal_step) {
+    for (int period = 1; period <= WINDOW / 2; period++) {
+        {
+            int match = 1;
+            for (int i = 0; i < period; i++) {
+                int idx1 = (personal_step - i - 1) % WINDOW;
+                int idx2 = (personal_step - i - 1 - period) % WINDOW;
+                if (sim_tape[idx1] != sim_tape[idx2]) {
+                    match = 0;
+                    break;
+                }
+            }
+            if (match) return 1;
+        }
+        {
+            int match = 1;
+            for (int i = 0; i < period; i++) {
+                int idx1 = (personal_step - i - 1) % WINDOW;
+                int idx2 = (personal_step - i - 1 - period) % WINDOW;
+                if (state_window[idx1] != state_window[idx2]) {
+                    match = 0;
+                    break;
+                }
+            }
+            if (match) return 1;
+        }
+    }
+    return 0;
+}
+
+// Packed: one xor and mask per period over the shift registers
+int check_loop_packed(uint32_t syms, uint64_t states) {
+    for (int period = 1; period <= WINDOW / 2; period++) {
+        uint32_t sym_mask = (1u << period) - 1;
+        if (((syms ^ (syms >> period)) & sym_mask) == 0) return 1;
+        int shift = period * STATE_BITS;
+        uint64_t state_mask = (1ULL << shift) - 1;
+        if (((states ^ (states >> shift)) & state_mask) == 0) return 1;
+    }
+    return 0;
+}
+
+double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+double run_scan() {
+    double start = now_seconds();
+    for (int m = 0; m < MACHINES; m++) {
+        uint8_t sim_tape[WINDOW] = {0};
+        uint8_t state_window[WINDOW] = {0};
+        for (uint32_t step = 1; step <= BENCH_STEPS; step++) {
+            uint32_t idx = (step - 1) % WINDOW;
+            sim_tape[idx] = sym_stream[m][step - 1];
+            state_window[idx] = state_stream[m][step - 1];
+            verdict_scan[m][step - 1] = check_loop_scan(sim_tape, state_window, step + WINDOW);
+        }
+    }
+    return now_seconds() - start;
+}
+
+double run_packed() {
+    double start = now_seconds();
+    for (int m = 0; m < MACHINES; m++) {
+        uint32_t syms = 0;
+        uint64_t states = 0;
+        for (uint32_t step = 1; step <= BENCH_STEPS; step++) {
+            syms = (syms << 1) | sym_stream[m][step - 1];
+            states = (states << STATE_BITS) | state_stream[m][step - 1];
+            verdict_packed[m][step - 1] = check_loop_packed(syms, states);
+        }
+    }
+    return now_seconds() - start;
+}
+
+int main() {
+    srand(12345); // Fixed seed so runs are comparable
+    fill_streams();
+    double best_scan = 1e30, best_packed = 1e30;
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        double t = run_scan();
+        if (t < best_scan) best_scan = t;
+        t = run_packed();
+        if (t < best_packed) best_packed = t;
+    }
+    // Every verdict must agree (the scan is offset by WINDOW so indices line up with step 1)
+    long mismatches = 0, loops = 0;
+    for (int m = 0; m < MACHINES; m++) {
+        for (int t = 0; t < BENCH_STEPS; t++) {
+            if (verdict_scan[m][t] != verdict_packed[m][t]) mismatches++;
+            loops += verdict_packed[m][t];
+        }
+    }
+    double steps = (double)MACHINES * BENCH_STEPS;
+    printf("Steps checked: %.0f (%ld flagged as loops)\n", steps, loops);
+    printf("%-8s %10s %12s\n", "Method", "Seconds", "ns/step");
+    printf("%-8s %10.4f %12.2f\n", "scan", best_scan, best_scan * 1e9 / steps);
+    printf("%-8s %10.4f %12.2f\n", "packed", best_packed, best_packed * 1e9 / steps);
+    printf("Speedup: %.1fx\n", best_scan / best_packed);
+    printf("Verdict mismatches: %ld\n", mismatches);
+    return mismatches != 0;
+}
@@ -0,0 +1,174 @@
+// Microbenchmark: k-tape engine (tm_multi.h) vs the single-tape kernels (tm_core.h)
+
+// Checks that the specialised k-tape kernels agree with single steps and
+// that a one-tape machine runs exactly like the same TmMachine, then times
+// random non-halting machines on one, two and three tapes (the last in the
+// ITTM input/scratch/output layout) against the single-tape kernel.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "tm_multi.h"
+
+// Configuration
+#define CHECK_MACHINES 2000   // Random machines per agreement check
+#define CHECK_STEPS 3000      // Steps per checked machine (at most)
+#define BENCH_STATES 8
+#define BENCH_STEPS 20000000  // Steps per timed run
+#define BENCH_ROUNDS 3        // Repetitions, best time is reported
+
+double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Random rules; with halting = 0 no rule reaches the halt state
+void random_multi(TmMultiMachine *m, int halting) {
+    int tuples = 1 << (m->num_tapes * m->bits);
+    for (int state = 0; state < m->num_states; state++) {
+        for (int tuple = 0; tuple < tuples; tuple++) {
+            int syms[TM_MAX_TAPES], write[TM_MAX_TAPES], move[TM_MAX_TAPES], valid = 1;
+            for (int t = 0; t < m->num_tapes; t++) {
+                syms[t] = (tuple >> ((m->num_tapes - 1 - t) * m->bits)) & ((1 << m->bits) - 1);
+                valid &= syms[t] < m->num_symbols;
+                write[t] = rand() % m->num_symbols;
+                move[t] = rand() % 3 - 1;
+            }
+            if (valid) tm_multi_set_rule(m, state, syms, write, move, rand() % (m->num_states + halting));
+        }
+    }
+}
+
+// Same state, heads and tape contents around the heads
+int multi_equal(const TmMultiMachine *a, const TmMultiMachine *b) {
+    if (a->state != b->state || a->halted != b->halted || a->steps != b->steps) return 0;
+    for (int t = 0; t < a->num_tapes; t++) {
+        const TmTape *x = &a->tapes[t], *y = &b->tapes[t];
+        if (x->position != y->position) return 0;
+        for (int64_t p = x->position - 200; p <= x->position + 200; p++) {
+            if (tm_tape_read(x, a->bits, p) != tm_tape_read(y, b->bits, p)) return 0;
+        }
+    }
+    return 1;
+}
+
+// Kernels against single steps, for every specialised shape and a generic one
+long check_kernels() {
+    static const int shapes[][2] = {{1, 2}, {2, 2}, {3, 2}, {2, 4}, {3, 3}, {2, 5}};
+    long mismatches = 0;
+    for (int s = 0; s < (int)(sizeof(shapes) / sizeof(shapes[0])); s++) {
+        for (int i = 0; i < CHECK_MACHINES; i++) {
+            Arena arena = {0};
+            TmMultiMachine a, b;
+            int states = 1 + rand() % 6;
+            tm_multi_init(&a, &arena, shapes[s][0], states, shapes[s][1], rand() % 64 - 32, 0);
+            a.left_bounded = (shapes[s][0] == 3 && shapes[s][1] == 2) ? rand() % 2 : 0;
+            random_multi(&a, 1);
+            b = a;
+            for (int t = 0; t < b.num_tapes; t++) { // Own copies of the (blank) tapes
+                b.tapes[t].words = arena_alloc(&arena, b.tapes[t].num_words * sizeof(uint64_t));
+            }
+            uint64_t steps = rand() % CHECK_STEPS;
+            tm_multi_run(&a, steps);
+            for (uint64_t n = 0; n < steps && !b.halted; n++) tm_multi_step(&b);
+            mismatches += !multi_equal(&a, &b);
+            arena_free_all(&arena);
+        }
+    }
+    return mismatches;
+}
+
+// One-tape machines against the same rules as a TmMachine
+long check_single_tape() {
+    long mismatches = 0;
+    for (int i = 0; i < CHECK_MACHINES; i++) {
+        Arena arena = {0};
+        TmMultiMachine a;
+        TmMachine b;
+        int states = 1 + rand() % 6, symbols = 2 + rand() % 2;
+        tm_multi_init(&a, &arena, 1, states, symbols, 0, 0);
+        tm_init(&b, &arena, states, symbols, 0, 0);
+        random_multi(&a, 1);
+        for (int state = 0; state < states; state++) {
+            for (int sym = 0; sym < symbols; sym++) {
+                const TmMultiRule *r = tm_multi_rule(&a, state, &sym);
+                tm_set_rule(&b, state, sym, r->write[0], r->move[0], r->next);
+            }
+        }
+        uint64_t steps = rand() % CHECK_STEPS;
+        tm_multi_run(&a, steps);
+        tm_kernel(&b)(&b, steps);
+        int same = a.state == b.state && a.halted == b.halted && a.steps == b.steps &&
+                   a.tapes[0].position == b.position;
+        for (int64_t p = b.position - 200; same && p <= b.position + 200; p++) {
+            same = tm_tape_read(&a.tapes[0], a.bits, p) == tm_read(&b, p);
+        }
+        mismatches += !same;
+        arena_free_all(&arena);
+    }
+    return mismatches;
+}
+
+// Best time for BENCH_STEPS steps of a random non-halting k-tape machine
+double time_multi(int tapes, int ittm) {
+    double best = 1e30;
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        Arena arena = {0};
+        TmMultiMachine m;
+        srand(100 + tapes);
+        if (ittm) tm_multi_init_ittm(&m, &arena, BENCH_STATES);
+        else tm_multi_init(&m, &arena, tapes, BENCH_STATES, 2, 0, 0);
+        random_multi(&m, 0);
+        double start = now_seconds();
+        tm_multi_run(&m, BENCH_STEPS);
+        double t = now_seconds() - start;
+        if (t < best) best = t;
+        arena_free_all(&arena);
+    }
+    return best;
+}
+
+// Best time for the same number of steps on the single-tape 2-symbol kernel
+double time_single() {
+    double best = 1e30;
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        Arena arena = {0};
+        TmMachine m;
+        srand(100);
+        tm_init(&m, &arena, BENCH_STATES, 2, 0, 0);
+        for (int state = 0; state < BENCH_STATES; state++) {
+            for (int sym = 0; sym < 2; sym++) {
+                tm_set_rule(&m, state, sym, rand() % 2, rand() % 3 - 1, rand() % BENCH_STATES);
+            }
+        }
+        double start = now_seconds();
+        tm_run_s2(&m, BENCH_STEPS);
+        double t = now_seconds() - start;
+        if (t < best) best = t;
+        arena_free_all(&arena);
+    }
+    return best;
+}
+
+int main() {
+    srand(12345); // Fixed seed so runs are comparable
+    long kernel_mismatches = check_kernels();
+    long single_mismatches = check_single_tape();
+    double single = time_single();
+    printf("Steps per run: %d (%d states, 2 symbols)\n", BENCH_STEPS, BENCH_STATES);
+    printf("%-16s %10s %12s %10s\n", "Engine", "Seconds", "ns/step", "vs 1-tape");
+    printf("%-16s %10.4f %12.2f %10.2fx\n", "single-tape", single, single * 1e9 / BENCH_STEPS, 1.0);
+    for (int tapes = 1; tapes <= 3; tapes++) {
+        int ittm = tapes == 3;
+        double t = time_multi(tapes, ittm);
+        char name[32];
+        sprintf(name, ittm ? "3-tape (ITTM)" : "%d-tape", tapes);
+        printf("%-16s %10.4f %12.2f %10.2fx\n", name, t, t * 1e9 / BENCH_STEPS, t / single);
+    }
+    printf("Kernel vs single-step mismatches: %ld\n", kernel_mismatches);
+    printf("One-tape vs TmMachine mismatches: %ld\n", single_mismatches);
+    return kernel_mismatches != 0 || single_mismatches != 0;
+}
@@ -0,0 +1,196 @@
+// Microbenchmark: the simulation server (tm_serve.h), per-run startup vs a warm server
+
+// A population of machines: a few rule tables (BB(4), the 2-state 4-symbol
+// champion, a 3-state 3-symbol halter, a binary counter that never halts),
+// each on many random short input tapes, run under exptape. Three ways:
+//   per run  a fresh server for every machine (start, one batch, stop), as
+//            when each machine is its own process with cold caches
+//   warm     one batch on one server: workers, arenas and macro tables
+//            carry over from machine to machine
+//   repeat   the same batch again: every machine is a decided one
+//   write 1st  the batch WRITE_FIRST_COPIES times over, all of it sent
+//            before any reply is read (as nc or a script would): the
+//            replies outgrow the socket buffers while the client still writes
+// The verdict lines of all of them must agree.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "tm_serve.h"
+
+// Configuration
+#define TAPES_PER_TABLE 100     // Random inputs per rule table
+#define TAPE_CELLS 12           // Cells of each input
+#define BENCH_WORKERS 4
+#define BENCH_BATCH "batch exptape=2 10000\n"
+#define BENCH_SOCKET "/tmp/bench_serve.sock"
+#define WRITE_FIRST_COPIES 50   // Copies of the population in the write-first batch
+
+static const char *tables[] = {
+    "1RB1LB_1LA0LC_1RZ1LD_1RD0RA",   // BB(4)
+    "1RB2LA1RA1RA_1LB1LA3RB1RZ",     // 2-state 4-symbol champion
+    "1RB2RA2RC_1LC1RZ1LA_1RA2LB1LC", // 3-state 3-symbol halter
+    "1RB0LA_1LA1RB",                 // Binary counter: never halts
+};
+#define NUM_TABLES (int)(sizeof(tables) / sizeof(tables[0]))
+#define NUM_MACHINES (NUM_TABLES * TAPES_PER_TABLE)
+
+char *machines[NUM_MACHINES]; // Each machine's text
+
+// A machine in the tm_read_text format from standard notation (rows split
+// by '_', "1RB" per entry, Z halts after writing), on a tape
+char *machine_text(const char *table, const uint8_t *tape) {
+    int symbols = (int)(strchr(table, '_') - table) / 3, states = (int)(strlen(table) + 1) / (3 * symbols + 1);
+    char *text = malloc(4096), *p = text;
+    p += sprintf(p, "machine %d %d\nstart 0 0\ntape 0", states, symbols);
+    for (int c = 0; c < TAPE_CELLS; c++) p += sprintf(p, " %d", tape[c] % symbols);
+    p += sprintf(p, "\n");
+    for (int s = 0; s < states; s++) {
+        for (int k = 0; k < symbols; k++) {
+            const char *e = table + s * (3 * symbols + 1) + 3 * k;
+            int next = e[2] == 'Z' ? states : e[2] - 'A';
+            p += sprintf(p, "rule %d %d %d %d %d\n", s, k, e[0] - '0', e[1] == 'L' ? -1 : 1, next);
+        }
+    }
+    sprintf(p, "end\n");
+    return text;
+}
+
+void *serve_thread(void *arg) {
+    tm_serve_run(arg);
+    return NULL;
+}
+
+typedef struct {
+    int fd, first, count;
+} Sender;
+
+void *send_batch(void *arg) {
+    Sender *snd = arg;
+    send(snd->fd, BENCH_BATCH, strlen(BENCH_BATCH), MSG_NOSIGNAL);
+    for (int i = snd->first; i < snd->first + snd->count; i++) send(snd->fd, machines[i], strlen(machines[i]), MSG_NOSIGNAL);
+    shutdown(snd->fd, SHUT_WR);
+    return NULL;
+}
+
+// Send machines first .. first + count - 1 as one batch; their lines go to
+// replies[first + INDEX] with the source dropped. Returns the database hits.
+int run_batch(int first, int count, char replies[][TM_SERVE_LINE]) {
+    int fd = tm_serve_connect(BENCH_SOCKET), hits = 0;
+    Sender snd = {fd, first, count};
+    pthread_t sender;
+    pthread_create(&sender, NULL, send_batch, &snd);
+    FILE *in = fdopen(fd, "r");
+    char line[TM_SERVE_LINE];
+    while (fgets(line, sizeof(line), in)) {
+        unsigned index;
+        if (sscanf(line, "verdict %u", &index) != 1 || index >= (unsigned)count) continue;
+        char *source = strrchr(line, ' ');
+        hits += strcmp(source, " db\n") == 0;
+        *source = '\0';
+        strcpy(replies[first + index], strchr(line + 8, ' ') + 1);
+    }
+    pthread_join(sender, NULL);
+    fclose(in);
+    return hits;
+}
+
+// Send every machine WRITE_FIRST_COPIES times, then read the replies; returns
+// the lines that disagree with expected (machine INDEX % NUM_MACHINES), and
+// NUM_MACHINES * WRITE_FIRST_COPIES if the batch never completes
+long run_write_first(char expected[][TM_SERVE_LINE], int *hits) {
+    int fd = tm_serve_connect(BENCH_SOCKET);
+    send(fd, BENCH_BATCH, strlen(BENCH_BATCH), MSG_NOSIGNAL);
+    for (int c = 0; c < WRITE_FIRST_COPIES; c++) {
+        for (int m = 0; m < NUM_MACHINES; m++) send(fd, machines[m], strlen(machines[m]), MSG_NOSIGNAL);
+    }
+    shutdown(fd, SHUT_WR);
+    FILE *in = fdopen(fd, "r");
+    char line[TM_SERVE_LINE];
+    long mismatches = 0, answered = 0;
+    int done = 0;
+    while (fgets(line, sizeof(line), in)) {
+        unsigned index;
+        done |= strncmp(line, "done ", 5) == 0;
+        if (sscanf(line, "verdict %u", &index) != 1) continue;
+        char *source = strrchr(line, ' ');
+        *hits += strcmp(source, " db\n") == 0;
+        *source = '\0';
+        mismatches += strcmp(expected[index % NUM_MACHINES], strchr(line + 8, ' ') + 1) != 0;
+        answered++;
+    }
+    fclose(in);
+    return done && answered == (long)NUM_MACHINES * WRITE_FIRST_COPIES ? mismatches : (long)NUM_MACHINES * WRITE_FIRST_COPIES;
+}
+
+// Stop a server started on serve_thread: set the flag, then wake accept() with a connection
+void stop_server(TmServer *s, pthread_t thread) {
+    s->stopping = 1;
+    close(tm_serve_connect(BENCH_SOCKET));
+    pthread_join(thread, NULL);
+    tm_serve_close(s);
+}
+
+int main() {
+    static char per_run[NUM_MACHINES][TM_SERVE_LINE], warm[NUM_MACHINES][TM_SERVE_LINE], repeat[NUM_MACHINES][TM_SERVE_LINE];
+    static TmServer server;
+    pthread_t thread;
+    srand(12345); // Fixed seed so runs are comparable
+    for (int t = 0; t < NUM_TABLES; t++) {
+        for (int i = 0; i < TAPES_PER_TABLE; i++) {
+            uint8_t tape[TAPE_CELLS];
+            for (int c = 0; c < TAPE_CELLS; c++) tape[c] = rand();
+            machines[t * TAPES_PER_TABLE + i] = machine_text(tables[t], tape);
+        }
+    }
+    setvbuf(stdout, NULL, _IONBF, 0);
+    int saved = dup(STDOUT_FILENO); // The server's per-batch lines go to /dev/null
+    freopen("/dev/null", "w", stdout);
+
+    double start = tm_serve_now();
+    for (int m = 0; m < NUM_MACHINES; m++) {
+        tm_serve_open(&server, BENCH_SOCKET, BENCH_WORKERS, NULL);
+        pthread_create(&thread, NULL, serve_thread, &server);
+        run_batch(m, 1, per_run);
+        stop_server(&server, thread);
+    }
+    double cold = tm_serve_now() - start;
+
+    tm_serve_open(&server, BENCH_SOCKET, BENCH_WORKERS, NULL);
+    pthread_create(&thread, NULL, serve_thread, &server);
+    start = tm_serve_now();
+    int warm_hits = run_batch(0, NUM_MACHINES, warm);
+    double warm_secs = tm_serve_now() - start;
+    start = tm_serve_now();
+    int repeat_hits = run_batch(0, NUM_MACHINES, repeat);
+    double repeat_secs = tm_serve_now() - start;
+    start = tm_serve_now();
+    int write_first_hits = 0;
+    long write_first_mismatches = run_write_first(per_run, &write_first_hits);
+    double write_first_secs = tm_serve_now() - start;
+    stop_server(&server, thread); // Workers joined: the counts are settled
+    uint64_t reuses = server.table_reuses;
+
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    long mismatches = write_first_mismatches;
+    int halted = 0, never = 0;
+    for (int m = 0; m < NUM_MACHINES; m++) {
+        mismatches += strcmp(per_run[m], warm[m]) != 0 || strcmp(per_run[m], repeat[m]) != 0;
+        halted += strncmp(per_run[m], "halted", 6) == 0;
+        never += strncmp(per_run[m], "never", 5) == 0;
+        free(machines[m]);
+    }
+    printf("%d machines (%d rule tables x %d tapes): %d halted, %d never halt, %d undecided (rerun every batch)\n",
+           NUM_MACHINES, NUM_TABLES, TAPES_PER_TABLE, halted, never, NUM_MACHINES - halted - never);
+    printf("%-10s %10s %14s %10s\n", "Mode", "Seconds", "Machines/s", "DB hits");
+    printf("%-10s %10.4f %14.0f %10d\n", "per run", cold, NUM_MACHINES / cold, 0);
+    printf("%-10s %10.4f %14.0f %10d\n", "warm", warm_secs, NUM_MACHINES / warm_secs, warm_hits);
+    printf("%-10s %10.4f %14.0f %10d\n", "repeat", repeat_secs, NUM_MACHINES / repeat_secs, repeat_hits);
+    printf("%-10s %10.4f %14.0f %10d  (%d machines)\n", "write 1st", write_first_secs,
+           NUM_MACHINES * WRITE_FIRST_COPIES / write_first_secs, write_first_hits, NUM_MACHINES * WRITE_FIRST_COPIES);
+    printf("Macro tables reused on the warm server: %llu\n", (unsigned long long)reuses);
+    printf("Mismatches: %ld\n", mismatches);
+    return mismatches != 0;
+}
@@ -0,0 +1,145 @@
+// Microbenchmark: sharded enumeration (tm_enum.h) and the merge of its result files (tm_results.h)
+
+// Enumerates a few sizes once whole and once as SHARDS child processes,
+// each taking every SHARDS-th node at the split depth (what ittm_dovetail
+// --enumerate --shard=I/N does), then merges the shard files. The merged
+// file must equal the whole run's byte for byte. Reports the whole run's
+// time, the slowest shard (the wall time with a CPU per shard), all shards
+// together (the nodes above the split depth are run by every shard), the
+// spread of nodes over the shards, file size and merge time.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "tm_results.h"
+
+// Configuration
+#define SHARDS 4
+#define SPLIT_DEPTH 3                      // As ittm_dovetail's default
+#define BENCH_FILE "/tmp/bench_shard"      // Files BENCH_FILE.res, BENCH_FILE_I.res, BENCH_FILE_merged.res
+
+typedef struct {
+    int states, symbols;
+    uint64_t max_steps;
+} Size;
+
+static const Size sizes[] = {
+    {3, 2, 1000},
+    {2, 3, 1000},
+    {4, 2, 300},
+};
+
+typedef struct {
+    double secs;
+    uint64_t records;
+    int ok;
+} ShardRun;
+
+double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void record_node(void *arg, const TmEnum *en, const TmEnumNode *n, int result) {
+    TmResRecord r;
+    tm_res_enum_record(en, n, result, &r);
+    tm_res_put(arg, &r, n);
+}
+
+// Enumerate shard of shards (0 of 1: the whole tree) into path
+ShardRun enumerate(const Size *s, uint32_t shard, uint32_t shards, const char *path) {
+    Arena arena = {0};
+    TmEnum en;
+    TmResWriter w;
+    ShardRun run = {0, 0, 0};
+    tm_enum_init(&en, &arena, s->states, s->symbols, s->max_steps);
+    en.shard = shard;
+    en.shards = shards;
+    en.split_depth = SPLIT_DEPTH;
+    TmResHeader h = {TM_RES_ENUMERATE, s->states, s->symbols, s->max_steps, 0, 0, shard, shards,
+                     shards > 1 ? SPLIT_DEPTH : 0};
+    if (!tm_res_create(&w, path, &h)) return run;
+    en.record = record_node;
+    en.record_arg = &w;
+    double start = now_seconds();
+    tm_enum_all(&en);
+    run.ok = tm_res_close(&w);
+    run.secs = now_seconds() - start;
+    run.records = w.counts.records;
+    arena_free_all(&arena);
+    return run;
+}
+
+// Whether two files hold the same bytes; *size gets the first one's size
+int same_file(const char *a, const char *b, long *size) {
+    FILE *fa = fopen(a, "rb"), *fb = fopen(b, "rb");
+    int same = fa && fb, ca, cb;
+    *size = 0;
+    while (same) {
+        ca = fgetc(fa);
+        cb = fgetc(fb);
+        same = ca == cb;
+        if (ca == EOF) break;
+        (*size)++;
+    }
+    if (fa) fclose(fa);
+    if (fb) fclose(fb);
+    return same;
+}
+
+int main() {
+    char paths[SHARDS][64], *shard_paths[SHARDS];
+    ShardRun *runs = mmap(NULL, SHARDS * sizeof(ShardRun), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    long mismatches = 0;
+    for (int i = 0; i < SHARDS; i++) {
+        sprintf(paths[i], BENCH_FILE "_%d.res", i);
+        shard_paths[i] = paths[i];
+    }
+    printf("%d shards split at depth %d\n", SHARDS, SPLIT_DEPTH);
+    printf("%-5s %-6s %10s %9s %9s %9s %16s %10s %8s %9s %s\n", "Size", "Steps", "Nodes", "Whole s", "Slowest s",
+           "Total s", "Nodes/shard", "File KiB", "B/node", "Merge s", "Identical");
+    for (int i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++) {
+        const Size *s = &sizes[i];
+        ShardRun whole = enumerate(s, 0, 1, BENCH_FILE ".res");
+        fflush(stdout);
+        for (int k = 0; k < SHARDS; k++) { // One at a time, so each shard's time is its own CPU's
+            if (fork() == 0) {
+                runs[k] = enumerate(s, k, SHARDS, paths[k]);
+                _exit(0);
+            }
+            wait(NULL);
+        }
+        double slowest = 0, total = 0;
+        uint64_t fewest = UINT64_MAX, most = 0;
+        int ok = whole.ok;
+        for (int k = 0; k < SHARDS; k++) {
+            ok &= runs[k].ok;
+            slowest = runs[k].secs > slowest ? runs[k].secs : slowest;
+            total += runs[k].secs;
+            fewest = runs[k].records < fewest ? runs[k].records : fewest;
+            most = runs[k].records > most ? runs[k].records : most;
+        }
+        double start = now_seconds();
+        ok &= tm_res_merge(BENCH_FILE "_merged.res", shard_paths, SHARDS);
+        double merge_secs = now_seconds() - start;
+        long size;
+        ok &= same_file(BENCH_FILE ".res", BENCH_FILE "_merged.res", &size);
+        mismatches += !ok;
+        char spread[32];
+        sprintf(spread, "%llu-%llu", (unsigned long long)fewest, (unsigned long long)most);
+        printf("%dx%-3d %-6llu %10llu %9.3f %9.3f %9.3f %16s %10.1f %8.1f %9.3f %s\n", s->states, s->symbols,
+               (unsigned long long)s->max_steps, (unsigned long long)whole.records, whole.secs, slowest, total, spread,
+               size / 1024.0, (double)size / whole.records, merge_secs, ok ? "yes" : "NO");
+    }
+    remove(BENCH_FILE ".res");
+    remove(BENCH_FILE "_merged.res");
+    for (int k = 0; k < SHARDS; k++) remove(paths[k]);
+    printf("Mismatches: %ld\n", mismatches);
+    return mismatches != 0;
+}
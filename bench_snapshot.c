@@ -0,0 +1,102 @@
+// Microbenchmark: tape snapshots (tm_snapshot.h) against the raw cells
+
+// Builds a large three-symbol tape (long runs, a patterned stretch and a
+// random one), saves it, and reports file size against one byte a cell,
+// save time, random windows checked against the tape, and a diff against a
+// copy with one cell changed: block hashes locate it without decoding the
+// rest, compared with decoding every block.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "tm_snapshot.h"
+
+// Configuration
+#define BENCH_CELLS (64u << 20) // Cells on the tape
+#define BENCH_ORIGIN (-1000003) // Position of the first cell (not block aligned)
+#define RANDOM_CELLS (1u << 20) // Cells of random symbols in the middle
+#define WINDOWS 10000           // Random windows read back
+#define WINDOW_CELLS 25         // The front-ends' display width
+#define BENCH_DIR "/tmp"
+
+double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Runs of random length for the first third, a short repeating pattern for
+// the next, random symbols, then blank with a marker every million cells
+void fill_tape(TmMachine *m) {
+    uint8_t *c = m->cells;
+    uint64_t third = BENCH_CELLS / 3, i = 0;
+    for (uint8_t symbol = 1; i < third; symbol = symbol % 2 + 1) {
+        for (uint64_t run = 1 + rand() % 4096; run && i < third; run--) c[i++] = symbol;
+    }
+    for (; i < 2 * third; i++) c[i] = "\1\0\2\1\1\0"[i % 6];
+    for (uint64_t r = 0; r < RANDOM_CELLS; r++, i++) c[i] = rand() % 3;
+    for (; i < BENCH_CELLS; i++) c[i] = i % 1000000 == 0 ? 2 : 0;
+}
+
+int main() {
+    Arena arena = {0};
+    TmMachine m;
+    TmSnapReader a, b;
+    long mismatches = 0;
+    srand(12345); // Fixed seed so runs are comparable
+    tm_init(&m, &arena, 1, 3, BENCH_ORIGIN + BENCH_CELLS / 2, 0);
+    tm_grow(&m, BENCH_ORIGIN);
+    tm_grow(&m, BENCH_ORIGIN + BENCH_CELLS - 1);
+    TmMachine tape = m; // The cells from BENCH_ORIGIN on, whatever the arena rounded to
+    tape.cells = m.cells + (BENCH_ORIGIN - m.origin);
+    tape.origin = BENCH_ORIGIN;
+    tape.length = BENCH_CELLS;
+    fill_tape(&tape);
+
+    double start = now_seconds();
+    int ok = tm_snap_save(BENCH_DIR "/bench_a.tmsnap", &tape);
+    double save = now_seconds() - start;
+    FILE *f = fopen(BENCH_DIR "/bench_a.tmsnap", "rb");
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fclose(f);
+    printf("%u cells: snapshot %ld bytes (%.2f%% of one byte a cell), saved in %.3f s\n", BENCH_CELLS, size,
+           100.0 * size / BENCH_CELLS, save);
+
+    ok = ok && tm_snap_open(&a, BENCH_DIR "/bench_a.tmsnap");
+    if (!ok) return 1;
+    uint8_t window[WINDOW_CELLS];
+    start = now_seconds();
+    for (int w = 0; w < WINDOWS; w++) {
+        int64_t pos = BENCH_ORIGIN - WINDOW_CELLS + (int64_t)(((uint64_t)rand() << 16 ^ rand()) % (BENCH_CELLS + WINDOW_CELLS));
+        tm_snap_window(&a, pos, WINDOW_CELLS, window);
+        for (int c = 0; c < WINDOW_CELLS; c++) mismatches += window[c] != tm_read(&tape, pos + c);
+    }
+    double windows = now_seconds() - start;
+    printf("%d random %d-cell windows in %.3f s (%.1f us each)\n", WINDOWS, WINDOW_CELLS, windows, windows * 1e6 / WINDOWS);
+
+    int64_t changed = BENCH_ORIGIN + BENCH_CELLS / 2 + 12345;
+    tape.cells[changed - BENCH_ORIGIN] = (tape.cells[changed - BENCH_ORIGIN] + 1) % 3;
+    tm_snap_save(BENCH_DIR "/bench_b.tmsnap", &tape);
+    tm_snap_open(&b, BENCH_DIR "/bench_b.tmsnap");
+    int64_t first = 0;
+    start = now_seconds();
+    int64_t blocks = tm_snap_diff(&a, &b, &first);
+    double diff = now_seconds() - start;
+    start = now_seconds();
+    for (uint64_t i = 0; i < a.num_blocks; i++) tm_snap_block(&a, i);
+    double decode = now_seconds() - start;
+    printf("Diff: %lld block differs, first at %lld (changed %lld) in %.4f s; decoding every block takes %.3f s\n",
+           (long long)blocks, (long long)first, (long long)changed, diff, decode);
+    mismatches += blocks != 1 || first != changed;
+
+    tm_snap_close_reader(&a);
+    tm_snap_close_reader(&b);
+    remove(BENCH_DIR "/bench_a.tmsnap");
+    remove(BENCH_DIR "/bench_b.tmsnap");
+    arena_free_all(&arena);
+    printf("Mismatches: %ld\n", mismatches);
+    return mismatches != 0;
+}
@@ -0,0 +1,125 @@
+// Microbenchmark: tape files (tm_map_tape) vs a "tape" line parsed by tm_read_text
+
+// Writes one random two-symbol tape as a tm_read_text machine, a raw file,
+// a bits file and an rle file, loads each, checks that all four give the
+// same cells, then runs a right-moving machine across the whole tape from
+// each. Reports load time, run time and that the raw file is unchanged
+// after the run (writes land in private copies of its pages).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "tm_core.h"
+
+// Configuration
+#define BENCH_CELLS (64u << 20) // Cells on the tape
+#define RUN_LENGTH 64           // Longest run of equal cells (mean half this)
+#define BENCH_DIR "/tmp"        // Where the tape files go
+
+double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Random runs of 0s and 1s, so rle has something to compress
+void fill_tape(uint8_t *cells) {
+    uint8_t symbol = 0;
+    for (uint64_t i = 0; i < BENCH_CELLS;) {
+        uint64_t run = 1 + rand() % RUN_LENGTH;
+        for (; run && i < BENCH_CELLS; run--) cells[i++] = symbol;
+        symbol ^= 1;
+    }
+}
+
+void write_files(const uint8_t *cells) {
+    FILE *f = fopen(BENCH_DIR "/bench_tape.tm", "w");
+    fprintf(f, "machine 1 2\nstart 0 0\ntape 0");
+    for (uint64_t i = 0; i < BENCH_CELLS; i++) fprintf(f, " %d", cells[i]);
+    fprintf(f, "\nend\n");
+    fclose(f);
+    f = fopen(BENCH_DIR "/bench_tape.raw", "wb");
+    fwrite(cells, 1, BENCH_CELLS, f);
+    fclose(f);
+    f = fopen(BENCH_DIR "/bench_tape.bits", "wb");
+    for (uint64_t i = 0; i < BENCH_CELLS; i += 8) {
+        uint8_t byte = 0;
+        for (int b = 0; b < 8; b++) byte |= cells[i + b] << b;
+        fputc(byte, f);
+    }
+    fclose(f);
+    f = fopen(BENCH_DIR "/bench_tape.rle", "wb");
+    for (uint64_t i = 0; i < BENCH_CELLS;) {
+        uint64_t run = 1;
+        while (i + run < BENCH_CELLS && cells[i + run] == cells[i]) run++;
+        fputc(cells[i], f);
+        tm_put_leb128(f, run);
+        i += run;
+    }
+    fclose(f);
+}
+
+// One state: flip every cell moving right (never halts; the run is cut at BENCH_CELLS steps)
+void flip_rules(TmMachine *m) {
+    tm_set_rule(m, 0, 0, 1, 1, 0);
+    tm_set_rule(m, 0, 1, 0, 1, 0);
+}
+
+int same_cells(const TmMachine *m, const uint8_t *cells) {
+    for (uint64_t i = 0; i < BENCH_CELLS; i++) {
+        if (tm_read(m, i) != cells[i]) return 0;
+    }
+    return 1;
+}
+
+int main() {
+    static const char *formats[] = {"text", "raw", "bits", "rle"};
+    uint8_t *cells = malloc(BENCH_CELLS);
+    long mismatches = 0;
+    srand(12345); // Fixed seed so runs are comparable
+    fill_tape(cells);
+    write_files(cells);
+    printf("%u cells\n", BENCH_CELLS);
+    printf("%-6s %10s %10s %8s\n", "Format", "Load s", "Run s", "Same");
+    for (int i = 0; i < 4; i++) {
+        Arena arena = {0};
+        TmMachine m;
+        int ok;
+        double start = now_seconds();
+        if (i == 0) {
+            FILE *f = fopen(BENCH_DIR "/bench_tape.tm", "r");
+            ok = tm_read_text(f, &m, &arena) == 1;
+            fclose(f);
+        } else {
+            char path[64];
+            sprintf(path, BENCH_DIR "/bench_tape.%s", formats[i]);
+            tm_init(&m, &arena, 1, 2, 0, 0);
+            ok = tm_map_tape(&m, path, tm_tape_format(formats[i]), 0);
+        }
+        double load = now_seconds() - start;
+        flip_rules(&m);
+        start = now_seconds();
+        tm_kernel(&m)(&m, BENCH_CELLS);
+        double run = now_seconds() - start;
+        int same = ok;
+        for (uint64_t c = 0; same && c < BENCH_CELLS; c++) same = tm_read(&m, c) == (cells[c] ^ 1);
+        mismatches += !same;
+        printf("%-6s %10.4f %10.4f %8s\n", formats[i], load, run, same ? "yes" : "NO");
+        tm_free_tape(&m);
+        arena_free_all(&arena);
+    }
+    // The raw file must not have seen the flips
+    TmMachine m;
+    Arena arena = {0};
+    tm_init(&m, &arena, 1, 2, 0, 0);
+    int unchanged = tm_map_tape(&m, BENCH_DIR "/bench_tape.raw", TM_TAPE_RAW, 0) && same_cells(&m, cells);
+    printf("Raw file unchanged after the run: %s\n", unchanged ? "yes" : "NO");
+    mismatches += !unchanged;
+    tm_free_tape(&m);
+    arena_free_all(&arena);
+    free(cells);
+    printf("Mismatches: %ld\n", mismatches);
+    return mismatches != 0;
+}
@@ -5,11 +5,18 @@
 // Tape 3: Simulation window for each machine
 // Tape 4: Bitmap for Halting set
 
+// Build: gcc -O2 -pthread ittm_champ_factorization.c -o ittm_champ_factorization
+
 #include <stdio.h>    
 #include <stdlib.h>   
 #include <stdint.h>   
 #include <string.h>   
 #include <time.h>     
+#include <pthread.h>
+#include <unistd.h>
+#include "tm_core.h"
+#include "tm_display.h"
+#include "tm_break.h"
 
 // Configuration: ITTM oracle, using prime factorization of Champernowne
 #define MACHINES 32    // Number of small Turing machines to simulate
@@ -17,30 +24,161 @@
 #define SYMBOLS 2      // Alphabet: 0, 1 (binary input for simulation)
 #define MAX_STEPS 5000  // Steps: small approximation of infinite time (ω) for interactive sim
 #define MAX_PERSONAL_STEPS 500  // Threshold for loop detection
+#define EXACT_MAX_STEPS ((STATES - 1) * INPUT_LEN + MACHINES) // Stage cap with --exact: every machine halts or repeats by then
 #define WINDOW 20      // Window size for loop detection
 #define INPUT_LEN 5733 // Champernowne prefix: 1 to 1000 (~5733 chars)
-#define MAX_PRIMES 25  // Primes
+#define DENSE_LIMIT (1ULL << 27) // Factor sieve range (covers every 8-digit number)
+#define SEG_BITS 16    // Factor sieve segment size 2^SEG_BITS
+#define SEG_MIN_NUMBERS 32 // Segments holding fewer numbers are factored one by one
+#define MAX_BASE_PRIMES 1500 // Room for the primes up to sqrt(DENSE_LIMIT)
+#define MAX_FACTOR_THREADS 64
+#define STATE_BITS 2   // Bits per state in the packed loop-detection history
+#define BLOCK_BITS 8   // Input symbols per block-table lookup (8 or 16)
+#define PARITY_PAD 64  // Parity bits repeated past INPUT_LEN so reads never wrap
+#define HIST_BUCKETS 9 // Halting-time histogram buckets: 1, 2, <=4, ..., <=128, >128
+#define RULE_DIGITS 4  // Digits per Champernowne number that picks a machine's rules
+#define MAX_PRIMES 25  // Primes counted for the rule templates
 #define RULES_WIDTH 26 // Fixed width for rules string alignment (adjusted for [0->1,1] [1->0,0] [2->0,0])
 
-// Machine structure: tracks state and position for each tiny TM
+// Recent history of a machine, for the window heuristic
 typedef struct {
-    uint8_t state;      // Current state (0–2: 0–1 flip, 2 halt)
-    uint32_t pos;       // Position on input tape (Tape 1)
-    uint8_t done;       // 1 if halted (state=2) or looped
-    uint32_t halt_step; // Step when halted or looped
-    uint32_t personal_step; // Personal step count per TM
-} Machine;
-
-// Global state: four tapes of the ITTM oracle
-Machine machines[MACHINES];           // Tape 2: array of machine states
+    uint32_t sym_history;   // Recent reads, one bit each, newest in bit 0
+    uint64_t state_history; // Recent states, STATE_BITS each, newest lowest
+} LoopHistory;
+
+// Tape 1, shared read-only by every machine of every run
 char input_tape[INPUT_LEN + 1];      // Tape 1: Champernowne prefix (string)
-uint8_t sim_tape[MACHINES][WINDOW];  // Tape 3: simulation window for each machine (reads)
-uint8_t state_window[MACHINES][WINDOW]; // Additional window for state history
-uint8_t halt_map[MACHINES / 8 + 1];  // Tape 4: bitmap for Halting set
-uint8_t rules[MACHINES][STATES][SYMBOLS]; // Rules: transitions for each machine
-char descriptions[MACHINES][30];     // Descriptions for each machine's rule behavior
 
-// First 25 primes < number 100 for factorization
+// Exact loop detection (--exact): machines never write, so (state, pos mod INPUT_LEN)
+// is the whole configuration and revisiting one proves the machine loops forever
+uint8_t exact_mode = 0;              // 1 when --exact replaces the window heuristic
+
+// Block engine (--engine=table): machines are DFAs over Tape 1's parities, so
+// the effect of BLOCK_BITS symbols from each state is precomputed per machine
+#define ENGINE_SCALAR 0
+#define ENGINE_TABLE 1
+#define ENGINE_LANES 2
+typedef struct {
+    uint8_t end_state;   // State after the block (2 if halted inside it)
+    uint8_t halted;      // 1 if the machine reached state 2 within the block
+    uint8_t halt_offset; // Symbols consumed up to and including the halting one
+} BlockEntry;
+
+uint8_t engine = ENGINE_SCALAR;
+uint8_t parity_bits[(INPUT_LEN + PARITY_PAD) / 8 + 1]; // Tape 1 parities, LSB first, wrapped past INPUT_LEN
+
+// Lane engine (--engine=simd): one vector lane per machine, so a stage of all
+// MACHINES machines is a few vector operations (GCC vector extensions; SSE2 by
+// default, wider registers with -march=native)
+typedef uint8_t lane8 __attribute__((vector_size(MACHINES)));
+typedef uint32_t lane32 __attribute__((vector_size(MACHINES * 4)));
+
+// Lazy Champernowne tape (--tape=lazy): digits of 0.123456789101112... are
+// computed on demand instead of read from the wrapped prefix in input_tape,
+// so positions are unbounded and never wrap
+typedef struct {
+    uint8_t digits[20]; // Decimal digits of the current number, most significant first
+    int len;            // Number of digits in the current number
+    int idx;            // Next digit of the current number to emit
+} ChampStream;
+
+uint8_t lazy_tape = 0;              // 1 when --tape=lazy replaces the wrapped prefix
+uint32_t stage_limit = 0;           // --stages=N; 0 keeps each mode's default
+
+// All-starts analysis (--all-starts): on a read-only tape the outcome from
+// (pos, state) is the outcome from (pos + 1, next state) plus one step, so a
+// single backward pass over one lap covers every start position
+typedef struct {
+    uint32_t steps; // Steps until halting, or until the end of the lap
+    uint8_t state;  // 2 if halted within the lap, else the state at the lap's end
+} LapOutcome;
+
+uint8_t all_starts = 0;                     // 1 when --all-starts replaces the simulation
+
+// Live display (--live[=FPS]): the scalar engine runs its stages without
+// pauses or per-step output while a display thread shows snapshots of
+// Tape 2/3/4 (tm_display.h)
+typedef struct {
+    uint8_t state;
+    uint8_t done;
+    uint32_t halt_step;
+    uint32_t personal_step;
+    uint64_t pos;
+    uint8_t window[WINDOW]; // Tape 3
+} MachineRow;
+
+double live_fps = 0; // Frames per second; 0 keeps the step-by-step view
+
+// Breakpoints (--break=SPEC, --run): stages between stops run without output
+Breakpoints break_specs; // As given; each run stops on its own copy
+
+// Deduplication: machines sharing a rule table share block tables and
+// all-starts results; machines that also share a start position follow the
+// same trajectory, so the scalar engine simulates the lowest-numbered one and
+// the others replay its recorded steps (read bit and next state per step).
+// The classes and traces are kept per run, in ChampRun below.
+
+// One run of the machines. Each is a TmMachine (tm_core.h) with states 0 and
+// 1, halt state 2 and two symbols, whose rules move right and write back the
+// symbol read. Tape 1 is shared and read-only, so a machine holds no cells:
+// it reads tape_parity() at its position, which counts up without wrapping.
+// Its step count is both its personal step and its halt step, and a machine
+// whose loop is detected is marked halted with its Tape 4 bit clear.
+// Everything a run changes lives here and in its arena, so runs can sit side
+// by side in one process.
+typedef struct {
+    int num_machines;
+    uint8_t exact;                       // --exact: loops must be proven
+    uint32_t stage_limit;                // --stages=N; 0 keeps each mode's default
+    Arena arena;                         // Rule tables
+    TmMachine tm[MACHINES];              // Tape 2: array of machine states
+    LoopHistory history[MACHINES];
+    uint8_t sim_tape[MACHINES][WINDOW];  // Tape 3: simulation window for each machine (reads)
+    uint8_t halt_map[MACHINES / 8 + 1];  // Tape 4: bitmap for Halting set
+    uint8_t visited[MACHINES][(STATES * INPUT_LEN + 7) / 8]; // --exact: seen configurations per machine
+    uint32_t heuristic_step[MACHINES];   // Step at which check_loop() first flagged a loop (0 = never)
+    uint32_t proof_step[MACHINES];       // Step at which a configuration repeated (0 = not proven)
+    BlockEntry block_tables[MACHINES][STATES][1 << BLOCK_BITS]; // --engine=table
+    int rule_class[MACHINES];            // Lowest-numbered machine with the same rules
+    int class_rep[MACHINES];             // Lowest-numbered machine with the same rules and start position
+    uint8_t *trace[MACHINES];            // Representative's steps: read | next << 1
+    uint32_t trace_cap[MACHINES];
+    ChampStream stream[MACHINES];        // --tape=lazy: each representative's position on Tape 1
+    Display display;                     // --live only
+    Breakpoints breaks;                  // --break, --run: where this run stops
+    int show_steps;                      // Print this stage's steps (off with --live and between stops)
+    char break_reason[80];               // First breakpoint hit this stage
+} ChampRun;
+
+// Next state of machine m in state s reading sym (0 in the halt state's row, which never runs)
+uint8_t rule_next(const ChampRun *run, int m, int s, int sym) {
+    return s < STATES - 1 ? tm_rule(&run->tm[m], s, sym)->next : 0;
+}
+
+// Factorization engine: exact distinct prime counts for batches of numbers
+// Numbers below DENSE_LIMIT are factored by a segmented sieve over the
+// segments they fall in; larger ones, and stragglers in sparse segments, by
+// trial division, Miller-Rabin and Pollard-Rho. Work is shared across threads.
+typedef struct {
+    const uint64_t *numbers; // Numbers to factor
+    uint8_t *omega;          // Out: distinct prime factors of each number (0 for 0 and 1)
+    size_t count;
+    uint32_t *order;         // Indices grouped by sieve segment, large numbers last
+    size_t *seg_start;       // Segment s owns order[seg_start[s] .. seg_start[s + 1])
+    size_t num_segments;
+    size_t next_segment;     // Work counters shared by the threads
+    size_t next_large;
+} FactorBatch;
+
+uint32_t base_primes[MAX_BASE_PRIMES]; // Primes up to sqrt(DENSE_LIMIT)
+int num_base_primes = 0;
+int factor_threads = 0;                // --threads=N; 0 uses every online CPU
+uint64_t population = 0;               // --population=N: factor N Champernowne numbers and exit
+uint8_t all_factors = 0;               // --all-factors: rule templates count every distinct prime
+int chunk_digits = 4;                  // --chunk=D: digits per Champernowne number
+
+// First 25 primes < number 100: by default a rule template counts only these
+// distinct primes (a cofactor above 97 is not counted), as it always has
 const uint32_t primes[MAX_PRIMES] = {
     2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53, 59, 61, 67, 71,
     73, 79, 83, 89, 97
@@ -63,92 +201,502 @@ void load_champernowne() {
     printf("Tape 1: Champernowne prefix = %.50s...\n", input_tape);
 }
 
-// Assign rules via prime factorization of Champernowne numbers (Tape 2)
-void assign_rules(int num_machines) {
-    // Parse Tape 1 to extract first num_machines numbers
-    int numbers[MACHINES]; // Array to store extracted numbers
-    int count = 0, pos = 0; // Track number count and tape position
-    char num_str[5] = {0}; // Buffer for building number strings (up to 4 digits)
-    int num_pos = 0; // Position in num_str
-    // Parse digits into numbers (e.g., "123" -> 1, 2, 3)
-    while (pos < INPUT_LEN && count < num_machines) {
-        if (input_tape[pos] >= '0' && input_tape[pos] <= '9') { // If digit
-            num_str[num_pos++] = input_tape[pos]; // Add to number string
-            // If 4 digits or end of tape, convert to number
-            if (num_pos == 4 || input_tape[pos + 1] == '\0') {
-                numbers[count++] = atoi(num_str); // Store number
-                num_pos = 0; // Reset buffer position
-                memset(num_str, 0, 5); // Clear buffer
+// Powers of ten that fit in 64 bits
+const uint64_t pow10_u64[20] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+    100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+    10000000000000ULL, 100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+    100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+};
+
+// Number of decimal digits of x (x >= 1)
+int decimal_len(uint64_t x) {
+    int d = 1;
+    while (d < 20 && x >= pow10_u64[d]) d++;
+    return d;
+}
+
+// Locate digit n (0-based) of Champernowne's constant, in O(log n): the
+// number it belongs to, that number's length, and the digit's index in it.
+// Numbers with d digits form a block of 9*10^(d-1)*d digits: skip whole
+// blocks, then the number and the digit within it follow by division.
+uint64_t champ_locate(uint64_t n, int *len, int *idx) {
+    uint64_t count = 9, first = 1; // Numbers in the block, and the block's first number
+    int d = 1;
+    while (n / d >= count) { // Written as a division so no block size overflows
+        n -= count * d;
+        count *= 10;
+        first *= 10;
+        d++;
+    }
+    *len = d;
+    *idx = n % d;
+    return first + n / d;
+}
+
+// Value of the width (1..19) digits of Champernowne's constant starting at
+// digit n, read as one decimal number (leading zeros drop out, as with atoi).
+// Pure arithmetic on the numbers the digits come from: no string is built,
+// and each call is independent, so any chunking can be computed in parallel.
+uint64_t champernowne_digits(uint64_t n, int width) {
+    int len, idx;
+    uint64_t number = champ_locate(n, &len, &idx);
+    int take = len - idx; // Digits left in the first number
+    if (take >= width) return number / pow10_u64[take - width] % pow10_u64[width];
+    uint64_t value = number % pow10_u64[take];
+    width -= take;
+    while (width > 0) { // Whole numbers, then a prefix of the last one
+        number++;
+        len = decimal_len(number);
+        take = len < width ? len : width;
+        value = value * pow10_u64[take] + number / pow10_u64[len - take];
+        width -= take;
+    }
+    return value;
+}
+
+// The k-th width-digit chunk of Champernowne's constant (k = 0: 1234, 5678, 9101, ...)
+uint64_t champernowne_chunk(uint64_t k, int width) {
+    return champernowne_digits(k * width, width);
+}
+
+// Position a stream at digit n (0-based) of Champernowne's constant, in O(log n)
+void champ_stream_seek(ChampStream *cs, uint64_t n) {
+    int d;
+    uint64_t number = champ_locate(n, &d, &cs->idx);
+    cs->len = d;
+    for (int i = d - 1; i >= 0; i--) {
+        cs->digits[i] = number % 10;
+        number /= 10;
+    }
+}
+
+// Next digit of the stream; moving to the next number is an in-place decimal increment
+uint8_t champ_stream_next(ChampStream *cs) {
+    uint8_t digit = cs->digits[cs->idx++];
+    if (cs->idx == cs->len) {
+        int i = cs->len - 1;
+        while (i >= 0 && cs->digits[i] == 9) cs->digits[i--] = 0;
+        if (i >= 0) {
+            cs->digits[i]++;
+        } else { // 99..9 -> 100..0
+            cs->digits[0] = 1;
+            cs->digits[cs->len++] = 0;
+        }
+        cs->idx = 0;
+    }
+    return digit;
+}
+
+// Parities of the next count (<= 64) digits, packed with the first in bit 0
+uint64_t champ_stream_parities(ChampStream *cs, int count) {
+    uint64_t bits = 0;
+    for (int i = 0; i < count; i++) {
+        bits |= (uint64_t)(champ_stream_next(cs) & 1) << i;
+    }
+    return bits;
+}
+
+// Digit n (0-based) of Champernowne's constant, for any 64-bit n
+uint8_t champernowne_digit(uint64_t n) {
+    ChampStream cs;
+    champ_stream_seek(&cs, n);
+    return cs.digits[cs.idx];
+}
+
+// Parity of Tape 1 at pos: the wrapped prefix, or the real constant with --tape=lazy
+uint8_t tape_parity(uint64_t pos) {
+    if (lazy_tape) return champernowne_digit(pos) % 2;
+    return (input_tape[pos % INPUT_LEN] - '0') % 2;
+}
+
+// Primes up to sqrt(DENSE_LIMIT), for the sieve and for trial division
+void init_base_primes() {
+    if (num_base_primes) return;
+    uint32_t limit = 1;
+    while ((uint64_t)limit * limit < DENSE_LIMIT) limit++;
+    uint8_t *composite = calloc(limit + 1, 1);
+    for (uint32_t i = 2; i <= limit; i++) {
+        if (composite[i]) continue;
+        base_primes[num_base_primes++] = i;
+        for (uint32_t j = i * i; j <= limit; j += i) composite[j] = 1;
+    }
+    free(composite);
+}
+
+uint64_t mul_mod(uint64_t a, uint64_t b, uint64_t n) {
+    return (unsigned __int128)a * b % n;
+}
+
+uint64_t pow_mod(uint64_t a, uint64_t e, uint64_t n) {
+    uint64_t r = 1;
+    a %= n;
+    while (e) {
+        if (e & 1) r = mul_mod(r, a, n);
+        a = mul_mod(a, a, n);
+        e >>= 1;
+    }
+    return r;
+}
+
+// Deterministic Miller-Rabin for 64-bit n (these bases cover every n < 2^64)
+int is_prime_u64(uint64_t n) {
+    static const uint64_t bases[12] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+    if (n < 2) return 0;
+    for (int i = 0; i < 12; i++) {
+        if (n % bases[i] == 0) return n == bases[i];
+    }
+    uint64_t d = n - 1;
+    int r = 0;
+    while (!(d & 1)) {
+        d >>= 1;
+        r++;
+    }
+    for (int i = 0; i < 12; i++) {
+        uint64_t x = pow_mod(bases[i], d, n);
+        if (x == 1 || x == n - 1) continue;
+        int witness = 1;
+        for (int j = 1; j < r && witness; j++) {
+            x = mul_mod(x, x, n);
+            if (x == n - 1) witness = 0;
+        }
+        if (witness) return 0;
+    }
+    return 1;
+}
+
+uint64_t gcd_u64(uint64_t a, uint64_t b) {
+    while (b) {
+        uint64_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+// A nontrivial factor of odd composite n (Pollard-Rho, Brent's variant)
+uint64_t pollard_rho(uint64_t n) {
+    for (uint64_t c = 1; ; c++) {
+        uint64_t y = 2, x = 2, q = 1, g = 1, ys = 2;
+        for (uint64_t r = 1; g == 1; r <<= 1) {
+            x = y;
+            for (uint64_t i = 0; i < r; i++) y = (mul_mod(y, y, n) + c) % n;
+            for (uint64_t k = 0; k < r && g == 1; k += 128) {
+                ys = y;
+                for (uint64_t i = 0; i < 128 && i < r - k; i++) {
+                    y = (mul_mod(y, y, n) + c) % n;
+                    q = mul_mod(q, x > y ? x - y : y - x, n);
+                }
+                g = gcd_u64(q, n);
+            }
+        }
+        if (g == n) { // Batched gcd overshot: step back one at a time
+            do {
+                ys = (mul_mod(ys, ys, n) + c) % n;
+                g = gcd_u64(x > ys ? x - ys : ys - x, n);
+            } while (g == 1);
+        }
+        if (g != n) return g;
+    }
+}
+
+// Add prime p with exponent e to a sorted factor list, merging repeats
+void add_factor(uint64_t *factors, uint8_t *exps, int *count, uint64_t p, int e) {
+    int i = *count;
+    for (int j = 0; j < *count; j++) {
+        if (factors[j] == p) {
+            exps[j] += e;
+            return;
+        }
+    }
+    while (i > 0 && factors[i - 1] > p) {
+        factors[i] = factors[i - 1];
+        exps[i] = exps[i - 1];
+        i--;
+    }
+    factors[i] = p;
+    exps[i] = e;
+    (*count)++;
+}
+
+// Split a cofactor with no prime factors below 1000 into primes
+void factor_large(uint64_t n, uint64_t *factors, uint8_t *exps, int *count) {
+    if (n == 1) return;
+    if (is_prime_u64(n)) {
+        add_factor(factors, exps, count, n, 1);
+        return;
+    }
+    uint64_t d = pollard_rho(n);
+    factor_large(d, factors, exps, count);
+    factor_large(n / d, factors, exps, count);
+}
+
+// Full factorization of n: distinct primes ascending with exponents; returns how many
+int factorize_u64(uint64_t n, uint64_t *factors, uint8_t *exps) {
+    int count = 0;
+    init_base_primes();
+    for (int i = 0; i < num_base_primes && n > 1; i++) {
+        uint64_t p = base_primes[i];
+        if (p > 1000) break; // Leave larger factors to Pollard-Rho
+        if (p * p > n) break;
+        int e = 0;
+        while (n % p == 0) {
+            n /= p;
+            e++;
+        }
+        if (e) add_factor(factors, exps, &count, p, e);
+    }
+    if (n > 1) factor_large(n, factors, exps, &count);
+    return count;
+}
+
+// Distinct prime factors of n, one at a time
+uint8_t omega_u64(uint64_t n) {
+    uint64_t factors[16];
+    uint8_t exps[16];
+    return n < 2 ? 0 : factorize_u64(n, factors, exps);
+}
+
+// Factor one sieve segment: every number in [lo, lo + 2^SEG_BITS) keeps a
+// cofactor that each base prime divides out, counting distinct primes; what
+// is left above 1 is one more prime
+void sieve_segment(FactorBatch *b, size_t s, uint32_t *rem, uint8_t *cnt) {
+    uint64_t lo = (uint64_t)s << SEG_BITS, hi = lo + (1u << SEG_BITS);
+    for (uint32_t i = 0; i < (1u << SEG_BITS); i++) {
+        rem[i] = lo + i;
+        cnt[i] = 0;
+    }
+    for (int k = 0; k < num_base_primes; k++) {
+        uint64_t p = base_primes[k];
+        if (p * p >= hi) break;
+        uint64_t first = (lo + p - 1) / p * p;
+        for (uint64_t j = first ? first : p; j < hi; j += p) { // Skip 0: it has no factorization
+            uint32_t i = j - lo;
+            cnt[i]++;
+            do rem[i] /= p; while (rem[i] % p == 0);
+        }
+    }
+    for (size_t k = b->seg_start[s]; k < b->seg_start[s + 1]; k++) {
+        uint32_t idx = b->order[k];
+        uint32_t i = b->numbers[idx] - lo;
+        b->omega[idx] = b->numbers[idx] < 2 ? 0 : cnt[i] + (rem[i] > 1);
+    }
+}
+
+// Worker: take sieve segments, then blocks of large numbers, until none are left
+void *factor_worker(void *arg) {
+    FactorBatch *b = arg;
+    uint32_t *rem = malloc(sizeof(uint32_t) << SEG_BITS);
+    uint8_t *cnt = malloc(1u << SEG_BITS);
+    for (;;) {
+        size_t s = __atomic_fetch_add(&b->next_segment, 1, __ATOMIC_RELAXED);
+        if (s >= b->num_segments) break;
+        size_t in_segment = b->seg_start[s + 1] - b->seg_start[s];
+        if (in_segment >= SEG_MIN_NUMBERS) {
+            sieve_segment(b, s, rem, cnt);
+        } else {
+            for (size_t k = b->seg_start[s]; k < b->seg_start[s + 1]; k++) {
+                b->omega[b->order[k]] = omega_u64(b->numbers[b->order[k]]);
             }
         }
-        pos++; // Move to next tape position
     }
+    size_t large_start = b->seg_start[b->num_segments];
+    for (;;) {
+        size_t k = large_start + __atomic_fetch_add(&b->next_large, 256, __ATOMIC_RELAXED);
+        if (k >= b->count) break;
+        for (size_t end = (k + 256 < b->count) ? k + 256 : b->count; k < end; k++) {
+            b->omega[b->order[k]] = omega_u64(b->numbers[b->order[k]]);
+        }
+    }
+    free(rem);
+    free(cnt);
+    return NULL;
+}
+
+// Exact distinct prime counts for count numbers, using up to threads threads
+void factorize_batch(const uint64_t *numbers, uint8_t *omega, size_t count, int threads) {
+    FactorBatch b = {numbers, omega, count, NULL, NULL, DENSE_LIMIT >> SEG_BITS, 0, 0};
+    init_base_primes();
+    // Counting sort by segment; numbers past DENSE_LIMIT go last
+    b.order = malloc(count * sizeof(uint32_t));
+    b.seg_start = calloc(b.num_segments + 2, sizeof(size_t));
+    for (size_t i = 0; i < count; i++) {
+        size_t s = numbers[i] < DENSE_LIMIT ? numbers[i] >> SEG_BITS : b.num_segments;
+        b.seg_start[s + 1]++;
+    }
+    for (size_t s = 0; s <= b.num_segments; s++) b.seg_start[s + 1] += b.seg_start[s];
+    size_t *fill = malloc((b.num_segments + 1) * sizeof(size_t));
+    memcpy(fill, b.seg_start, (b.num_segments + 1) * sizeof(size_t));
+    for (size_t i = 0; i < count; i++) {
+        size_t s = numbers[i] < DENSE_LIMIT ? numbers[i] >> SEG_BITS : b.num_segments;
+        b.order[fill[s]++] = i;
+    }
+    free(fill);
+    if (threads < 1) threads = 1;
+    if (threads > MAX_FACTOR_THREADS) threads = MAX_FACTOR_THREADS;
+    pthread_t workers[MAX_FACTOR_THREADS];
+    for (int t = 1; t < threads; t++) pthread_create(&workers[t], NULL, factor_worker, &b);
+    factor_worker(&b);
+    for (int t = 1; t < threads; t++) pthread_join(workers[t], NULL);
+    free(b.order);
+    free(b.seg_start);
+}
+
+// Thread count for factorize_batch: --threads=N, else every online CPU
+int batch_threads() {
+    if (factor_threads > 0) return factor_threads;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (int)cpus : 1;
+}
+
+// Rule template for a number from its distinct prime count (0 and 1 count as one factor)
+int rule_index(uint8_t omega) {
+    return (omega ? omega : 1) % 4; // 0,1: cycle-prone, 2: single_halt, 3: double_halt
+}
+
+// Distinct primes < 100 dividing n
+uint8_t small_omega(uint64_t n) {
+    uint8_t count = 0;
+    for (int k = 0; k < MAX_PRIMES && n > 1; k++) count += n % primes[k] == 0;
+    return count;
+}
+
+// Factorization string for display: prime^exp for the primes < 100, then the
+// cofactor they leave; returns how many distinct primes < 100 there are
+int format_factors(int num, char *factor_str) {
+    int factor_count = 0;
+    int factor_pos = 0; // Position in factor_str
+    int temp = num;
+    for (int k = 0; k < MAX_PRIMES && temp > 1; k++) {
+        int exp = 0;
+        while (temp % primes[k] == 0) {
+            exp++;
+            temp /= primes[k];
+        }
+        if (exp > 0) {
+            factor_count++;
+            char temp_str[32];
+            sprintf(temp_str, "%u^%d × ", primes[k], exp);
+            for (int c = 0; temp_str[c] && factor_pos < 49; c++) factor_str[factor_pos++] = temp_str[c];
+        }
+    }
+    if (temp > 1) { // Remaining factor (prime >97 or number itself)
+        char temp_str[16];
+        sprintf(temp_str, "%d", temp);
+        for (int c = 0; temp_str[c] && factor_pos < 49; c++) factor_str[factor_pos++] = temp_str[c];
+    } else if (factor_count == 0) { // Number 0 or 1
+        factor_pos = sprintf(factor_str, "%d", num);
+    } else if (factor_pos >= 3) { // Remove trailing " × "
+        factor_pos -= 3;
+    }
+    factor_str[factor_pos] = '\0';
+    return factor_count;
+}
+
+// Chunk extraction shared by threads: numbers[k] = chunk k, taken in blocks
+typedef struct {
+    uint64_t *numbers;
+    uint64_t count;
+    int width;
+    uint64_t next; // Work counter shared by the threads
+} ChunkFill;
+
+void *chunk_worker(void *arg) {
+    ChunkFill *f = arg;
+    for (;;) {
+        uint64_t k = __atomic_fetch_add(&f->next, 4096, __ATOMIC_RELAXED);
+        if (k >= f->count) break;
+        for (uint64_t end = (k + 4096 < f->count) ? k + 4096 : f->count; k < end; k++) {
+            f->numbers[k] = champernowne_chunk(k, f->width);
+        }
+    }
+    return NULL;
+}
+
+// Chunks 0..count-1 of the given width, using up to threads threads
+void fill_chunks(uint64_t *numbers, uint64_t count, int width, int threads) {
+    ChunkFill f = {numbers, count, width, 0};
+    if (threads < 1) threads = 1;
+    if (threads > MAX_FACTOR_THREADS) threads = MAX_FACTOR_THREADS;
+    pthread_t workers[MAX_FACTOR_THREADS];
+    for (int t = 1; t < threads; t++) pthread_create(&workers[t], NULL, chunk_worker, &f);
+    chunk_worker(&f);
+    for (int t = 1; t < threads; t++) pthread_join(workers[t], NULL);
+}
+
+// Factor the first population Champernowne numbers (chunk_digits digits each)
+// and report how the rule templates would be distributed
+void run_population() {
+    uint64_t *numbers = malloc(population * sizeof(uint64_t));
+    uint8_t *omega = malloc(population);
+    struct timespec t0, t1, t2;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    fill_chunks(numbers, population, chunk_digits, batch_threads());
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    factorize_batch(numbers, omega, population, batch_threads());
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+    double extract_secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+    double secs = (t2.tv_sec - t1.tv_sec) + (t2.tv_nsec - t1.tv_nsec) * 1e-9;
+    uint64_t by_omega[16] = {0}, by_rule[4] = {0};
+    for (uint64_t k = 0; k < population; k++) {
+        by_omega[omega[k]]++;
+        by_rule[rule_index(all_factors ? omega[k] : small_omega(numbers[k]))]++;
+    }
+    printf("Extracted %llu numbers (%d-digit chunks) in %.3f s, factored in %.3f s with %d threads\n",
+           (unsigned long long)population, chunk_digits, extract_secs, secs, batch_threads());
+    printf("%-16s %s\n", "Distinct primes", "Numbers");
+    for (int w = 0; w < 16; w++) {
+        if (by_omega[w]) printf("%-16d %llu\n", w, (unsigned long long)by_omega[w]);
+    }
+    printf("Rule templates: cycle-prone %llu, single_halt %llu, double_halt %llu\n",
+           (unsigned long long)(by_rule[0] + by_rule[1]), (unsigned long long)by_rule[2],
+           (unsigned long long)by_rule[3]);
+    free(numbers);
+    free(omega);
+}
+
+// Assign rules via prime factorization of Champernowne numbers (Tape 2)
+void assign_rules(ChampRun *run) {
+    int num_machines = run->num_machines;
     // Define rule templates
     uint8_t cycle_prone[STATES][SYMBOLS] = {{1, 1}, {0, 0}, {0, 0}}; // Cycle 0<->1 forever
     uint8_t single_halt[STATES][SYMBOLS] = {{2, 0}, {0, 0}, {0, 0}}; // Halt on first 0 (mean ~2 steps)
     uint8_t double_halt[STATES][SYMBOLS] = {{1, 0}, {2, 0}, {0, 0}}; // Halt on first 00 (mean ~4 steps)
     // Precompute factorizations and rules
     char factor_strs[MACHINES][50];
+    char descriptions[MACHINES][30]; // Descriptions for each machine's rule behavior
     int nums[MACHINES];
+    uint64_t batch[MACHINES] = {0};
+    uint8_t omega[MACHINES];
     for (int i = 0; i < num_machines; i++) {
-        machines[i].state = 0; // Initialize state to 0 (running)
-        // Randomize starting position: 0 to INPUT_LEN-1
-        machines[i].pos = rand() % INPUT_LEN;
-        machines[i].done = 0;  // Not halted or looped
-        machines[i].halt_step = 0; // No termination yet
-        machines[i].personal_step = 0;
-        // Zero out Tape 3 and state window for loop detection
-        memset(sim_tape[i], 0, WINDOW);
-        memset(state_window[i], 0, WINDOW);
-        // Get number for machine (default to i+1 if not enough)
-        int num = (count > i) ? numbers[i] : i + 1;
-        nums[i] = num;
-        // Factorize number using primes <100
-        int factor_count = 0; // Count distinct prime factors <100
-        char *factor_str = factor_strs[i];
-        int factor_pos = 0; // Position in factor_str
-        int temp = num, prime_idx = 0; // Track factorization
-        while (temp > 1 && prime_idx < MAX_PRIMES) {
-            int exp = 0; // Count occurrences of prime
-            while (temp % primes[prime_idx] == 0) { // Divide by prime
-                exp++; // Increment exponent
-                temp /= primes[prime_idx]; // Reduce number
-            }
-            if (exp > 0) { // If prime was used
-                factor_count++; // Increment factor count
-                // Append prime^exp to factor string
-                char temp_str[10];
-                sprintf(temp_str, "%d^%d × ", primes[prime_idx], exp);
-                for (int k = 0; temp_str[k] && factor_pos < 49; k++) {
-                    factor_str[factor_pos++] = temp_str[k];
-                }
-            }
-            prime_idx++; // Move to next prime
-        }
-        if (temp > 1) { // Remaining factor (prime >97 or number itself)
-            char temp_str[10];
-            sprintf(temp_str, "%d", temp);
-            for (int k = 0; temp_str[k] && factor_pos < 49; k++) {
-                factor_str[factor_pos++] = temp_str[k];
-            }
-        } else if (factor_count == 0) { // Number 1 or prime >97
-            sprintf(factor_str, "%d", num);
-            factor_count = 1; // Treat as one factor
-        } else { // Remove trailing " × "
-            if (factor_pos >= 3) factor_pos -= 3;
-        }
-        factor_str[factor_pos] = '\0'; // Null-terminate factor string
-        // Assign rule template based on factor count mod 4
-        int rule_idx = factor_count % 4; // 0,1: cycle-prone, 2: single_halt, 3: double_halt
-        for (int s = 0; s < STATES; s++) {
+        // Machine i takes the i-th RULE_DIGITS-digit chunk of Tape 1 (e.g., 1234, 5678, 9101)
+        batch[i] = champernowne_chunk(i, RULE_DIGITS);
+        nums[i] = batch[i];
+    }
+    if (all_factors) factorize_batch(batch, omega, num_machines, 1); // Exact distinct prime counts
+    for (int i = 0; i < num_machines; i++) {
+        // State 0 (running) at a random starting position: 0 to INPUT_LEN-1.
+        // Tape 1 is shared, so the machine's own tape is given back.
+        TmMachine *tm = &run->tm[i];
+        tm_init(tm, &run->arena, STATES - 1, SYMBOLS, rand() % INPUT_LEN, 0);
+        tm_free_tape(tm);
+        tm->length = 0;
+        // Factorization string for display (prime^exp × ... × cofactor)
+        int factor_count = format_factors(nums[i], factor_strs[i]);
+        // Assign rule template based on distinct prime count mod 4; the
+        // halt state's row is never read, so it has no entries
+        int rule_idx = rule_index(all_factors ? omega[i] : factor_count);
+        for (int s = 0; s < STATES - 1; s++) {
             for (int sym = 0; sym < SYMBOLS; sym++) {
+                uint8_t next;
                 if (rule_idx == 0 || rule_idx == 1) {
-                    rules[i][s][sym] = cycle_prone[s][sym];
+                    next = cycle_prone[s][sym];
                 } else if (rule_idx == 2) {
-                    rules[i][s][sym] = single_halt[s][sym];
+                    next = single_halt[s][sym];
                 } else {
-                    rules[i][s][sym] = double_halt[s][sym];
+                    next = double_halt[s][sym];
                 }
+                tm_set_rule(tm, s, sym, sym, 1, next);
             }
         }
         // Assign description based on rule_idx
@@ -178,74 +726,482 @@ void assign_rules(int num_machines) {
     // Print aligned data
     for (int i = 0; i < num_machines; i++) {
         char rules_str[30];
-        sprintf(rules_str, "[0->%d,%d] [1->%d,%d] [2->%d,%d]",
-                rules[i][0][0], rules[i][0][1],
-                rules[i][1][0], rules[i][1][1],
-                rules[i][2][0], rules[i][2][1]);
+        sprintf(rules_str, "[0->%d,%d] [1->%d,%d] [2->0,0]",
+                rule_next(run, i, 0, 0), rule_next(run, i, 0, 1),
+                rule_next(run, i, 1, 0), rule_next(run, i, 1, 1));
         printf("%-8d %-*d %-*s %-*s %-*s\n",
                i, max_num_width + 2, nums[i], max_fact_len + 2, factor_strs[i], RULES_WIDTH + 5, rules_str, max_desc_len + 5, descriptions[i]);
     }
-    // Zero out Tape 4 for halting set
-    for (int i = 0; i < MACHINES / 8 + 1; i++) {
-        halt_map[i] = 0; // Clear halt bitmap
-    }
+    // Zero out Tape 3, the loop-detection histories and Tape 4 for halting set
+    memset(run->sim_tape, 0, sizeof(run->sim_tape));
+    memset(run->history, 0, sizeof(run->history));
+    memset(run->halt_map, 0, sizeof(run->halt_map));
 
     printf("Rule generation completed for all machines.\n");
 }
 
 // Check for loops in Tape 3 and state window
 // Mimics ITTM loop detection at ω steps
-int check_loop(int m, uint32_t personal_step) {
+// Histories are shift registers: period p holds when the newest p entries
+// equal the p entries before them, so each period costs one xor and mask.
+int check_loop(const ChampRun *run, int m, uint32_t personal_step) {
     if (personal_step < MAX_PERSONAL_STEPS) return 0; // Wait for threshold to check loops
+    uint32_t syms = run->history[m].sym_history;
+    uint64_t states = run->history[m].state_history;
     // Check for period=1 to WINDOW/2 loops
     for (int period = 1; period <= WINDOW / 2; period++) {
         // Check sim_tape (input symbols)
-        {
-            int match = 1;
-            for (int i = 0; i < period; i++) {
-                int idx1 = (personal_step - i - 1) % WINDOW;
-                int idx2 = (personal_step - i - 1 - period) % WINDOW;
-                if (sim_tape[m][idx1] != sim_tape[m][idx2]) {
-                    match = 0;
-                    break;
+        uint32_t sym_mask = (1u << period) - 1;
+        if (((syms ^ (syms >> period)) & sym_mask) == 0) return 1;
+        // Check state window
+        int shift = period * STATE_BITS;
+        uint64_t state_mask = (1ULL << shift) - 1;
+        if (((states ^ (states >> shift)) & state_mask) == 0) return 1;
+    }
+    return 0; // No loop detected
+}
+
+// Mark every machine's starting configuration as visited
+void init_exact(ChampRun *run) {
+    memset(run->visited, 0, sizeof(run->visited));
+    for (int m = 0; m < run->num_machines; m++) {
+        uint32_t config = run->tm[m].state * INPUT_LEN + run->tm[m].position % INPUT_LEN;
+        run->visited[m][config / 8] |= 1 << (config % 8);
+        run->heuristic_step[m] = 0;
+        run->proof_step[m] = 0;
+    }
+    printf("Exact loop detection enabled (stage cap %d).\n", EXACT_MAX_STEPS);
+}
+
+// Record the current configuration; a repeat proves the machine loops
+// Two running states and a read-only tape mean a repeat by 2*INPUT_LEN steps.
+int exact_loop(ChampRun *run, int m, uint32_t personal_step) {
+    uint32_t config = run->tm[m].state * INPUT_LEN + run->tm[m].position % INPUT_LEN;
+    uint8_t bit = 1 << (config % 8);
+    if (run->visited[m][config / 8] & bit) {
+        run->proof_step[m] = personal_step;
+        return 1;
+    }
+    run->visited[m][config / 8] |= bit;
+    return 0;
+}
+
+// Pack Tape 1 parities into bits; the copy past INPUT_LEN lets blocks read across the wrap
+void pack_parity() {
+    memset(parity_bits, 0, sizeof(parity_bits));
+    for (int i = 0; i < INPUT_LEN + PARITY_PAD; i++) {
+        if ((input_tape[i % INPUT_LEN] - '0') % 2) parity_bits[i / 8] |= 1 << (i % 8);
+    }
+}
+
+// Parity of Tape 1 at pos (pos < INPUT_LEN + PARITY_PAD)
+uint8_t parity_at(uint32_t pos) {
+    return (parity_bits[pos / 8] >> (pos % 8)) & 1;
+}
+
+// 32 parities starting at pos (pos < INPUT_LEN), first symbol in bit 0
+uint32_t read_bits32(uint32_t pos) {
+    const uint8_t *b = parity_bits + pos / 8;
+    uint64_t word = 0;
+    for (int i = 4; i >= 0; i--) word = (word << 8) | b[i];
+    return (uint32_t)(word >> (pos % 8));
+}
+
+// BLOCK_BITS parities starting at pos (pos < INPUT_LEN), first symbol in bit 0
+uint32_t read_block(uint32_t pos) {
+    return read_bits32(pos) & ((1u << BLOCK_BITS) - 1);
+}
+
+// Precompute each machine's (end state, halted, halt offset) for every state and block
+void build_block_tables(ChampRun *run) {
+    for (int m = 0; m < run->num_machines; m++) {
+        if (run->rule_class[m] != m) { // Same rules as an earlier machine
+            memcpy(run->block_tables[m], run->block_tables[run->rule_class[m]], sizeof(run->block_tables[m]));
+            continue;
+        }
+        for (int s = 0; s < STATES; s++) {
+            for (uint32_t chunk = 0; chunk < (1u << BLOCK_BITS); chunk++) {
+                BlockEntry *e = &run->block_tables[m][s][chunk];
+                uint8_t state = s;
+                e->halted = (s == 2);
+                e->halt_offset = 0;
+                for (int i = 0; i < BLOCK_BITS && !e->halted; i++) {
+                    state = rule_next(run, m, state, (chunk >> i) & 1);
+                    if (state == 2) {
+                        e->halted = 1;
+                        e->halt_offset = i + 1;
+                    }
+                }
+                e->end_state = state;
+            }
+        }
+    }
+}
+
+// Rebuild Tape 3 from the tape: the last WINDOW reads of a machine that took steps steps
+void fill_sim_tape(ChampRun *run, int m, uint32_t steps) {
+    uint64_t start = run->tm[m].position;
+    for (uint32_t t = (steps > WINDOW) ? steps - WINDOW + 1 : 1; t <= steps; t++) {
+        run->sim_tape[m][(t - 1) % WINDOW] = tape_parity(start + t - 1);
+    }
+}
+
+// Record a block-engine verdict in Tape 2/3/4 exactly as the scalar loop would
+void finish_machine(ChampRun *run, int m, uint8_t state, uint32_t steps) {
+    uint32_t start = run->tm[m].position;
+    fill_sim_tape(run, m, steps);
+    run->tm[m].state = state;
+    run->tm[m].position = start + steps;
+    run->tm[m].steps = steps;
+    run->tm[m].halted = 1;
+    if (state == 2) run->halt_map[m / 8] |= (1 << (m % 8));
+    else run->proof_step[m] = steps;
+}
+
+// Run one machine to an exact verdict, BLOCK_BITS symbols per lookup
+// Blocks are aligned to laps of the read-only tape, so the first repeated
+// configuration is the first step whose state matches the state d laps
+// earlier; once that holds it keeps holding, so it is found at a block
+// boundary and then pinned down by replaying that one block.
+uint32_t run_blocks(ChampRun *run, int m) {
+    uint8_t lap_states[STATES + 1][INPUT_LEN / BLOCK_BITS + 1]; // State at each block boundary per lap
+    uint32_t start = run->tm[m].position % INPUT_LEN;
+    uint8_t state = run->tm[m].state;
+    uint32_t lookups = 0;
+    lap_states[0][0] = state;
+    // Two laps with equal starting states repeat, so the lap count is bounded by STATES
+    for (int lap = 0; lap < STATES; lap++) {
+        for (uint32_t k = 0, off = 0; off < INPUT_LEN; k++, off += BLOCK_BITS) {
+            uint32_t t = lap * INPUT_LEN + off; // Steps taken so far
+            uint32_t n = (INPUT_LEN - off < BLOCK_BITS) ? INPUT_LEN - off : BLOCK_BITS;
+            uint32_t pos = (start + off) % INPUT_LEN;
+            uint8_t next = state;
+            if (n == BLOCK_BITS) {
+                BlockEntry e = run->block_tables[m][state][read_block(pos)];
+                lookups++;
+                if (e.halted) {
+                    finish_machine(run, m, 2, t + e.halt_offset);
+                    return lookups;
+                }
+                next = e.end_state;
+            } else { // Short block at the end of a lap
+                for (uint32_t i = 0; i < n; i++) {
+                    next = rule_next(run, m, next, parity_at(pos + i));
+                    if (next == 2) {
+                        finish_machine(run, m, 2, t + i + 1);
+                        return lookups;
+                    }
+                }
+            }
+            // Boundary after this block, and any earlier lap that agrees there
+            int end_lap = (off + n == INPUT_LEN) ? lap + 1 : lap;
+            uint32_t end_k = (off + n == INPUT_LEN) ? 0 : k + 1;
+            int repeat = 0;
+            for (int prev = 0; prev < end_lap; prev++) {
+                if (lap_states[prev][end_k] == next) repeat = 1;
+            }
+            if (repeat) {
+                // Replay the block beside each earlier lap d laps back (d <= lap
+                // have a state at this block's start); a match only at the end
+                // boundary is the lap-aligned repeat itself
+                uint8_t cur = state, earlier[STATES + 1];
+                for (int d = 1; d <= lap; d++) earlier[d] = lap_states[lap - d][k];
+                uint32_t steps = n;
+                for (uint32_t i = 0; i < n && steps == n; i++) {
+                    uint8_t sym = parity_at(pos + i);
+                    cur = rule_next(run, m, cur, sym);
+                    for (int d = 1; d <= lap; d++) {
+                        earlier[d] = rule_next(run, m, earlier[d], sym);
+                        if (earlier[d] == cur) steps = i + 1;
+                    }
+                }
+                finish_machine(run, m, cur, t + steps);
+                return lookups;
+            }
+            lap_states[end_lap][end_k] = next;
+            state = next;
+        }
+    }
+    return lookups; // Not reached: some lap start repeats within STATES laps
+}
+
+// Decide every machine with the block engine, headless
+void simulate_blocks(ChampRun *run) {
+    uint32_t lookups = 0;
+    int halts = 0, loops = 0;
+    memset(run->proof_step, 0, sizeof(run->proof_step));
+    build_block_tables(run);
+    for (int m = 0; m < run->num_machines; m++) {
+        lookups += run_blocks(run, m);
+        if (run->tm[m].state == 2) halts++;
+        else loops++;
+    }
+    printf("Block engine: %d-symbol tables, %u lookups, %d halted, %d proven loops.\n",
+           BLOCK_BITS, lookups, halts, loops);
+}
+
+// Run the dovetailed stages with every machine in its own vector lane
+// Same schedule and window heuristic as simulate(), headless. Lane m reads
+// Tape 1 at base[m] + stage, so each lane's next 32 input bits are loaded
+// together every 32 stages (from a ChampStream per lane with --tape=lazy). State histories are kept as two bit planes so
+// every history fits a 32-bit lane.
+void simulate_lanes(ChampRun *run) {
+    lane8 table[STATES * SYMBOLS]; // table[state * SYMBOLS + sym] holds machine m's next state in lane m
+    ChampStream lane_streams[MACHINES]; // --tape=lazy: each lane's position on the tape
+    lane8 state = {0}, done = {0}, lane_id;
+    lane32 steps = {0}, syms = {0}, state_lo = {0}, state_hi = {0}, window = {0};
+    uint32_t base[MACHINES];
+    for (int m = 0; m < MACHINES; m++) {
+        lane_id[m] = m;
+        for (int k = 0; k < STATES * SYMBOLS; k++) {
+            table[k][m] = (m < run->num_machines) ? rule_next(run, m, k / SYMBOLS, k % SYMBOLS) : 0;
+        }
+        if (m < run->num_machines) {
+            state[m] = run->tm[m].state;
+            base[m] = (run->tm[m].position % INPUT_LEN + INPUT_LEN - (m + 1) % INPUT_LEN) % INPUT_LEN;
+            if (lazy_tape) champ_stream_seek(&lane_streams[m], run->tm[m].position);
+        } else {
+            done[m] = 0xFF; // Unused lanes never run
+            base[m] = 0;
+        }
+    }
+    uint32_t stage, max_stages = run->stage_limit ? run->stage_limit : MAX_STEPS;
+    for (stage = 1; stage <= max_stages; stage++) {
+        if ((stage - 1) % 32 == 0) {
+            // Load the next 32 reads of every lane; stop once all are done
+            int running = 0;
+            for (int m = 0; m < MACHINES; m++) {
+                if (!lazy_tape) {
+                    window[m] = read_bits32((base[m] + stage) % INPUT_LEN);
+                } else if (m < run->num_machines) {
+                    // Lane m starts reading at stage m + 1
+                    uint32_t skip = ((uint32_t)m + 1 > stage) ? m + 1 - stage : 0;
+                    window[m] = (skip >= 32) ? 0 : (uint32_t)champ_stream_parities(&lane_streams[m], 32 - skip) << skip;
+                }
+                running |= !done[m];
+            }
+            if (!running) break;
+        }
+        uint8_t started = (stage < MACHINES) ? stage : MACHINES;
+        lane8 active = (lane8)(lane_id < started) & ~done; // Machines 0 to min(stage-1, num_machines-1)
+        lane8 sym = __builtin_convertvector(window & 1, lane8);
+        window >>= 1;
+        // Next state of every lane: select the matching table row
+        lane8 idx = state * SYMBOLS + sym;
+        lane8 next = {0};
+        for (int k = 0; k < STATES * SYMBOLS; k++) {
+            next |= table[k] & (lane8)(idx == (uint8_t)k);
+        }
+        // Record read and old state (as in check_loop), then update active lanes
+        lane32 on = -__builtin_convertvector(active & 1, lane32);
+        lane32 sym32 = __builtin_convertvector(sym, lane32);
+        lane32 state32 = __builtin_convertvector(state, lane32);
+        syms = (((syms << 1) | sym32) & on) | (syms & ~on);
+        state_lo = (((state_lo << 1) | (state32 & 1)) & on) | (state_lo & ~on);
+        state_hi = (((state_hi << 1) | (state32 >> 1)) & on) | (state_hi & ~on);
+        steps -= on; // +1 where active
+        state = (next & active) | (state & ~active);
+        lane8 finished = (lane8)(next == 2);
+        if (stage >= MAX_PERSONAL_STEPS) {
+            // Window heuristic for every lane at once
+            lane32 loop = {0};
+            for (int period = 1; period <= WINDOW / 2; period++) {
+                uint32_t mask = (1u << period) - 1;
+                loop |= (lane32)(((syms ^ (syms >> period)) & mask) == 0);
+                loop |= (lane32)((((state_lo ^ (state_lo >> period)) | (state_hi ^ (state_hi >> period))) & mask) == 0);
+            }
+            loop &= (lane32)(steps >= MAX_PERSONAL_STEPS);
+            finished |= -__builtin_convertvector(loop & 1, lane8);
+        }
+        done |= finished & active;
+    }
+    // Scalar write-back so Tape 2/3/4 print as usual
+    for (int m = 0; m < run->num_machines; m++) {
+        fill_sim_tape(run, m, steps[m]);
+        run->tm[m].state = state[m];
+        run->tm[m].position += steps[m];
+        run->tm[m].steps = steps[m];
+        run->tm[m].halted = done[m] ? 1 : 0;
+        if (state[m] == 2) run->halt_map[m / 8] |= (1 << (m % 8));
+    }
+    printf("Lane engine: %d machines per vector, %u stages.\n", MACHINES, stage - 1);
+}
+
+// Halting time and verdict of every start position, for each machine
+void analyze_all_starts(ChampRun *run) {
+    const char *bucket_names[HIST_BUCKETS] = {"1", "2", "<=4", "<=8", "<=16", "<=32", "<=64", "<=128", ">128"};
+    printf("All-starts analysis: %d start positions per machine (state 0)\n", INPUT_LEN);
+    printf("%-8s %-6s %-6s %-8s %-9s %-8s", "Machine", "Halts", "Loops", "MinStep", "MeanStep", "MaxStep");
+    for (int b = 0; b < HIST_BUCKETS; b++) printf(" %6s", bucket_names[b]);
+    printf("\n");
+    char rows[MACHINES][200]; // Each rule class's results, after the machine column
+    LapOutcome (*lap_outcome)[STATES] = malloc((INPUT_LEN + 1) * sizeof(*lap_outcome)); // Outcome from every (pos, state)
+    for (int m = 0; m < run->num_machines; m++) {
+        if (run->rule_class[m] != m) { // Only the rules matter: every start position is covered
+            printf("%-8d%s\n", m, rows[run->rule_class[m]]);
+            continue;
+        }
+        // Backward pass: outcome from every (pos, state) to the end of the lap
+        for (int s = 0; s < STATES; s++) {
+            lap_outcome[INPUT_LEN][s].steps = 0;
+            lap_outcome[INPUT_LEN][s].state = s;
+        }
+        for (int p = INPUT_LEN - 1; p >= 0; p--) {
+            uint8_t sym = parity_at(p);
+            for (int s = 0; s < STATES; s++) {
+                uint8_t next = (s == 2) ? 2 : rule_next(run, m, s, sym);
+                if (s == 2) {
+                    lap_outcome[p][s].steps = 0;
+                    lap_outcome[p][s].state = 2;
+                } else if (next == 2) {
+                    lap_outcome[p][s].steps = 1;
+                    lap_outcome[p][s].state = 2;
+                } else {
+                    lap_outcome[p][s].steps = lap_outcome[p + 1][next].steps + 1;
+                    lap_outcome[p][s].state = lap_outcome[p + 1][next].state;
                 }
             }
-            if (match) return 1;
-        }
-        // Check state_window
-        {
-            int match = 1;
-            for (int i = 0; i < period; i++) {
-                int idx1 = (personal_step - i - 1) % WINDOW;
-                int idx2 = (personal_step - i - 1 - period) % WINDOW;
-                if (state_window[m][idx1] != state_window[m][idx2]) {
-                    match = 0;
+        }
+        // Whole laps from position 0: halt time, or a repeated lap-start state (loop)
+        uint64_t lap_halt[STATES];
+        uint8_t lap_loops[STATES];
+        for (int s = 0; s < STATES; s++) {
+            uint8_t seen[STATES] = {0}, cur = s;
+            uint64_t t = 0;
+            lap_loops[s] = 0;
+            while (lap_outcome[0][cur].state != 2) {
+                if (seen[cur]) {
+                    lap_loops[s] = 1;
                     break;
                 }
+                seen[cur] = 1;
+                t += INPUT_LEN;
+                cur = lap_outcome[0][cur].state;
+            }
+            lap_halt[s] = t + lap_outcome[0][cur].steps;
+        }
+        // Every start position: finish the first lap, then whole laps
+        uint32_t halts = 0, loops = 0, hist[HIST_BUCKETS] = {0};
+        uint64_t min_t = UINT64_MAX, max_t = 0, sum_t = 0;
+        for (int p = 0; p < INPUT_LEN; p++) {
+            LapOutcome first = lap_outcome[p][0];
+            uint64_t t = first.steps;
+            if (first.state != 2) {
+                if (lap_loops[first.state]) {
+                    loops++;
+                    continue;
+                }
+                t += lap_halt[first.state];
             }
-            if (match) return 1;
+            halts++;
+            sum_t += t;
+            if (t < min_t) min_t = t;
+            if (t > max_t) max_t = t;
+            int b = 0;
+            while (b < HIST_BUCKETS - 1 && t > (1ULL << b)) b++;
+            hist[b]++;
         }
+        int len;
+        if (halts) {
+            len = sprintf(rows[m], " %-6u %-6u %-8llu %-9.2f %-8llu", halts, loops,
+                          (unsigned long long)min_t, (double)sum_t / halts, (unsigned long long)max_t);
+        } else {
+            len = sprintf(rows[m], " %-6u %-6u %-8s %-9s %-8s", halts, loops, "-", "-", "-");
+        }
+        for (int b = 0; b < HIST_BUCKETS; b++) len += sprintf(rows[m] + len, " %6u", hist[b]);
+        printf("%-8d%s\n", m, rows[m]);
+    }
+    free(lap_outcome);
+}
+
+// Group machines by rule table, and by rule table and start position
+void find_classes(ChampRun *run) {
+    for (int m = 0; m < run->num_machines; m++) {
+        run->rule_class[m] = run->class_rep[m] = m;
+        for (int r = 0; r < m; r++) {
+            if (run->rule_class[r] == r &&
+                memcmp(run->tm[r].rules, run->tm[m].rules, (STATES - 1) * SYMBOLS * sizeof(TmRule)) == 0) {
+                run->rule_class[m] = r;
+                break;
+            }
+        }
+        for (int r = 0; r < m; r++) {
+            if (run->class_rep[r] == r && run->rule_class[r] == run->rule_class[m] &&
+                run->tm[r].position == run->tm[m].position) {
+                run->class_rep[m] = r;
+                break;
+            }
+        }
+    }
+}
+
+// Record a representative's step, growing its trace as needed
+void record_step(ChampRun *run, int m, uint32_t personal_step, uint8_t sym, uint8_t next) {
+    if (personal_step > run->trace_cap[m]) {
+        run->trace_cap[m] = run->trace_cap[m] ? run->trace_cap[m] * 2 : 1024;
+        run->trace[m] = realloc(run->trace[m], run->trace_cap[m]);
+    }
+    run->trace[m][personal_step - 1] = sym | next << 1;
+}
+
+// Step a machine by replaying its class representative, which is always ahead
+// of it: it started at an earlier stage and takes one step per stage too
+void replay_step(ChampRun *run, int m, uint32_t personal_step, uint32_t stage) {
+    int r = run->class_rep[m];
+    uint8_t sym = run->trace[r][personal_step - 1] & 1, next = run->trace[r][personal_step - 1] >> 1;
+    if (run->show_steps) {
+        printf("Machine %d: Personal step %u (global stage %u), Read %d, Next State %d\n",
+               m, personal_step, stage, sym, next);
+    }
+    run->sim_tape[m][(personal_step - 1) % WINDOW] = sym;
+    run->history[m].sym_history = (run->history[m].sym_history << 1) | sym;
+    run->history[m].state_history = (run->history[m].state_history << STATE_BITS) | run->tm[m].state;
+    run->tm[m].state = next;
+    run->tm[m].position++;
+    run->tm[m].steps = personal_step;
+    if (run->heuristic_step[r] == personal_step) run->heuristic_step[m] = personal_step;
+    if (run->tm[r].halted && run->tm[r].steps == personal_step) { // Same verdict at the same step
+        run->tm[m].halted = 1;
+        run->halt_map[m / 8] |= ((run->halt_map[r / 8] >> (r % 8)) & 1) << (m % 8);
+        run->proof_step[m] = run->proof_step[r];
     }
-    return 0; // No loop detected
 }
 
 // Check if all machines are halted
-int all_machines_halted(int num_machines) {
-    for (int m = 0; m < num_machines; m++) {
-        if (!machines[m].done) return 0;
+int all_machines_halted(const ChampRun *run) {
+    for (int m = 0; m < run->num_machines; m++) {
+        if (!run->tm[m].halted) return 0;
     }
     return 1;
 }
 
 // Print aligned header for machine states
+void format_header(char *line) {
+    sprintf(line, "%-8s %-6s %-6s %-5s %-10s %s",
+            "Machine", "State", "Pos", "Done", "HaltStep", "Tape3");
+}
+
 void print_header() {
-    printf("%-8s %-6s %-6s %-5s %-10s %s\n",
-           "Machine", "State", "Pos", "Done", "HaltStep", "Tape3");
+    char line[DISPLAY_LINE];
+    format_header(line);
+    printf("%s\n", line);
 }
 
-// Print aligned row for a machine
-void print_machine_row(int i) {
-    int last_j = ((int)machines[i].personal_step - 1) % WINDOW;
+// Copy the displayed part of a machine (padding zeroed, so rows compare with memcmp)
+void snapshot_row(const ChampRun *run, int i, MachineRow *r) {
+    memset(r, 0, sizeof(*r));
+    r->state = run->tm[i].state;
+    r->done = run->tm[i].halted;
+    r->pos = run->tm[i].position;
+    r->halt_step = run->tm[i].steps;
+    r->personal_step = run->tm[i].steps;
+    memcpy(r->window, run->sim_tape[i], WINDOW);
+}
+
+// Format an aligned row for a machine
+void format_machine_row(const void *row, int i, char *line) {
+    const MachineRow *r = row;
+    int last_j = ((int)r->personal_step - 1) % WINDOW;
     char tape_str[200]; // Buffer for Tape3 string (larger for 20 items)
     int posi = sprintf(tape_str, "[");
     for (int j = 0; j < WINDOW; j++) {
@@ -253,61 +1209,146 @@ void print_machine_row(int i) {
             posi += sprintf(tape_str + posi, ",");
         }
         if (j == last_j) {
-            posi += sprintf(tape_str + posi, "[%d]", sim_tape[i][j]); // Highlight last
+            posi += sprintf(tape_str + posi, "[%d]", r->window[j]); // Highlight last
         } else {
-            posi += sprintf(tape_str + posi, "%d", sim_tape[i][j]);
+            posi += sprintf(tape_str + posi, "%d", r->window[j]);
         }
     }
     posi += sprintf(tape_str + posi, "]");
     tape_str[posi] = '\0';
 
-    printf("%-8d %-6d %-6u %-5d %-10u %s\n",
-           i, machines[i].state, machines[i].pos, machines[i].done, machines[i].halt_step, tape_str);
+    sprintf(line, "%-8d %-6d %-6llu %-5d %-10u %s",
+            i, r->state, (unsigned long long)r->pos, r->done, r->halt_step, tape_str);
+}
+
+// Print aligned row for a machine
+void print_machine_row(const ChampRun *run, int i) {
+    MachineRow r;
+    char line[DISPLAY_LINE];
+    snapshot_row(run, i, &r);
+    format_machine_row(&r, i, line);
+    printf("%s\n", line);
+}
+
+// Hand the display a snapshot of every machine and Tape 4
+void publish_stage(ChampRun *run, uint32_t stage) {
+    MachineRow *rows = display_back(&run->display);
+    char status[DISPLAY_LINE];
+    int len = sprintf(status, "Stage %u  Tape 4: ", stage), halts = 0;
+    for (int i = 0; i < run->num_machines; i++) {
+        snapshot_row(run, i, &rows[i]);
+        int bit = (run->halt_map[i / 8] >> (i % 8)) & 1;
+        halts += bit;
+        len += sprintf(status + len, "%d", bit);
+    }
+    sprintf(status + len, "  Halted: %d/%d  (Enter pauses)", halts, run->num_machines);
+    display_publish(&run->display, status);
+}
+
+// Note the first breakpoint machine m's step hit this stage
+void check_break(ChampRun *run, int m, uint32_t personal_step) {
+    if (run->break_reason[0]) return;
+    if (break_at(&run->breaks, BREAK_STEP, personal_step)) {
+        sprintf(run->break_reason, "machine %d reached step %u", m, personal_step);
+    } else if (break_at(&run->breaks, BREAK_STATE, run->tm[m].state)) {
+        sprintf(run->break_reason, "machine %d entered state %d", m, run->tm[m].state);
+    } else if (run->tm[m].halted && break_at(&run->breaks, BREAK_HALT, m)) {
+        sprintf(run->break_reason, "machine %d %s", m, (run->halt_map[m / 8] >> (m % 8)) & 1 ? "halted" : "looped");
+    }
 }
 
 // Dovetail: run all machines like an ITTM oracle with step-by-step display
+// (or, with breakpoints, display only the stages that hit one)
 // Tape 3: simulates TMs; Tape 4: records halts
-void simulate(int num_machines) {
+void simulate(ChampRun *run) {
     // Run for MAX_STEPS stages, a small slice of infinite time
-    for (uint32_t stage = 1; stage <= MAX_STEPS; stage++) {
-        printf("Stage %u:\n", stage);
+    uint32_t max_stages = run->stage_limit ? run->stage_limit : (run->exact ? EXACT_MAX_STEPS : MAX_STEPS);
+    for (uint32_t stage = 1; stage <= max_stages; stage++) {
+        run->show_steps = !live_fps && break_showing(&run->breaks);
+        run->break_reason[0] = '\0';
+        if (run->show_steps) printf("Stage %u:\n", stage);
         // Process machines 0 to min(stage-1, num_machines-1)
-        for (int m = 0; m < num_machines && m < stage; m++) {
-            if (machines[m].done) continue; // Skip finished machines
-            uint32_t personal_step = machines[m].personal_step + 1;
-            // Read Tape 1 digit, convert to 0/1 (mod 2)
-            uint8_t sym = (input_tape[machines[m].pos % INPUT_LEN] - '0') % 2;
+        for (int m = 0; m < run->num_machines && m < stage; m++) {
+            TmMachine *tm = &run->tm[m];
+            if (tm->halted) continue; // Skip finished machines
+            uint32_t personal_step = tm->steps + 1;
+            if (run->class_rep[m] != m) { // Duplicate: replay its representative
+                replay_step(run, m, personal_step, stage);
+                if (run->breaks.enabled) check_break(run, m, personal_step);
+                continue;
+            }
+            // Read Tape 1 digit, convert to 0/1 (mod 2); the lazy tape is streamed,
+            // seeking only once, as the head only moves right
+            uint8_t sym;
+            if (lazy_tape) {
+                if (personal_step == 1) champ_stream_seek(&run->stream[m], tm->position);
+                sym = champ_stream_next(&run->stream[m]) % 2;
+            } else {
+                sym = tape_parity(tm->position);
+            }
             // Apply rule to get next state
-            uint8_t next = rules[m][machines[m].state][sym];
-            printf("Machine %d: Personal step %u (global stage %u), Read %d, Next State %d\n",
-                   m, personal_step, stage, sym, next);
+            uint8_t next = tm_rule(tm, tm->state, sym)->next;
+            record_step(run, m, personal_step, sym, next);
+            if (run->show_steps) {
+                printf("Machine %d: Personal step %u (global stage %u), Read %d, Next State %d\n",
+                       m, personal_step, stage, sym, next);
+            }
             // Record old state and read sym in windows
             uint32_t idx = (personal_step - 1) % WINDOW;
-            state_window[m][idx] = machines[m].state;
-            sim_tape[m][idx] = sym;
-            machines[m].state = next; // Update state
-            machines[m].pos++; // Move tape position
-            machines[m].personal_step = personal_step;
-            machines[m].halt_step = personal_step; // Track personal steps always
+            run->sim_tape[m][idx] = sym;
+            run->history[m].sym_history = (run->history[m].sym_history << 1) | sym;
+            run->history[m].state_history = (run->history[m].state_history << STATE_BITS) | tm->state;
+            tm->state = next; // Update state
+            tm->position++; // Move tape position
+            tm->steps = personal_step; // Track personal steps always
             // Check for halt (state=2) or loop
-            if (next == 2 || (personal_step >= MAX_PERSONAL_STEPS && check_loop(m, personal_step))) {
-                machines[m].done = 1; // Mark as done
+            // With --exact the heuristic verdict is only recorded for the report
+            int looped = 0;
+            if (next != 2 && personal_step >= MAX_PERSONAL_STEPS &&
+                !run->heuristic_step[m] && check_loop(run, m, personal_step)) {
+                if (run->exact) run->heuristic_step[m] = personal_step;
+                else looped = 1;
+            }
+            if (run->exact && next != 2) looped = exact_loop(run, m, personal_step);
+            if (next == 2 || looped) {
+                tm->halted = 1; // Mark as done
                 if (next == 2) { // If halted
-                    halt_map[m / 8] |= (1 << (m % 8)); // Set Tape 4 bit
+                    run->halt_map[m / 8] |= (1 << (m % 8)); // Set Tape 4 bit
                 }
             }
+            if (run->breaks.enabled) check_break(run, m, personal_step);
+        }
+        if (live_fps) { // Snapshot only when the display is ready for a frame
+            int finished = all_machines_halted(run) || stage == max_stages;
+            if (finished) display_wait(&run->display);
+            if (finished || display_due(&run->display)) publish_stage(run, stage);
+            if (finished) break;
+            continue;
+        }
+        if (!run->break_reason[0] && break_at(&run->breaks, BREAK_STAGE, stage)) sprintf(run->break_reason, "stage %u", stage);
+        if (!run->show_steps && !run->break_reason[0]) { // Running on to the next breakpoint
+            if (all_machines_halted(run)) {
+                printf("All machines halted at stage %u. Simulation complete.\n", stage);
+                break;
+            }
+            continue;
         }
+        if (run->break_reason[0] && !run->show_steps) printf("Break at stage %u: %s\n", stage, run->break_reason);
         // Print Tape 2 and Tape 3 combined for each machine with alignment
         printf("Machine States and Simulation Window:\n");
         print_header();
-        for (int i = 0; i < num_machines; i++) {
-            print_machine_row(i);
+        for (int i = 0; i < run->num_machines; i++) {
+            print_machine_row(run, i);
         }
         // Check if all halted
-        if (all_machines_halted(num_machines)) {
+        if (all_machines_halted(run)) {
             printf("All machines halted. Simulation complete.\n");
             break;
         }
+        if (run->breaks.enabled) {
+            break_wait(&run->breaks);
+            continue;
+        }
         // Pause and wait for key press (Enter)
         printf("Press Enter to continue...\n");
         getchar(); // Wait for Enter key
@@ -315,32 +1356,133 @@ void simulate(int num_machines) {
 }
 
 // Print final Tape 2 and Tape 3 combined with alignment
-void print_tapes(int num_machines) {
+void print_tapes(const ChampRun *run) {
     printf("Final Machine States and Simulation Window:\n");
     print_header();
-    for (int i = 0; i < num_machines; i++) {
-        print_machine_row(i);
+    for (int i = 0; i < run->num_machines; i++) {
+        print_machine_row(run, i);
     }
 }
 
 // Print Tape 4: halting set prefix
 // Shows which machines halted (1) or looped (0)
-void print_halt_set(int num_machines) {
+void print_halt_set(const ChampRun *run) {
     int halts = 0;
     // Print Tape 4 as a bitmap up to num_machines
     printf("Tape 4 (1=halted):\n");
-    for (int i = 0; i < num_machines; i++) {
-        int bit = (halt_map[i / 8] >> (i % 8)) & 1; // Get bit (0 or 1)
+    for (int i = 0; i < run->num_machines; i++) {
+        int bit = (run->halt_map[i / 8] >> (i % 8)) & 1; // Get bit (0 or 1)
         printf("%d", bit); // Print bit
         halts += bit; // Count halts
         if (i % 8 == 7) printf(" "); // Space every 8 bits for readability
     }
     // Print total halts
-    printf("\nHalted: %d/%d\n", halts, num_machines);
+    printf("\nHalted: %d/%d\n", halts, run->num_machines);
 }
 
-int main() {
+// Compare exact verdicts with the window heuristic's
+void print_exact_report(const ChampRun *run) {
+    int false_loops = 0, missed = 0, unconfirmed = 0, proven = 0;
+    printf("Exact loop detection vs window heuristic:\n");
+    printf("%-8s %-12s %-12s %s\n", "Machine", "Heuristic", "Exact", "Verdict");
+    for (int i = 0; i < run->num_machines; i++) {
+        char heuristic[20], result[20];
+        const char *verdict = "agrees";
+        int halted = (run->halt_map[i / 8] >> (i % 8)) & 1;
+        if (run->heuristic_step[i]) sprintf(heuristic, "loop@%u", run->heuristic_step[i]);
+        else strcpy(heuristic, "-");
+        if (halted) sprintf(result, "halt@%llu", (unsigned long long)run->tm[i].steps);
+        else if (run->proof_step[i]) sprintf(result, "loop@%u", run->proof_step[i]);
+        else strcpy(result, "undecided");
+        if (run->proof_step[i]) proven++;
+        if (run->heuristic_step[i] && halted) {
+            verdict = "overturned (halts)";
+            false_loops++;
+        } else if (run->heuristic_step[i] && !run->proof_step[i]) {
+            verdict = "unconfirmed";
+            unconfirmed++;
+        } else if (!run->heuristic_step[i] && run->proof_step[i]) {
+            verdict = "overturned (missed loop)";
+            missed++;
+        }
+        printf("%-8d %-12s %-12s %s\n", i, heuristic, result, verdict);
+    }
+    printf("Proven loops: %d/%d\n", proven, run->num_machines);
+    printf("Heuristic verdicts overturned: %d (%d false loops, %d missed loops), unconfirmed: %d\n",
+           false_loops + missed, false_loops, missed, unconfirmed);
+}
+
+int main(int argc, char *argv[]) {
+    for (int a = 1; a < argc; a++) {
+        if (strcmp(argv[a], "--exact") == 0) {
+            exact_mode = 1;
+        } else if (strcmp(argv[a], "--engine=scalar") == 0) {
+            engine = ENGINE_SCALAR;
+        } else if (strcmp(argv[a], "--engine=table") == 0) {
+            engine = ENGINE_TABLE; // Headless, decides every machine exactly
+        } else if (strcmp(argv[a], "--engine=simd") == 0) {
+            engine = ENGINE_LANES; // Headless, same stages as the scalar loop
+        } else if (strcmp(argv[a], "--all-starts") == 0) {
+            all_starts = 1; // Every start position instead of one random one
+        } else if (strcmp(argv[a], "--tape=lazy") == 0) {
+            lazy_tape = 1; // Unbounded Champernowne constant instead of the wrapped prefix
+        } else if (strcmp(argv[a], "--tape=prefix") == 0) {
+            lazy_tape = 0;
+        } else if (strncmp(argv[a], "--stages=", 9) == 0) {
+            stage_limit = strtoul(argv[a] + 9, NULL, 10);
+        } else if (strncmp(argv[a], "--population=", 13) == 0) {
+            population = strtoull(argv[a] + 13, NULL, 10);
+        } else if (strncmp(argv[a], "--chunk=", 8) == 0) {
+            chunk_digits = atoi(argv[a] + 8);
+        } else if (strncmp(argv[a], "--threads=", 10) == 0) {
+            factor_threads = atoi(argv[a] + 10);
+        } else if (strcmp(argv[a], "--all-factors") == 0) {
+            all_factors = 1; // Count primes above 97 too when picking rule templates
+        } else if (strcmp(argv[a], "--live") == 0 || strncmp(argv[a], "--live=", 7) == 0) {
+            live_fps = argv[a][6] ? atof(argv[a] + 7) : 10; // Scalar engine only
+            if (live_fps <= 0) live_fps = 10;
+        } else if (strncmp(argv[a], "--break=", 8) == 0) { // Scalar engine only
+            if (!break_parse(&break_specs, argv[a] + 8, 1 << BREAK_STEP | 1 << BREAK_STAGE | 1 << BREAK_STATE | 1 << BREAK_HALT)) return 1;
+        } else if (strcmp(argv[a], "--run") == 0) {
+            break_specs.enabled = 1;
+        } else {
+            printf("Usage: %s [--exact] [--engine=scalar|table|simd] [--all-starts] [--tape=prefix|lazy] [--stages=N] [--live[=FPS]]\n"
+                   "       %s [--break=SPEC]... [--run] (scalar engine: run headless between breakpoints)\n"
+                   "       %s --population=N [--chunk=D] [--threads=T]\n"
+                   "       --all-factors: rule templates count every distinct prime, not just those < 100\n",
+                   argv[0], argv[0], argv[0]);
+            return 1;
+        }
+    }
+    if (population) {
+        if (chunk_digits < 1 || chunk_digits > 19) {
+            printf("Error: --chunk must be between 1 and 19 digits.\n");
+            return 1;
+        }
+        run_population(); // Rule assignment only, for large populations
+        return 0;
+    }
+    if (lazy_tape && (exact_mode || all_starts || engine == ENGINE_TABLE)) {
+        // These rely on the tape repeating every INPUT_LEN symbols
+        printf("Error: --tape=lazy does not wrap, so it cannot be used with --exact, --all-starts or --engine=table.\n");
+        return 1;
+    }
+    if (exact_mode && engine == ENGINE_LANES) {
+        printf("Error: --engine=simd runs the window heuristic, so it cannot be used with --exact.\n");
+        return 1;
+    }
+    if (break_specs.enabled && (engine != ENGINE_SCALAR || all_starts || live_fps)) {
+        printf("Error: breakpoints stop the scalar engine's stages, so they cannot be used with --engine=table|simd, --all-starts or --live.\n");
+        return 1;
+    }
+    if (live_fps && (engine != ENGINE_SCALAR || all_starts)) {
+        printf("Error: --live drives the scalar engine's stages, so it cannot be used with --engine=table|simd or --all-starts.\n");
+        return 1;
+    }
     srand(time(NULL)); // Seed random number generator
+    ChampRun *run = calloc(1, sizeof(ChampRun));
+    run->breaks = break_specs;
+    run->show_steps = 1;
     int num_machines;
     printf("Enter number of machines (1-32): ");
     scanf("%d", &num_machines);
@@ -348,14 +1490,46 @@ int main() {
         printf("Invalid number of machines. Using 32.\n");
         num_machines = MACHINES;
     }
+    run->num_machines = num_machines;
+    run->exact = exact_mode;
+    run->stage_limit = stage_limit;
     // Start the ITTM oracle simulation
     printf("Starting ITTM oracle simulation with Champernowne and %d machines...\n", num_machines);
     load_champernowne(); // Tape 1: generate Champernowne prefix
-    assign_rules(num_machines); // Tape 2: parse and set rules via prime factorization
-    printf("\nSimulation ready. Press Enter to begin...\n");
-    getchar(); // Wait for initial Enter
-    simulate(num_machines); // Tape 3: run dovetailed simulation interactively
-    print_tapes(num_machines); // Final view of Tape 2 & 3
-    print_halt_set(num_machines); // Tape 4: show halting set prefix
+    if (lazy_tape) printf("Tape 1: machines read the unbounded constant (digits computed on demand)\n");
+    assign_rules(run); // Tape 2: parse and set rules via prime factorization
+    find_classes(run); // Machines sharing rules (and start position) are computed once
+    if (all_starts) {
+        pack_parity(); // Tape 1 as packed parity bits
+        analyze_all_starts(run); // Distribution over all start positions
+        return 0;
+    }
+    if (engine == ENGINE_TABLE) {
+        pack_parity(); // Tape 1 as packed parity bits
+        simulate_blocks(run); // Tape 3: exact verdicts from block lookups
+    } else if (engine == ENGINE_LANES) {
+        pack_parity(); // Tape 1 as packed parity bits
+        simulate_lanes(run); // Tape 3: all machines stepped together
+    } else {
+        if (exact_mode) init_exact(run); // Exact loop proofs instead of the window heuristic
+        printf("\nSimulation ready. Press Enter to begin...\n");
+        getchar(); // Wait for initial Enter
+        if (live_fps) {
+            char header[DISPLAY_LINE];
+            format_header(header);
+            display_start(&run->display, num_machines, sizeof(MachineRow), live_fps, format_machine_row, header);
+        }
+        simulate(run); // Tape 3: run dovetailed simulation interactively
+        if (live_fps) {
+            display_stop(&run->display);
+            printf("Live display: %ld frames drawn, %ld snapshots published\n", run->display.frames, run->display.published);
+        }
+    }
+    print_tapes(run); // Final view of Tape 2 & 3
+    print_halt_set(run); // Tape 4: show halting set prefix
+    if (exact_mode && engine == ENGINE_SCALAR) print_exact_report(run);
+    for (int m = 0; m < num_machines; m++) free(run->trace[m]);
+    arena_free_all(&run->arena);
+    free(run);
     return 0; // Exit program
 }
\ No newline at end of file
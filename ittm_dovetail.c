@@ -1,26 +1,55 @@
 // ITTM with variable 3 state TMs and dovetailing
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include "tm_core.h"
+#include "tm_display.h"
+#include "tm_break.h"
+#include "tm_nondet.h"
+#include "tm_hashlife.h"
+#include "tm_exptape.h"
+#include "tm_enum.h"
+#include "tm_snapshot.h"
+#include "tm_results.h"
 
 // Configuration: ITTM simulation for teaching, up to 30 three-state machines
 #define MAX_MACHINES 30
 #define NUM_STATES 3
 #define NUM_SYMBOLS 2
 #define MAX_STEPS 500
+#define EXACT_MAX_STEPS 8000 // Stage cap with --exact: proofs need whole laps of the tape
 #define MAX_PERSONAL_STEPS 100
 #define WINDOW_SIZE 20
 #define TAPE_LENGTH 1000
+#define STATE_BITS 2 // Bits per state in the packed loop-detection history
+#define DB_MIN_SLOTS 1024 // Initial halting DB capacity (a power of two)
+#define DB_MAGIC "ITTMHDB2" // Version 2: keys and tape hashes from tm_mix64
+#define MAX_LIMITS 64     // Most limit stages --limit can reach (stage ω·MAX_LIMITS)
+#define LIMIT_MAX_STEPS 1000000 // Steps allowed between limits before a machine is undecided
+#define LIMIT_STATE 0     // State at limit stages: the machines have no spare state for it
+#define TAPE_WORDS ((TAPE_LENGTH + 63) / 64)
+#define MAX_LOAD_FILES 16    // --load=FILE may be given this many times
+#define GENERAL_ROWS_SHOWN 64 // Final rows printed for loaded machines (all are in Tape 4)
+#define EXPLORE_MAX_DEPTH 500 // BFS levels for --explore unless --depth=N
+#define HASHLIFE_MAX_STEPS 1000000000000ULL // Step budget per machine for --hashlife unless --stages=N
+#define EXPTAPE_MAX_MACRO_STEPS 100000000 // Macro-step budget per machine for --exptape unless --stages=N
+#define EXPTAPE_RUNS_SHOWN 8 // Runs a side printed for each --exptape tape
+#define ENUMERATE_MAX_STEPS 1000 // Step budget per machine for --enumerate unless --stages=N
+#define ENUMERATE_SPLIT_DEPTH 3  // Tree depth whose nodes --shard deals out unless --split=D
 
-// Structure for each Turing machine
+// Recent history of a built-in machine, for the window heuristic
 typedef struct {
-    uint8_t current_state;   // Current state (0, 1, or 2 for halt)
-    uint32_t tape_position;  // Position on input tape
-    uint8_t halted;          // 1 if halted or looped
-    uint32_t halt_step;      // Personal step count at which machine halted or looped
-    uint8_t tape[TAPE_LENGTH]; // Individual input tape
-} TuringMachine;
+    uint32_t write_history;  // Recent writes, one bit each, newest in bit 0
+    uint64_t state_history;  // Recent states, STATE_BITS each, newest lowest
+} LoopHistory;
 
 // Structure for transition rules
 typedef struct {
@@ -28,26 +57,144 @@ typedef struct {
     uint8_t next_state;      // Next state (0, 1, or 2)
 } Rule;
 
-// Global state
-TuringMachine tms[MAX_MACHINES];              // Tape 2: machine states
-uint8_t output_tape[MAX_MACHINES][WINDOW_SIZE]; // Tape 3: simulation window
-uint8_t halt_set[(MAX_MACHINES / 8) + 1];    // Tape 4: halting set bitmap
-Rule rule_table[MAX_MACHINES][NUM_STATES][NUM_SYMBOLS];
+uint8_t show_stats = 0; // --stats: report tape memory at the end of the run
 
-// Initialize each machine's input tape to all 0s, except Machine 9
-void initialize_tapes(int num_machines) {
-    for (int i = 0; i < num_machines; i++) {
-        memset(tms[i].tape, 0, TAPE_LENGTH);
-        if (i == 9) tms[i].tape[1] = 1; // Add a 1 for Machine 9 to trigger state transition
+// Exact loop detection (--exact): Brent cycle search over full configurations
+// (state, position mod TAPE_LENGTH, tape). The tape is compared by Zobrist hash
+// first and confirmed against a packed snapshot, so a reported loop is a proof.
+typedef struct {
+    uint64_t tape_hash;      // Zobrist hash of the live tape, updated on each write
+    uint64_t snap_hash;      // Tape hash at the snapshot
+    uint8_t snap_state;      // State at the snapshot
+    uint32_t snap_pos;       // Position mod TAPE_LENGTH at the snapshot
+    uint32_t power;          // Brent: length of the current search window
+    uint32_t lambda;         // Brent: steps taken since the snapshot
+    uint32_t heuristic_step; // Step at which detect_loop() first flagged a loop (0 = never)
+    uint32_t proof_step;     // Step at which the loop was proven (0 = not proven)
+    uint8_t snap_tape[(TAPE_LENGTH + 7) / 8]; // Snapshot tape as a bitset
+} ExactLoop;
+
+uint8_t exact_mode = 0;             // 1 when --exact replaces the window heuristic
+uint64_t tape_keys[TAPE_LENGTH];    // Zobrist key per tape cell, the same for every run
+
+// Halting DB (--db=PATH): verdicts of decided machines kept across runs in an
+// mmap'd open-addressing table. A record is keyed by the machine's rules for
+// states 0 and 1 (the halt state's row is never read), the Zobrist hash of its
+// input tape, its start position and the decider, and holds enough of the
+// final configuration to print the machine's row without simulating it.
+#define DECIDER_HEURISTIC 1
+#define DECIDER_EXACT 2
+#define VERDICT_HALT 1
+#define VERDICT_LOOP 2
+
+typedef struct {
+    uint64_t key;            // Hash of the fields below it up to decider (0 = empty slot)
+    uint64_t tape_hash;      // Zobrist hash of the input tape
+    uint32_t start_pos;      // Start position on the input tape
+    uint16_t rules;          // Rules for states 0 and 1: 3 bits (write, next) each
+    uint8_t decider;         // DECIDER_HEURISTIC or DECIDER_EXACT
+    uint8_t verdict;         // VERDICT_HALT or VERDICT_LOOP
+    uint8_t final_state;
+    uint8_t pad[3];
+    uint32_t halt_step;      // Personal step of the verdict
+    uint32_t final_pos;      // Tape position after the last step
+    uint32_t window;         // Tape 3 at the end, bit j = cell j
+    uint32_t heuristic_step; // --exact only: step the window heuristic flagged
+} HaltRecord;
+
+typedef struct {
+    char magic[8];           // DB_MAGIC
+    uint64_t capacity;       // Slots, a power of two
+    uint64_t count;          // Occupied slots
+} HaltDBHeader;
+
+// A run's open DB
+typedef struct {
+    const char *path;
+    int fd;
+    HaltDBHeader *header;    // Mapped file: header, then capacity slots
+    HaltRecord *slots;
+} HaltDB;
+
+const char *db_path = NULL;  // --db=PATH; NULL runs without the DB
+
+// Deduplication: machines with the same rules for states 0 and 1, the same
+// input tape and the same start position follow the same trajectory, only
+// started at different stages. Each class is simulated by its lowest-numbered
+// member, which records every step; the others replay the record, so the
+// per-stage log, display rows and Tape 4 are unchanged.
+typedef struct {
+    uint8_t read, write, next;
+} TraceStep;
+
+// One run of the built-in machines. Each is a TmMachine (tm_core.h) with
+// states 0 and 1, halt state 2, two symbols and every rule moving right, so
+// tm_run_ittm steps it; the head wraps to cell 0 at TAPE_LENGTH, and its
+// step count is both its personal step and its position on the unwrapped
+// tape. A machine whose loop is detected is marked halted with its Tape 4
+// bit clear. Everything a run changes lives here and in its arena, so runs
+// can sit side by side in one process.
+typedef struct {
+    int num_machines;
+    uint8_t exact;                                  // --exact: loops must be proven
+    Arena arena;                                    // Tapes and rule tables
+    TmMachine tm[MAX_MACHINES];                     // Tape 2: machine states
+    LoopHistory history[MAX_MACHINES];
+    uint8_t output_tape[MAX_MACHINES][WINDOW_SIZE]; // Tape 3: simulation window
+    uint8_t halt_set[(MAX_MACHINES / 8) + 1];       // Tape 4: halting set bitmap
+    ExactLoop exact_loop[MAX_MACHINES];             // --exact only
+    uint8_t from_db[MAX_MACHINES];                  // 1 when a machine's verdict came from the DB
+    HaltDB db;                                      // --db only
+    int db_hits, db_inserts;
+    int class_rep[MAX_MACHINES];                    // Lowest-numbered machine with the same trajectory
+    TraceStep trace[MAX_MACHINES][EXACT_MAX_STEPS]; // Steps of each class representative
+    Display display;                                // --live only
+    Breakpoints breaks;                             // --break, --run: where this run stops
+    int show_steps;                                 // Print this stage's steps (off with --live and between stops)
+    char break_reason[80];                          // First breakpoint hit this stage
+} IttmRun;
+
+// Cell c of machine m's tape (c < TAPE_LENGTH)
+uint8_t tape_read(const IttmRun *run, int m, uint32_t c) {
+    return tm_read(&run->tm[m], c);
+}
+
+// Cells of machine m's tape that hold the input: the head wraps at TAPE_LENGTH,
+// so cells allocated past it stay blank
+uint32_t tape_cells(const IttmRun *run, int m) {
+    return run->tm[m].length < TAPE_LENGTH ? run->tm[m].length : TAPE_LENGTH;
+}
+
+// The input tape is a loop: a head that steps off cell TAPE_LENGTH - 1 is back at cell 0
+void wrap_head(TmMachine *tm) {
+    if (tm->position == TAPE_LENGTH) tm->position = 0;
+}
+
+// Return the tapes of halted machines to the arena in one pass; nothing
+// reads a tape once its machine has a verdict
+void recycle_tapes(IttmRun *run) {
+    for (int m = 0; m < run->num_machines; m++) {
+        if (run->tm[m].halted && run->tm[m].cells) {
+            tm_free_tape(&run->tm[m]);
+            run->tm[m].length = 0;
+        }
+    }
+}
+
+// Set up each machine in state 0 at cell 0 of an input tape of all 0s, except Machine 9
+void initialize_tapes(IttmRun *run) {
+    for (int i = 0; i < run->num_machines; i++) {
+        tm_init(&run->tm[i], &run->arena, NUM_STATES - 1, NUM_SYMBOLS, 0, 0); // Blank
+        if (i == 9) tm_write(&run->tm[i], 1, 1); // Add a 1 for Machine 9 to trigger state transition
     }
-    printf("Tape 1: Blank input = %.50s...\n", tms[0].tape);
-    if (num_machines > 9) {
-        printf("Tape 1 (Machine 9) = %.50s...\n", tms[9].tape);
+    printf("Tape 1: Blank input = %.50s...\n", (char *)run->tm[0].cells);
+    if (run->num_machines > 9) {
+        printf("Tape 1 (Machine 9) = %.50s...\n", (char *)run->tm[9].cells);
     }
 }
 
 // Set up rules for machines (cycling through 20 balanced templates)
-void setup_rules(int num_machines) {
+void setup_rules(IttmRun *run) {
     // Define 20 balanced rule templates (10 looping, 10 halting)
     const Rule templates[20][NUM_STATES][NUM_SYMBOLS] = {
         // Machine 0: Loop (stay in state 0)
@@ -115,84 +262,961 @@ void setup_rules(int num_machines) {
         "Loop (write 0, cycle 0<->1)"
     };
 
-    // Initialize machines and copy rules
-    for (int i = 0; i < num_machines; i++) {
+    // Copy rules into the machines; the halt state's row is never read, so it has no entries
+    for (int i = 0; i < run->num_machines; i++) {
         int pat = i % 20;
-        tms[i].current_state = 0;
-        tms[i].tape_position = 0;
-        tms[i].halted = 0;
-        tms[i].halt_step = 0;
-        for (int j = 0; j < WINDOW_SIZE; j++) output_tape[i][j] = 0;
-        for (int s = 0; s < NUM_STATES; s++) {
+        for (int s = 0; s < NUM_STATES - 1; s++) {
             for (int sym = 0; sym < NUM_SYMBOLS; sym++) {
-                rule_table[i][s][sym] = templates[pat][s][sym];
+                Rule rule = templates[pat][s][sym];
+                tm_set_rule(&run->tm[i], s, sym, rule.write_symbol, 1, rule.next_state);
             }
         }
+        const TmRule *r = run->tm[i].rules;
         printf("Machine %d: Rules=[0->%d,%d] [1->%d,%d] [0->%d,%d] %s\n",
-               i, rule_table[i][0][0].write_symbol, rule_table[i][0][0].next_state,
-               rule_table[i][0][1].write_symbol, rule_table[i][0][1].next_state,
-               rule_table[i][1][0].write_symbol, rule_table[i][1][0].next_state,
-               descriptions[pat]);
+               i, r[0].write, r[0].next, r[1].write, r[1].next, r[2].write, r[2].next, descriptions[pat]);
     }
-    memset(halt_set, 0, sizeof(halt_set));
     printf("Rule generation completed for all machines.\n");
 }
 
 // Check for loops in Tape 3 and state periodicity
-int detect_loop(int machine_idx, uint32_t step) {
-    // Update state buffer
-    static uint8_t past_states[MAX_MACHINES][WINDOW_SIZE];
-    static uint32_t state_steps[MAX_MACHINES][WINDOW_SIZE];
-    past_states[machine_idx][(step - 1) % WINDOW_SIZE] = tms[machine_idx].current_state;
-    state_steps[machine_idx][(step - 1) % WINDOW_SIZE] = step;
+// Both histories are shift registers, so period p holds when the newest p
+// entries equal the p entries before them: one xor and mask per period.
+int detect_loop(IttmRun *run, int machine_idx, uint32_t step) {
+    LoopHistory *tm = &run->history[machine_idx];
+    // Update state history
+    tm->state_history = (tm->state_history << STATE_BITS) | run->tm[machine_idx].state;
 
     if (step < MAX_PERSONAL_STEPS) return 0; // Threshold for loop detection
-    // Check Tape 3 periodicity
     for (int period = 1; period <= WINDOW_SIZE / 2; period++) {
-        int is_loop = 1;
-        for (int i = 0; i < period; i++) {
-            int idx1 = (step - i - 1) % WINDOW_SIZE;
-            int idx2 = (step - i - 1 - period) % WINDOW_SIZE;
-            if (output_tape[machine_idx][idx1] != output_tape[machine_idx][idx2]) {
-                is_loop = 0;
+        // Check Tape 3 periodicity
+        uint32_t write_mask = (1u << period) - 1;
+        if (((tm->write_history ^ (tm->write_history >> period)) & write_mask) == 0) return 1;
+        // Check state periodicity
+        int shift = period * STATE_BITS;
+        uint64_t state_mask = (1ULL << shift) - 1;
+        if (((tm->state_history ^ (tm->state_history >> shift)) & state_mask) == 0) return 1;
+    }
+    return 0;
+}
+
+// Pack a machine's tape into a bitset
+void pack_tape(const IttmRun *run, int m, uint8_t *bits) {
+    memset(bits, 0, (TAPE_LENGTH + 7) / 8);
+    for (uint32_t c = 0; c < tape_cells(run, m); c++) {
+        bits[c / 8] |= run->tm[m].cells[c] << (c % 8);
+    }
+}
+
+// Remember the machine's current configuration as the Brent snapshot
+void take_snapshot(IttmRun *run, int m) {
+    ExactLoop *e = &run->exact_loop[m];
+    e->snap_hash = e->tape_hash;
+    e->snap_state = run->tm[m].state;
+    e->snap_pos = run->tm[m].position;
+    pack_tape(run, m, e->snap_tape);
+}
+
+// Set up Zobrist keys (tm_mix64 of a Weyl sequence); they never change between runs
+void init_tape_keys() {
+    uint64_t seed = 0;
+    for (int c = 0; c < TAPE_LENGTH; c++) {
+        tape_keys[c] = tm_mix64(seed += 0x9E3779B97F4A7C15ULL);
+    }
+}
+
+// Zobrist hash of a machine's tape
+uint64_t hash_tape(const IttmRun *run, int m) {
+    uint64_t h = 0;
+    for (uint32_t c = 0; c < tape_cells(run, m); c++) {
+        if (run->tm[m].cells[c]) h ^= tape_keys[c];
+    }
+    return h;
+}
+
+// Set up each machine's tape hash and first snapshot
+void init_exact(IttmRun *run) {
+    for (int m = 0; m < run->num_machines; m++) {
+        ExactLoop *e = &run->exact_loop[m];
+        e->tape_hash = hash_tape(run, m);
+        e->power = 1;
+        e->lambda = 0;
+        e->heuristic_step = 0;
+        e->proof_step = 0;
+        take_snapshot(run, m);
+    }
+    printf("Exact loop detection enabled (stage cap %d).\n", EXACT_MAX_STEPS);
+}
+
+// Check whether the machine is back at its snapshot configuration
+// Brent's algorithm: the snapshot moves forward at doubling intervals, so any
+// cycle is found within a few multiples of its length once it is entered.
+int exact_loop(IttmRun *run, int m, uint32_t step) {
+    ExactLoop *e = &run->exact_loop[m];
+    if (run->tm[m].state == e->snap_state && run->tm[m].position == e->snap_pos &&
+        e->tape_hash == e->snap_hash) {
+        uint8_t bits[(TAPE_LENGTH + 7) / 8];
+        pack_tape(run, m, bits);
+        if (memcmp(bits, e->snap_tape, sizeof(bits)) == 0) {
+            e->proof_step = step;
+            return 1;
+        }
+    }
+    if (++e->lambda == e->power) {
+        take_snapshot(run, m);
+        e->power *= 2;
+        e->lambda = 0;
+    }
+    return 0;
+}
+
+// Open the DB file with an exclusive lock, held until it is closed, so runs
+// sharing a DB take turns. A run that grew the DB while this one waited has
+// renamed a new file over the path, so the lock is taken again on that one.
+int db_open_locked(const char *path) {
+    for (;;) {
+        int fd = open(path, O_RDWR | O_CREAT, 0644);
+        if (fd < 0) return -1;
+        if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+            printf("Halting DB %s is in use by another run; waiting...\n", path);
+            fflush(stdout);
+            if (flock(fd, LOCK_EX) != 0) {
+                close(fd);
+                return -1;
+            }
+        }
+        struct stat held, current;
+        if (fstat(fd, &held) == 0 && stat(path, &current) == 0 &&
+            held.st_dev == current.st_dev && held.st_ino == current.st_ino) return fd;
+        close(fd);
+    }
+}
+
+// Map the DB file, creating it with capacity slots if it is empty
+int db_map(HaltDB *db, const char *path, uint64_t capacity) {
+    db->fd = db_open_locked(path);
+    if (db->fd < 0) {
+        perror(path);
+        return 0;
+    }
+    struct stat st;
+    fstat(db->fd, &st);
+    int fresh = st.st_size == 0;
+    if (fresh && ftruncate(db->fd, sizeof(HaltDBHeader) + capacity * sizeof(HaltRecord)) != 0) {
+        perror(path);
+        close(db->fd);
+        return 0;
+    }
+    if (!fresh) {
+        HaltDBHeader h;
+        if (pread(db->fd, &h, sizeof(h), 0) != sizeof(h) || memcmp(h.magic, DB_MAGIC, 8) != 0 ||
+            (uint64_t)st.st_size != sizeof(HaltDBHeader) + h.capacity * sizeof(HaltRecord)) {
+            printf("%s is not a halting DB of this version.\n", path);
+            close(db->fd);
+            return 0;
+        }
+        capacity = h.capacity;
+    }
+    db->header = mmap(NULL, sizeof(HaltDBHeader) + capacity * sizeof(HaltRecord),
+                      PROT_READ | PROT_WRITE, MAP_SHARED, db->fd, 0);
+    if (db->header == MAP_FAILED) {
+        perror(path);
+        close(db->fd);
+        db->header = NULL;
+        return 0;
+    }
+    db->slots = (HaltRecord *)(db->header + 1);
+    if (fresh) {
+        memcpy(db->header->magic, DB_MAGIC, 8);
+        db->header->capacity = capacity;
+        db->header->count = 0;
+    }
+    return 1;
+}
+
+void db_unmap(HaltDB *db) {
+    munmap(db->header, sizeof(HaltDBHeader) + db->header->capacity * sizeof(HaltRecord));
+    close(db->fd);
+    db->header = NULL;
+}
+
+// Slot holding the record's key, or the empty slot where it belongs (linear probing)
+HaltRecord *db_probe(const HaltDB *db, const HaltRecord *r) {
+    uint64_t mask = db->header->capacity - 1;
+    for (uint64_t i = r->key & mask;; i = (i + 1) & mask) {
+        HaltRecord *slot = &db->slots[i];
+        if (slot->key == 0) return slot;
+        if (slot->key == r->key && slot->tape_hash == r->tape_hash && slot->start_pos == r->start_pos &&
+            slot->rules == r->rules && slot->decider == r->decider) return slot;
+    }
+}
+
+// Double the table: rehash every record into a new file, then swap it in.
+// The old file stays locked until the new one has replaced it, so a run
+// waiting on it finds the new file when it gets the lock.
+int db_grow(HaltDB *db) {
+    char tmp[4096];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", db->path);
+    unlink(tmp);
+    HaltDB old = *db;
+    if (!db_map(db, tmp, old.header->capacity * 2)) {
+        *db = old;
+        return 0;
+    }
+    for (uint64_t i = 0; i < old.header->capacity; i++) {
+        if (old.slots[i].key) *db_probe(db, &old.slots[i]) = old.slots[i];
+    }
+    db->header->count = old.header->count;
+    int renamed = rename(tmp, db->path) == 0;
+    db_unmap(&old);
+    return renamed;
+}
+
+// Rules for states 0 and 1, 3 bits (write, next) each; the halt state's row is never read
+uint16_t pack_rules(const IttmRun *run, int m) {
+    uint16_t bits = 0;
+    for (int s = 0; s < 2; s++) {
+        for (int sym = 0; sym < NUM_SYMBOLS; sym++) {
+            const TmRule *rule = tm_rule(&run->tm[m], s, sym);
+            bits |= (rule->write | rule->next << 1) << (3 * (s * NUM_SYMBOLS + sym));
+        }
+    }
+    return bits;
+}
+
+// Fill in a machine's key fields; the key hashes them all
+void db_key(const IttmRun *run, int m, HaltRecord *r) {
+    memset(r, 0, sizeof(*r));
+    r->tape_hash = hash_tape(run, m);
+    r->start_pos = run->tm[m].position;
+    r->rules = pack_rules(run, m);
+    r->decider = run->exact ? DECIDER_EXACT : DECIDER_HEURISTIC;
+    uint64_t h = tm_mix64(r->tape_hash ^ tm_mix64(r->start_pos ^ (uint64_t)r->rules << 32 ^ (uint64_t)r->decider << 48));
+    r->key = h ? h : 1;
+}
+
+// Look every machine up before simulating; a hit restores its final row
+void db_lookup(IttmRun *run) {
+    for (int m = 0; m < run->num_machines; m++) {
+        HaltRecord key;
+        db_key(run, m, &key);
+        HaltRecord *r = db_probe(&run->db, &key);
+        if (r->key == 0) continue;
+        run->from_db[m] = 1;
+        run->db_hits++;
+        run->tm[m].halted = 1;
+        run->tm[m].steps = r->halt_step;
+        run->tm[m].state = r->final_state;
+        run->tm[m].position = r->final_pos % TAPE_LENGTH;
+        for (int j = 0; j < WINDOW_SIZE; j++) run->output_tape[m][j] = (r->window >> j) & 1;
+        if (r->verdict == VERDICT_HALT) run->halt_set[m / 8] |= (1 << (m % 8));
+        if (run->exact) {
+            run->exact_loop[m].heuristic_step = r->heuristic_step;
+            run->exact_loop[m].proof_step = (r->verdict == VERDICT_LOOP) ? r->halt_step : 0;
+        }
+    }
+}
+
+// Insert the verdicts reached in this run; keys were computed from the
+// machines' starting configurations, saved in start before simulating
+void db_insert(IttmRun *run, const HaltRecord *start) {
+    for (int m = 0; m < run->num_machines; m++) {
+        if (run->from_db[m] || !run->tm[m].halted) continue;
+        if (2 * (run->db.header->count + 1) > run->db.header->capacity && !db_grow(&run->db)) {
+            printf("Halting DB: could not grow %s, %d verdicts not saved.\n", run->db.path, run->num_machines - m);
+            return;
+        }
+        HaltRecord *r = db_probe(&run->db, &start[m]);
+        if (r->key) continue; // Same machine earlier in this run
+        *r = start[m];
+        r->verdict = ((run->halt_set[m / 8] >> (m % 8)) & 1) ? VERDICT_HALT : VERDICT_LOOP;
+        r->final_state = run->tm[m].state;
+        r->halt_step = run->tm[m].steps;
+        r->final_pos = r->start_pos + run->tm[m].steps; // The head's position on the unwrapped tape
+        for (int j = 0; j < WINDOW_SIZE; j++) r->window |= (uint32_t)run->output_tape[m][j] << j;
+        if (run->exact) r->heuristic_step = run->exact_loop[m].heuristic_step;
+        run->db.header->count++;
+        run->db_inserts++;
+    }
+}
+
+// Whether two machines' tapes hold the same cells (unallocated cells are blank)
+int tapes_equal(const IttmRun *run, int a, int b) {
+    for (uint32_t c = 0; c < tape_cells(run, a) || c < tape_cells(run, b); c++) {
+        if (tape_read(run, a, c) != tape_read(run, b, c)) return 0;
+    }
+    return 1;
+}
+
+// Group machines into classes with identical rules, input tape and start position
+void find_classes(IttmRun *run) {
+    for (int m = 0; m < run->num_machines; m++) {
+        run->class_rep[m] = m;
+        for (int r = 0; r < m; r++) {
+            if (run->class_rep[r] == r && pack_rules(run, r) == pack_rules(run, m) &&
+                run->tm[r].position == run->tm[m].position &&
+                tapes_equal(run, r, m)) {
+                run->class_rep[m] = r;
                 break;
             }
         }
-        if (is_loop) return 1;
     }
-    // Check state periodicity
-    for (int period = 1; period <= WINDOW_SIZE / 2; period++) {
-        int is_loop = 1;
-        for (int i = 0; i < period; i++) {
-            int idx1 = (step - i - 1) % WINDOW_SIZE;
-            int idx2 = (step - i - 1 - period) % WINDOW_SIZE;
-            if (past_states[machine_idx][idx1] != past_states[machine_idx][idx2]) {
-                is_loop = 0;
+}
+
+// Limit stages (--limit=K): runs continue through ω, ω+1, ..., up to ω·K.
+// Between limits a machine runs until it halts or provably repeats a
+// configuration (Brent, as in --exact). Once it repeats, every stage below
+// the next limit lies in that cycle, so a cell's limsup is 1 exactly when the
+// cell holds 1 somewhere in the cycle: the snapshot tape OR'd with the cells
+// written 1 since the snapshot. The limit configuration is that tape, head at
+// cell 0, LIMIT_STATE. A limit configuration seen before means the stages
+// after it repeat those after the earlier one, so the machine does not halt
+// at any stage below ω². Stage ω² itself and later ones, whose limit is taken
+// over the limit stages, are not modelled, so this is no verdict about them.
+#define LIMIT_HALT 1      // Halted at stage ω·limits + steps
+#define LIMIT_REPEAT 2    // Limit configuration at ω·limits equals the one at ω·repeat_of
+#define LIMIT_UNDECIDED 3 // No halt or repeat within LIMIT_MAX_STEPS after ω·limits
+#define LIMIT_REACHED 4   // Still running at ω·K
+
+typedef struct {
+    uint8_t verdict;
+    uint32_t limits;    // Limit stages passed
+    uint32_t steps;     // Steps after the last limit
+    uint32_t repeat_of; // LIMIT_REPEAT: earlier limit with the same configuration
+    uint32_t cycle;     // Length of the last cycle that produced a limit
+} LimitResult;
+
+uint32_t limit_stages = 0; // --limit=K; 0 runs the finite stages
+
+// Run machine m from its initial configuration through at most max_limits limits
+void run_limits(const IttmRun *run, int m, uint32_t max_limits, LimitResult *res) {
+    const TmMachine *t = &run->tm[m];
+    uint64_t tape[TAPE_WORDS] = {0}, snap[TAPE_WORDS], ones[TAPE_WORDS];
+    uint64_t seen[MAX_LIMITS + 1][TAPE_WORDS]; // Tape at each limit
+    uint64_t hash = 0;
+    for (uint32_t c = 0; c < tape_cells(run, m); c++) {
+        if (t->cells[c]) {
+            tape[c / 64] |= 1ULL << (c % 64);
+            hash ^= tape_keys[c];
+        }
+    }
+    uint8_t state = t->state;
+    uint32_t pos = t->position;
+    memset(res, 0, sizeof(*res));
+    for (uint32_t k = 0;; k++) {
+        res->limits = k;
+        // Successor stages: Brent cycle search, collecting cells written 1 since the snapshot
+        uint8_t snap_state = state;
+        uint32_t snap_pos = pos, power = 1, lambda = 0;
+        uint64_t snap_hash = hash;
+        memcpy(snap, tape, sizeof(tape));
+        memset(ones, 0, sizeof(ones));
+        int cycled = 0;
+        for (uint32_t step = 1; step <= LIMIT_MAX_STEPS; step++) {
+            uint64_t bit = 1ULL << (pos % 64);
+            uint8_t symbol = (tape[pos / 64] & bit) != 0;
+            const TmRule *r = tm_rule(t, state, symbol);
+            if (r->write != symbol) {
+                tape[pos / 64] ^= bit;
+                hash ^= tape_keys[pos];
+            }
+            if (r->write) ones[pos / 64] |= bit;
+            state = r->next;
+            pos = (pos + 1 == TAPE_LENGTH) ? 0 : pos + 1;
+            if (state == 2) {
+                res->verdict = LIMIT_HALT;
+                res->steps = step;
+                return;
+            }
+            if (state == snap_state && pos == snap_pos && hash == snap_hash &&
+                memcmp(tape, snap, sizeof(tape)) == 0) {
+                res->cycle = lambda + 1;
+                cycled = 1;
                 break;
             }
+            if (++lambda == power) {
+                snap_state = state;
+                snap_pos = pos;
+                snap_hash = hash;
+                memcpy(snap, tape, sizeof(tape));
+                memset(ones, 0, sizeof(ones));
+                power *= 2;
+                lambda = 0;
+            }
+        }
+        if (!cycled) {
+            res->verdict = LIMIT_UNDECIDED;
+            res->steps = LIMIT_MAX_STEPS;
+            return;
+        }
+        if (k == max_limits) { // Reached ω·K: the configuration there is not needed
+            res->verdict = LIMIT_REACHED;
+            return;
+        }
+        // Limit stage ω·(k+1): limsup of every cell, head to 0, limit state
+        hash = 0;
+        for (int w = 0; w < TAPE_WORDS; w++) {
+            tape[w] = snap[w] | ones[w];
+            for (uint64_t bits = tape[w]; bits; bits &= bits - 1) {
+                hash ^= tape_keys[w * 64 + __builtin_ctzll(bits)];
+            }
+        }
+        state = LIMIT_STATE;
+        pos = 0;
+        memcpy(seen[k + 1], tape, sizeof(tape));
+        for (uint32_t j = 1; j <= k; j++) {
+            if (memcmp(seen[j], tape, sizeof(tape)) == 0) {
+                res->verdict = LIMIT_REPEAT;
+                res->limits = k + 1;
+                res->repeat_of = j;
+                return;
+            }
         }
-        if (is_loop) return 1;
     }
-    return 0;
+}
+
+// Format an ordinal stage ω·k + n as w*k+n
+void format_stage(char *buf, uint32_t limits, uint32_t steps) {
+    if (limits == 0) sprintf(buf, "%u", steps);
+    else if (limits == 1) sprintf(buf, steps ? "w+%u" : "w", steps);
+    else sprintf(buf, steps ? "w*%u+%u" : "w*%u", limits, steps);
+}
+
+// Run every machine through the limit stages and report where each ends up
+void simulate_limits(IttmRun *run, uint32_t max_limits) {
+    struct timespec t0, t1;
+    LimitResult results[MAX_MACHINES];
+    uint64_t limits_passed = 0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int m = 0; m < run->num_machines; m++) {
+        if (run->class_rep[m] != m) results[m] = results[run->class_rep[m]];
+        else run_limits(run, m, max_limits, &results[m]);
+        limits_passed += results[m].limits;
+        if (results[m].verdict == LIMIT_HALT) run->halt_set[m / 8] |= (1 << (m % 8));
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+    printf("Limit stages up to w*%u (cells take their limsup, head to 0, state %d):\n",
+           max_limits, LIMIT_STATE);
+    printf("%-8s %-10s %-12s %s\n", "Machine", "Verdict", "Stage", "Cycle");
+    for (int m = 0; m < run->num_machines; m++) {
+        LimitResult *r = &results[m];
+        char stage[40], other[40];
+        const char *verdict = "halts";
+        format_stage(stage, r->limits, r->steps);
+        if (r->verdict == LIMIT_REPEAT) {
+            verdict = "repeats";
+            format_stage(other, r->repeat_of, 0);
+            strcat(stage, " = ");
+            strcat(stage, other);
+        } else if (r->verdict == LIMIT_UNDECIDED) {
+            verdict = "undecided";
+            strcat(stage, "+");
+        } else if (r->verdict == LIMIT_REACHED) {
+            verdict = "running";
+        }
+        if (r->cycle) sprintf(other, "%u", r->cycle);
+        else strcpy(other, "-");
+        printf("%-8d %-10s %-12s %s\n", m, verdict, stage, other);
+    }
+    printf("%llu limit stages in %.3f ms (%.0f per second)\n", (unsigned long long)limits_passed,
+           secs * 1e3, secs > 0 ? limits_passed / secs : 0.0);
+}
+
+// Loaded machines (--load=FILE): full single-tape machines as exported by the
+// tm_* programs (--export=FILE), with any number of states and symbols,
+// left/stay/right moves and a two-way tape that grows on demand (TmMachine,
+// tm_core.h). They run under the same dovetail schedule, machine m starting
+// at stage m + 1, each through the tm_core kernel specialised for its symbol
+// count and moves, and set their bit in a Tape 4 sized to the population.
+// Tapes and rule tables come from one arena, so a population costs a few
+// large blocks.
+const char *load_files[MAX_LOAD_FILES];
+int num_load_files = 0;
+uint32_t load_copies = 1;    // --copies=N: load every machine N times (scaling runs)
+uint64_t stage_limit = 0;    // --stages=N: stage or step budget for --load and --enumerate; 0 keeps each mode's default
+const char *snapshot_prefix = NULL; // --snapshot=PREFIX: each loaded machine's whole tape to PREFIX-M.tmsnap
+
+// Shards (--shard=I/N, --results=FILE): separate processes, on one box or
+// many, each take a fixed share of the machines and write a sorted result
+// file (tm_results.h), and tm_results merge combines the files into the one
+// an unsharded run writes. Under --enumerate the tree's nodes at depth
+// --split=D are dealt out in enumeration order (tm_enum.h). Under --load a
+// machine goes to the shard whose range of the 64-bit hash space holds the
+// hash of its rule table, so copies of a rule table stay together; every
+// shard reads the whole population, so each machine keeps its index and
+// start stage, and the file records the population's fingerprint.
+uint32_t shard_index = 0, num_shards = 1;
+int split_depth = ENUMERATE_SPLIT_DEPTH;
+const char *results_path = NULL;
+
+// One run of loaded machines (this shard's share); everything it changes
+// lives here and in its arena
+typedef struct {
+    Arena arena;                 // Tapes and rule tables
+    TmMachine *machines;
+    TmKernel *kernels;           // Kernel each machine runs on
+    uint32_t num_machines, capacity;
+    uint8_t *halt_set;           // Tape 4 for loaded machines
+    uint64_t *index;             // Population index of each machine this shard runs
+    uint64_t *marks;             // Nonblank cells at the end, kept for --results
+    uint64_t num_population, fingerprint;
+} LoadRun;
+
+// Hash of a machine's rule table, and with tape, head and state folded in, of the whole machine
+uint64_t general_hash(const TmMachine *g, uint64_t *machine) {
+    uint64_t h = tm_mix64(g->num_states | (uint64_t)g->num_symbols << 16);
+    for (int i = 0; i < g->num_states * g->num_symbols; i++) {
+        h = tm_mix64(h ^ (g->rules[i].write | (uint64_t)(uint8_t)g->rules[i].move << 8 | (uint64_t)g->rules[i].next << 16));
+    }
+    *machine = tm_mix64(h ^ g->state);
+    for (uint64_t c = 0; c < g->length; c++) {
+        if (g->cells[c]) *machine = tm_mix64(*machine ^ ((uint64_t)(g->origin + (int64_t)c - g->position) << 8 | g->cells[c]));
+    }
+    return h;
+}
+
+// Nonblank cells of a loaded machine's tape
+uint64_t general_marks_of(const TmMachine *g) {
+    uint64_t marks = 0;
+    for (uint64_t c = 0; c < g->length; c++) marks += g->cells[c] != 0;
+    return marks;
+}
+
+// Load every machine of every --load file, load_copies times over (those of this shard)
+int load_general(LoadRun *run) {
+    for (int i = 0; i < num_load_files; i++) {
+        FILE *f = fopen(load_files[i], "r");
+        if (!f) {
+            perror(load_files[i]);
+            return 0;
+        }
+        TmMachine g;
+        int r, loaded = 0;
+        while ((r = tm_read_text(f, &g, &run->arena)) == 1) {
+            TmKernel kernel = tm_kernel(&g);
+            uint64_t machine, rules = general_hash(&g, &machine);
+            uint32_t shard = (uint32_t)(((unsigned __int128)rules * num_shards) >> 64);
+            for (uint32_t c = 0; c < load_copies; c++) run->fingerprint = tm_mix64(run->fingerprint ^ machine);
+            run->num_population += load_copies;
+            loaded++;
+            if (shard != shard_index) { // Another shard's: only its index was needed
+                tm_free_tape(&g);
+                arena_free(&run->arena, g.rules, (size_t)g.num_states * g.num_symbols * sizeof(TmRule));
+                continue;
+            }
+            for (uint32_t c = 0; c < load_copies; c++) {
+                if (run->num_machines == run->capacity) {
+                    run->capacity = run->capacity ? run->capacity * 2 : 1024;
+                    run->machines = realloc(run->machines, run->capacity * sizeof(TmMachine));
+                    run->kernels = realloc(run->kernels, run->capacity * sizeof(TmKernel));
+                    run->index = realloc(run->index, run->capacity * sizeof(uint64_t));
+                }
+                run->machines[run->num_machines] = g;
+                run->index[run->num_machines] = run->num_population - load_copies + c;
+                run->kernels[run->num_machines] = kernel;
+                if (c > 0) { // Each copy gets its own tape (in the arena, even for a tape file); rules are shared
+                    run->machines[run->num_machines].cells = arena_alloc(&run->arena, g.length);
+                    run->machines[run->num_machines].mapped = 0;
+                    memcpy(run->machines[run->num_machines].cells, g.cells, g.length);
+                }
+                run->num_machines++;
+            }
+        }
+        fclose(f);
+        if (r < 0) {
+            printf("%s: malformed machine after %d loaded.\n", load_files[i], loaded);
+            return 0;
+        }
+        printf("Loaded %d machines from %s\n", loaded, load_files[i]);
+    }
+    run->halt_set = arena_alloc(&run->arena, run->num_machines / 8 + 1);
+    if (num_shards > 1) printf("Shard %u/%u: %u of %llu machines\n", shard_index, num_shards, run->num_machines,
+                               (unsigned long long)run->num_population);
+    return run->num_machines > 0 || num_shards > 1; // A shard may be dealt nothing
+}
+
+// The shard's verdicts, by population index: halted, or undecided at the last stage
+int write_general_results(const LoadRun *run, uint64_t max_stages) {
+    TmResWriter w;
+    TmResHeader h = {TM_RES_LOAD, 0, 0, max_stages, run->num_population, run->fingerprint, shard_index, num_shards, 0};
+    if (!tm_res_create(&w, results_path, &h)) return 0;
+    for (uint32_t m = 0; m < run->num_machines; m++) {
+        TmResRecord r;
+        tm_res_index_key(run->index[m], r.key);
+        r.verdict = run->machines[m].halted ? TM_RES_HALTS : TM_RES_UNDECIDED;
+        r.steps = run->machines[m].steps;
+        r.marks = run->marks[m];
+        tm_res_put(&w, &r, NULL);
+    }
+    if (!tm_res_close(&w)) {
+        perror(results_path);
+        return 0;
+    }
+    printf("Results: %u machines in %s\n", run->num_machines, results_path);
+    return 1;
+}
+
+// A loaded machine's tape as a snapshot (tm_snapshot.h), when it halts or at the last stage
+void save_general_snapshot(const LoadRun *run, uint32_t m) {
+    char path[4096];
+    snprintf(path, sizeof(path), "%s-%u.tmsnap", snapshot_prefix, m);
+    tm_snap_save(path, &run->machines[m]);
+}
+
+// Dovetail the loaded machines: stage s steps every running machine below s.
+// Running machines are kept in a list that halted ones leave by swap, so a
+// stage costs one step per running machine.
+void simulate_general(LoadRun *run) {
+    uint64_t max_stages = stage_limit ? stage_limit : MAX_STEPS, stage;
+    uint32_t *running = malloc((run->num_machines + 1) * sizeof(uint32_t));
+    uint32_t num_running = 0, started = 0, halts = 0;
+    uint64_t steps = 0;
+    struct timespec t0, t1;
+    if (results_path) run->marks = calloc(run->num_machines + 1, sizeof(uint64_t));
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (stage = 1; stage <= max_stages; stage++) {
+        if (started < run->num_machines && run->index[started] < stage) { // Machine stage - 1 joins (if in this shard)
+            if (run->machines[started].halted) {
+                run->halt_set[started / 8] |= (1 << (started % 8));
+                if (run->marks) run->marks[started] = general_marks_of(&run->machines[started]);
+                halts++;
+            } else {
+                running[num_running++] = started;
+            }
+            started++;
+        }
+        for (uint32_t i = 0; i < num_running;) {
+            uint32_t m = running[i];
+            steps++;
+            run->kernels[m](&run->machines[m], 1);
+            if (run->machines[m].halted) {
+                run->halt_set[m / 8] |= (1 << (m % 8));
+                halts++;
+                if (snapshot_prefix) save_general_snapshot(run, m);
+                if (run->marks) run->marks[m] = general_marks_of(&run->machines[m]);
+                tm_free_tape(&run->machines[m]); // Tape is done with
+                running[i] = running[--num_running];
+            } else {
+                i++;
+            }
+        }
+        if (started == run->num_machines && num_running == 0) break;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+    if (snapshot_prefix) { // Machines still running, and any that started halted
+        for (uint32_t m = 0; m < run->num_machines; m++) {
+            if (run->machines[m].cells) save_general_snapshot(run, m);
+        }
+        printf("Tapes written to %s-M.tmsnap\n", snapshot_prefix);
+    }
+    if (run->marks) { // Machines still running keep their tapes
+        for (uint32_t m = 0; m < run->num_machines; m++) {
+            if (!run->machines[m].halted) run->marks[m] = general_marks_of(&run->machines[m]);
+        }
+    }
+    printf("Final Loaded Machine States:\n");
+    printf("%-8s %-7s %-8s %-6s %-8s %-5s %-10s %s\n",
+           "Machine", "States", "Symbols", "State", "Pos", "Done", "HaltStep", "Cells");
+    for (uint32_t m = 0; m < run->num_machines && m < GENERAL_ROWS_SHOWN; m++) {
+        TmMachine *g = &run->machines[m];
+        printf("%-8u %-7u %-8u %-6u %-8lld %-5d %-10llu %llu\n", m, g->num_states, g->num_symbols,
+               g->state, (long long)g->position, g->halted, (unsigned long long)g->steps, (unsigned long long)g->length);
+    }
+    if (run->num_machines > GENERAL_ROWS_SHOWN) printf("... %u more machines\n", run->num_machines - GENERAL_ROWS_SHOWN);
+    printf("Tape 4 (1=halted):\n");
+    for (uint32_t m = 0; m < run->num_machines && m < GENERAL_ROWS_SHOWN; m++) {
+        printf("%d", (run->halt_set[m / 8] >> (m % 8)) & 1);
+        if (m % 8 == 7) printf(" ");
+    }
+    printf("\nHalted: %u/%u after %llu stages\n", halts, run->num_machines,
+           (unsigned long long)(stage > max_stages ? max_stages : stage));
+    printf("%llu steps in %.3f s (%.0f steps/s), arena %zu KiB for tapes and rules\n",
+           (unsigned long long)steps, secs, secs > 0 ? steps / secs : 0.0, run->arena.reserved / 1024);
+}
+
+// Loaded machines under the hashlife engine (--load=FILE --hashlife[=CACHE]):
+// each machine runs on its own to a halt, a proven loop or the step budget
+// (--stages=N, checked between top-level runs), with its tape as a tree of
+// hash-consed segments and runs across segments memoized (tm_hashlife.h).
+// CACHE caps the memo entries per machine.
+int hashlife_mode = 0;
+uint64_t hashlife_cache = 0; // 0 = TM_HL_MEMO_DEFAULT
+
+void simulate_hashlife(LoadRun *run) {
+    TmSteps budget = stage_limit ? stage_limit : HASHLIFE_MAX_STEPS;
+    uint32_t halts = 0, loops = 0;
+    uint64_t lookups = 0, hits = 0, flushes = 0;
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    printf("%-8s %-7s %-8s %-6s %-14s %-8s %-24s %-10s %s\n",
+           "Machine", "States", "Symbols", "State", "Pos", "Result", "Steps", "Marks", "Hits");
+    for (uint32_t m = 0; m < run->num_machines; m++) {
+        TmHashlife h;
+        char steps[40];
+        tm_hl_init(&h, &run->machines[m], hashlife_cache);
+        tm_hl_run_until(&h, budget);
+        halts += h.halted;
+        loops += h.looping;
+        lookups += h.lookups;
+        hits += h.hits;
+        flushes += h.flushes;
+        if (h.halted) run->halt_set[m / 8] |= (1 << (m % 8));
+        if (m < GENERAL_ROWS_SHOWN) {
+            printf("%-8u %-7u %-8u %-6u %-14lld %-8s %-24s %-10llu %.1f%%\n", m, h.num_states, h.num_symbols,
+                   h.state, (long long)h.position, h.halted ? "halted" : h.looping ? "loops" : "running",
+                   tm_hl_format_steps(steps, h.steps), (unsigned long long)tm_hl_marks(&h),
+                   h.lookups ? 100.0 * h.hits / h.lookups : 0.0);
+        }
+        tm_hl_free(&h);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+    if (run->num_machines > GENERAL_ROWS_SHOWN) printf("... %u more machines\n", run->num_machines - GENERAL_ROWS_SHOWN);
+    printf("Tape 4 (1=halted):\n");
+    for (uint32_t m = 0; m < run->num_machines && m < GENERAL_ROWS_SHOWN; m++) {
+        printf("%d", (run->halt_set[m / 8] >> (m % 8)) & 1);
+        if (m % 8 == 7) printf(" ");
+    }
+    printf("\nHalted: %u/%u, proven loops: %u, in %.3f s\n", halts, run->num_machines, loops, secs);
+    printf("Memo: %llu hits of %llu lookups (%.1f%%), %llu flushes\n", (unsigned long long)hits,
+           (unsigned long long)lookups, lookups ? 100.0 * hits / lookups : 0.0, (unsigned long long)flushes);
+}
+
+// Loaded machines on the exponent-notation tape (--load=FILE --exptape[=K]):
+// each machine runs on its own, on macro cells of K cells (default 1), with
+// runs of equal macro cells as big-integer counts, sweeps across whole runs
+// and proven shape rules applied in one operation (tm_exptape.h), to a halt,
+// a proof of non-halting or the macro-step budget (--stages=N). Steps and
+// marks are exact however large they get.
+int exptape_block = 0; // 0: --exptape not given
+
+void simulate_exptape(LoadRun *run) {
+    uint64_t budget = stage_limit ? stage_limit : EXPTAPE_MAX_MACRO_STEPS;
+    uint32_t halts = 0, infinite = 0;
+    uint64_t rules = 0, sweeps = 0;
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    printf("%-8s %-7s %-8s %-9s %-24s %-16s %s\n", "Machine", "States", "Symbols", "Result", "Steps", "Marks", "Rules");
+    for (uint32_t m = 0; m < run->num_machines; m++) {
+        TmExpTape e;
+        char steps[TM_BIG_DIGITS], marks[TM_BIG_DIGITS];
+        if (!tm_exp_init(&e, &run->machines[m], exptape_block)) {
+            printf("%-8u %u symbols ^ %d cells is too many macro cells\n", m, run->machines[m].num_symbols, exptape_block);
+            continue;
+        }
+        tm_exp_run(&e, budget);
+        halts += e.halted;
+        infinite += e.infinite;
+        rules += e.rules_proven;
+        sweeps += e.sweeps;
+        if (e.halted) run->halt_set[m / 8] |= (1 << (m % 8));
+        if (m < GENERAL_ROWS_SHOWN) {
+            printf("%-8u %-7u %-8u %-9s %-24s %-16s %llu\n", m, e.num_states, e.num_symbols,
+                   e.halted ? "halted" : e.infinite ? "infinite" : e.overflow ? "overflow" : "running",
+                   tm_big_format(steps, e.steps), tm_big_format(marks, tm_exp_marks(&e)),
+                   (unsigned long long)e.rules_proven);
+            printf("         ");
+            tm_exp_print(&e, stdout, EXPTAPE_RUNS_SHOWN);
+        }
+        tm_exp_free(&e);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+    if (run->num_machines > GENERAL_ROWS_SHOWN) printf("... %u more machines\n", run->num_machines - GENERAL_ROWS_SHOWN);
+    printf("Tape 4 (1=halted):\n");
+    for (uint32_t m = 0; m < run->num_machines && m < GENERAL_ROWS_SHOWN; m++) {
+        printf("%d", (run->halt_set[m / 8] >> (m % 8)) & 1);
+        if (m % 8 == 7) printf(" ");
+    }
+    printf("\nHalted: %u/%u, proven infinite: %u, in %.3f s\n", halts, run->num_machines, infinite, secs);
+    printf("Rules proven: %llu, sweeps: %llu\n", (unsigned long long)rules, (unsigned long long)sweeps);
+}
+
+// Nondeterministic machines (--explore=FILE): the --load format, where
+// several rules for one state and symbol are choices. The configuration
+// graph is explored breadth-first with every configuration kept once
+// (tm_nondet.h), so a level costs its new configurations rather than every
+// path to them. Halting is acceptance; the level it first happens at is the
+// acceptance depth.
+const char *explore_file = NULL;
+uint32_t explore_depth = EXPLORE_MAX_DEPTH; // --depth=N
+
+int explore_nondet() {
+    FILE *f = fopen(explore_file, "r");
+    if (!f) {
+        perror(explore_file);
+        return 0;
+    }
+    int r, index = 0;
+    TmNondet nd;
+    tm_nd_init(&nd);
+    while ((r = tm_nd_read_text(f, &nd)) == 1) {
+        TmConfig *frontier = malloc(sizeof(TmConfig)), *next = NULL;
+        uint64_t count = 1, capacity = 1, next_capacity = 0, total_generated = 0, accepted = 0;
+        uint32_t depth = 0;
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        printf("Machine %d: %u states, %u symbols, %u rules\n", index, nd.num_states, nd.num_symbols, nd.num_rules);
+        printf("%-7s %-12s %-12s %s\n", "Depth", "Frontier", "Generated", "Duplicates");
+        frontier[0] = nd.start;
+        tm_nd_insert(&nd, nd.start);
+        if (nd.start.state == nd.num_states) accepted = 1; // Starts halted
+        while (!accepted && count && depth < explore_depth) {
+            uint64_t generated = 0;
+            uint64_t added = tm_nd_expand(&nd, frontier, count, &next, &next_capacity, &generated, &accepted);
+            depth++;
+            total_generated += generated;
+            printf("%-7u %-12llu %-12llu %llu\n", depth, (unsigned long long)added, (unsigned long long)generated,
+                   (unsigned long long)(generated - added - accepted));
+            TmConfig *t = frontier; // The new level becomes the frontier; the old buffer is reused
+            frontier = next;
+            next = t;
+            uint64_t c = capacity;
+            capacity = next_capacity;
+            next_capacity = c;
+            count = added;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        double secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+        if (accepted) {
+            printf("Accepted at depth %u (%llu halting transitions)\n", depth, (unsigned long long)accepted);
+        } else if (!count) {
+            printf("Rejected: nothing new after depth %u and no branch halts\n", depth);
+        } else {
+            printf("Undecided after %u levels (%llu configurations on the frontier)\n", depth, (unsigned long long)count);
+        }
+        printf("%llu distinct configurations from %llu transitions, %u tape cells interned, %.3f s\n",
+               (unsigned long long)nd.num_seen, (unsigned long long)total_generated, nd.num_nodes - 1, secs);
+        free(frontier);
+        free(next);
+        tm_nd_free(&nd);
+        tm_nd_init(&nd);
+        index++;
+    }
+    tm_nd_free(&nd);
+    fclose(f);
+    if (r < 0) {
+        printf("%s: malformed machine after %d explored.\n", explore_file, index);
+        return 0;
+    }
+    return index > 0;
+}
+
+// Every blank-tape machine of one size in tree normal form (--enumerate=SxK,
+// --stages=N steps each): each child resumes from its parent's copy-on-write
+// snapshot at the entry it fills in (tm_enum.h). Prints the tree's verdicts
+// and the step and mark champions.
+int enumerate_states = 0, enumerate_symbols = 0;
+
+// A counted node into the --results file
+void record_node(void *arg, const TmEnum *en, const TmEnumNode *n, int result) {
+    TmResRecord r;
+    tm_res_enum_record(en, n, result, &r);
+    tm_res_put(arg, &r, n);
+}
+
+int enumerate_machines() {
+    if (enumerate_states < 1 || enumerate_symbols < 2 || enumerate_states * enumerate_symbols > TM_ENUM_MAX_ENTRIES) {
+        printf("--enumerate=SxK needs K >= 2 symbols and S * K <= %d entries.\n", TM_ENUM_MAX_ENTRIES);
+        return 0;
+    }
+    Arena arena = {0};
+    TmEnum en;
+    TmResWriter results;
+    char table[TM_ENUM_MAX_ENTRIES * 4 + 1];
+    struct timespec t0, t1;
+    tm_enum_init(&en, &arena, enumerate_states, enumerate_symbols, stage_limit ? stage_limit : ENUMERATE_MAX_STEPS);
+    en.shard = shard_index;
+    en.shards = num_shards;
+    en.split_depth = split_depth;
+    if (results_path) {
+        TmResHeader h = {TM_RES_ENUMERATE, enumerate_states, enumerate_symbols, en.max_steps, 0, 0, shard_index,
+                         num_shards, num_shards > 1 ? split_depth : 0};
+        if (!tm_res_create(&results, results_path, &h)) return 0;
+        en.record = record_node;
+        en.record_arg = &results;
+    }
+    printf("Enumerating %d-state %d-symbol machines, %llu steps each...\n", enumerate_states, enumerate_symbols,
+           (unsigned long long)en.max_steps);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    tm_enum_all(&en);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+    if (num_shards > 1) {
+        printf("Shard %u/%u: %llu of %llu nodes at depth %d\n", shard_index, num_shards,
+               (unsigned long long)((en.split_nodes + num_shards - 1 - shard_index) / num_shards),
+               (unsigned long long)en.split_nodes, split_depth);
+    }
+    printf("Nodes: %llu (halting %llu, runaway %llu, undecided %llu)\n", (unsigned long long)en.nodes,
+           (unsigned long long)en.halting, (unsigned long long)en.never_halts, (unsigned long long)en.undecided);
+    printf("Most steps: %llu  %s\n", (unsigned long long)en.best_steps,
+           tm_enum_format(table, en.best_steps_rules, en.num_states, en.num_symbols));
+    printf("Most marks: %llu  %s\n", (unsigned long long)en.best_marks,
+           tm_enum_format(table, en.best_marks_rules, en.num_states, en.num_symbols));
+    printf("%llu steps simulated, %llu resumed from parents, %llu pages copied, arena %zu KiB, %.3f s\n",
+           (unsigned long long)en.steps_run, (unsigned long long)en.steps_resumed, (unsigned long long)en.pages_copied,
+           arena.reserved / 1024, secs);
+    arena_free_all(&arena);
+    if (results_path) {
+        if (!tm_res_close(&results)) {
+            perror(results_path);
+            return 0;
+        }
+        printf("Results: %llu nodes in %s\n", (unsigned long long)results.counts.records, results_path);
+    }
+    return 1;
 }
 
 // Check if all machines are halted
-int all_machines_halted(int num_machines) {
-    for (int m = 0; m < num_machines; m++) {
-        if (!tms[m].halted) return 0;
+int all_machines_halted(const IttmRun *run) {
+    for (int m = 0; m < run->num_machines; m++) {
+        if (!run->tm[m].halted) return 0;
     }
     return 1;
 }
 
+// Live display (--live[=FPS]): the stages run without pauses or per-step
+// output, and a display thread shows snapshots of Tape 2/3/4 (tm_display.h)
+typedef struct {
+    uint8_t current_state;
+    uint8_t halted;
+    uint32_t tape_position;
+    uint32_t halt_step;
+    uint8_t window[WINDOW_SIZE]; // Tape 3
+} MachineRow;
+
+double live_fps = 0; // Frames per second; 0 keeps the step-by-step view
+
+// Breakpoints (--break=SPEC, --run): stages between stops run without output
+Breakpoints break_specs; // As given; each run stops on its own copy
+
 // Print aligned header for machine states
+void format_header(char *line) {
+    sprintf(line, "%-8s %-6s %-6s %-5s %-10s %s",
+            "Machine", "State", "Pos", "Done", "HaltStep", "Tape3");
+}
+
 void print_header() {
-    printf("%-8s %-6s %-6s %-5s %-10s %s\n",
-           "Machine", "State", "Pos", "Done", "HaltStep", "Tape3");
+    char line[DISPLAY_LINE];
+    format_header(line);
+    printf("%s\n", line);
 }
 
-// Print aligned row for a machine
-void print_machine_row(int i) {
-    int last_j = (tms[i].halt_step > 0) ? ((int)tms[i].halt_step - 1) % WINDOW_SIZE : -1;
+// Copy the displayed part of a machine (padding zeroed, so rows compare with memcmp)
+void snapshot_row(const IttmRun *run, int i, MachineRow *r) {
+    memset(r, 0, sizeof(*r));
+    r->current_state = run->tm[i].state;
+    r->halted = run->tm[i].halted;
+    r->tape_position = run->tm[i].steps; // One cell right per step on the unwrapped tape
+    r->halt_step = run->tm[i].steps;
+    memcpy(r->window, run->output_tape[i], WINDOW_SIZE);
+}
+
+// Format an aligned row for a machine
+void format_machine_row(const void *row, int i, char *line) {
+    const MachineRow *r = row;
+    int last_j = (r->halt_step > 0) ? ((int)r->halt_step - 1) % WINDOW_SIZE : -1;
     char tape_str[100]; // Buffer for Tape3 string
     int pos = sprintf(tape_str, "[");
     for (int j = 0; j < WINDOW_SIZE; j++) {
@@ -200,52 +1224,155 @@ void print_machine_row(int i) {
             pos += sprintf(tape_str + pos, ",");
         }
         if (last_j >= 0 && j == last_j) {
-            pos += sprintf(tape_str + pos, "[%d]", output_tape[i][j]); // Highlight with *
+            pos += sprintf(tape_str + pos, "[%d]", r->window[j]); // Highlight with *
         } else {
-            pos += sprintf(tape_str + pos, "%d", output_tape[i][j]);
+            pos += sprintf(tape_str + pos, "%d", r->window[j]);
         }
     }
     pos += sprintf(tape_str + pos, "]");
     tape_str[pos] = '\0';
 
-    printf("%-8d %-6d %-6u %-5d %-10u %s\n",
-           i, tms[i].current_state, tms[i].tape_position, tms[i].halted, tms[i].halt_step, tape_str);
+    sprintf(line, "%-8d %-6d %-6u %-5d %-10u %s",
+            i, r->current_state, r->tape_position, r->halted, r->halt_step, tape_str);
+}
+
+// Print aligned row for a machine
+void print_machine_row(const IttmRun *run, int i) {
+    MachineRow r;
+    char line[DISPLAY_LINE];
+    snapshot_row(run, i, &r);
+    format_machine_row(&r, i, line);
+    printf("%s\n", line);
+}
+
+// Hand the display a snapshot of every machine and Tape 4
+void publish_stage(IttmRun *run, uint32_t stage) {
+    MachineRow *rows = display_back(&run->display);
+    char status[DISPLAY_LINE];
+    int len = sprintf(status, "Stage %u  Tape 4: ", stage), halts = 0;
+    for (int i = 0; i < run->num_machines; i++) {
+        snapshot_row(run, i, &rows[i]);
+        int bit = (run->halt_set[i / 8] >> (i % 8)) & 1;
+        halts += bit;
+        len += sprintf(status + len, "%d", bit);
+    }
+    sprintf(status + len, "  Halted: %d/%d  (Enter pauses)", halts, run->num_machines);
+    display_publish(&run->display, status);
+}
+
+// Step a machine by replaying its class representative, which is always ahead
+// of it: it started at an earlier stage and takes one step per stage too
+void replay_step(IttmRun *run, int m, uint32_t personal_step, uint32_t stage) {
+    TmMachine *tm = &run->tm[m];
+    int r = run->class_rep[m];
+    TraceStep t = run->trace[r][personal_step - 1];
+    if (run->show_steps) {
+        printf("Machine %d: Personal step %u (global stage %u), Read %d, Write %d, Next State %d\n",
+               m, personal_step, stage, t.read, t.write, t.next);
+    }
+    run->output_tape[m][tm->steps % WINDOW_SIZE] = t.write;
+    run->history[m].write_history = (run->history[m].write_history << 1) | t.write;
+    tm_apply(tm, &(TmRule){t.write, 1, t.next});
+    wrap_head(tm);
+    if (run->exact && run->exact_loop[r].heuristic_step == personal_step) {
+        run->exact_loop[m].heuristic_step = personal_step;
+    }
+    if (run->tm[r].halted && run->tm[r].steps == personal_step) { // Same verdict at the same step
+        tm->halted = 1;
+        run->halt_set[m / 8] |= ((run->halt_set[r / 8] >> (r % 8)) & 1) << (m % 8);
+        if (run->exact) run->exact_loop[m].proof_step = run->exact_loop[r].proof_step;
+    }
+}
+
+// Note the first breakpoint machine m's step hit this stage
+void check_break(IttmRun *run, int m, uint32_t personal_step) {
+    if (run->break_reason[0]) return;
+    if (break_at(&run->breaks, BREAK_STEP, personal_step)) {
+        sprintf(run->break_reason, "machine %d reached step %u", m, personal_step);
+    } else if (break_at(&run->breaks, BREAK_STATE, run->tm[m].state)) {
+        sprintf(run->break_reason, "machine %d entered state %d", m, run->tm[m].state);
+    } else if (run->tm[m].halted && break_at(&run->breaks, BREAK_HALT, m)) {
+        sprintf(run->break_reason, "machine %d %s", m, (run->halt_set[m / 8] >> (m % 8)) & 1 ? "halted" : "looped");
+    }
 }
 
 // Simulate all machines in dovetailed fashion with pause after each stage
-void simulate(int num_machines) {
-    for (uint32_t stage = 1; stage <= MAX_STEPS; stage++) {
-        printf("Stage %u:\n", stage);
+// (or, with breakpoints, after the stages that hit one)
+void simulate(IttmRun *run) {
+    int num_machines = run->num_machines;
+    uint32_t max_stages = run->exact ? EXACT_MAX_STEPS : MAX_STEPS;
+    for (uint32_t stage = 1; stage <= max_stages; stage++) {
+        run->show_steps = !live_fps && break_showing(&run->breaks);
+        run->break_reason[0] = '\0';
+        if (run->show_steps) printf("Stage %u:\n", stage);
         // Perform one step for machines 0 to min(stage-1, num_machines-1)
         for (int m = 0; m < num_machines && m < stage; m++) {
-            if (tms[m].halted) continue;
-            uint32_t personal_step = tms[m].halt_step + 1;
-            uint8_t symbol = tms[m].tape[tms[m].tape_position % TAPE_LENGTH];
-            uint8_t write = rule_table[m][tms[m].current_state][symbol].write_symbol;
-            uint8_t next = rule_table[m][tms[m].current_state][symbol].next_state;
-            printf("Machine %d: Personal step %u (global stage %u), Read %d, Write %d, Next State %d\n",
-                   m, personal_step, stage, symbol, write, next);
+            TmMachine *tm = &run->tm[m];
+            if (tm->halted) continue;
+            uint32_t personal_step = tm->steps + 1;
+            if (run->class_rep[m] != m) {
+                replay_step(run, m, personal_step, stage);
+                if (run->breaks.enabled) check_break(run, m, personal_step);
+                continue;
+            }
+            uint8_t symbol = tm->cells[tm->position]; // The head's cell always exists
+            const TmRule *rule = tm_next_rule(tm);
+            uint8_t write = rule->write, next = rule->next;
+            run->trace[m][personal_step - 1] = (TraceStep){symbol, write, next};
+            if (run->show_steps) {
+                printf("Machine %d: Personal step %u (global stage %u), Read %d, Write %d, Next State %d\n",
+                       m, personal_step, stage, symbol, write, next);
+            }
             // Update circular window with this write
-            output_tape[m][tms[m].halt_step % WINDOW_SIZE] = write;
-            tms[m].tape[tms[m].tape_position % TAPE_LENGTH] = write;
-            tms[m].current_state = next;
-            tms[m].tape_position++;
-            tms[m].halt_step = personal_step;
-            if (next == 2 || (personal_step >= MAX_PERSONAL_STEPS && detect_loop(m, personal_step))) {
-                tms[m].halted = 1;
+            run->output_tape[m][tm->steps % WINDOW_SIZE] = write;
+            run->history[m].write_history = (run->history[m].write_history << 1) | write;
+            if (run->exact && symbol != write) {
+                run->exact_loop[m].tape_hash ^= tape_keys[tm->position];
+            }
+            tm_run_ittm(tm, 1);
+            wrap_head(tm);
+            // With --exact the heuristic verdict is only recorded for the report
+            int looped = 0;
+            if (next != 2 && personal_step >= MAX_PERSONAL_STEPS &&
+                !run->exact_loop[m].heuristic_step && detect_loop(run, m, personal_step)) {
+                if (run->exact) run->exact_loop[m].heuristic_step = personal_step;
+                else looped = 1;
+            }
+            if (run->exact && next != 2) looped = exact_loop(run, m, personal_step);
+            if (next == 2 || looped) {
+                tm->halted = 1;
                 if (next == 2) {
-                    halt_set[m / 8] |= (1 << (m % 8));
+                    run->halt_set[m / 8] |= (1 << (m % 8));
                 }
             }
+            if (run->breaks.enabled) check_break(run, m, personal_step);
+        }
+        recycle_tapes(run);
+        if (live_fps) { // Snapshot only when the display is ready for a frame
+            int finished = all_machines_halted(run) || stage == max_stages;
+            if (finished) display_wait(&run->display);
+            if (finished || display_due(&run->display)) publish_stage(run, stage);
+            if (finished) break;
+            continue;
+        }
+        if (!run->break_reason[0] && break_at(&run->breaks, BREAK_STAGE, stage)) sprintf(run->break_reason, "stage %u", stage);
+        if (!run->show_steps && !run->break_reason[0]) { // Running on to the next breakpoint
+            if (all_machines_halted(run)) break;
+            continue;
         }
+        if (run->break_reason[0] && !run->show_steps) printf("Break at stage %u: %s\n", stage, run->break_reason);
         // Print Tape 2 and Tape 3 combined for each machine with alignment
         printf("Machine States and Simulation Window:\n");
         print_header();
         for (int i = 0; i < num_machines; i++) {
-            print_machine_row(i);
+            print_machine_row(run, i);
         }
         // Check if all halted
-        if (all_machines_halted(num_machines)) break;
+        if (all_machines_halted(run)) break;
+        if (run->breaks.enabled) {
+            break_wait(&run->breaks);
+            continue;
+        }
         // Pause and wait for key press (Enter)
         printf("Press Enter to continue...\n");
         getchar(); // Wait for Enter key
@@ -253,20 +1380,21 @@ void simulate(int num_machines) {
 }
 
 // Print Tape 2 and Tape 3 combined with alignment
-void print_tapes(int num_machines) {
+void print_tapes(const IttmRun *run) {
     printf("Final Machine States and Simulation Window:\n");
     print_header();
-    for (int i = 0; i < num_machines; i++) {
-        print_machine_row(i);
+    for (int i = 0; i < run->num_machines; i++) {
+        print_machine_row(run, i);
     }
 }
 
 // Print Tape 4: halting set
-void print_halt_set(int num_machines) {
+void print_halt_set(const IttmRun *run) {
+    int num_machines = run->num_machines;
     int halts = 0;
     printf("Tape 4 (1=halted):\n");
     for (int i = 0; i < num_machines; i++) {
-        int bit = (halt_set[i / 8] >> (i % 8)) & 1;
+        int bit = (run->halt_set[i / 8] >> (i % 8)) & 1;
         printf("%d", bit);
         halts += bit;
         if (i % 8 == 7) printf(" ");
@@ -274,7 +1402,163 @@ void print_halt_set(int num_machines) {
     printf("\nHalted: %d/%d\n", halts, num_machines);
 }
 
-int main() {
+// Compare exact verdicts with the window heuristic's
+void print_exact_report(const IttmRun *run) {
+    int num_machines = run->num_machines;
+    int false_loops = 0, missed = 0, unconfirmed = 0, proven = 0;
+    printf("Exact loop detection vs window heuristic:\n");
+    printf("%-8s %-12s %-12s %s\n", "Machine", "Heuristic", "Exact", "Verdict");
+    for (int i = 0; i < num_machines; i++) {
+        char heuristic[20], result[20];
+        const char *verdict = "agrees";
+        int halted = (run->halt_set[i / 8] >> (i % 8)) & 1;
+        if (run->exact_loop[i].heuristic_step) sprintf(heuristic, "loop@%u", run->exact_loop[i].heuristic_step);
+        else strcpy(heuristic, "-");
+        if (halted) sprintf(result, "halt@%llu", (unsigned long long)run->tm[i].steps);
+        else if (run->exact_loop[i].proof_step) sprintf(result, "loop@%u", run->exact_loop[i].proof_step);
+        else strcpy(result, "undecided");
+        if (run->exact_loop[i].proof_step) proven++;
+        if (run->exact_loop[i].heuristic_step && halted) {
+            verdict = "overturned (halts)";
+            false_loops++;
+        } else if (run->exact_loop[i].heuristic_step && !run->exact_loop[i].proof_step) {
+            verdict = "unconfirmed";
+            unconfirmed++;
+        } else if (!run->exact_loop[i].heuristic_step && run->exact_loop[i].proof_step) {
+            verdict = "overturned (missed loop)";
+            missed++;
+        }
+        printf("%-8d %-12s %-12s %s\n", i, heuristic, result, verdict);
+    }
+    printf("Proven loops: %d/%d\n", proven, num_machines);
+    printf("Heuristic verdicts overturned: %d (%d false loops, %d missed loops), unconfirmed: %d\n",
+           false_loops + missed, false_loops, missed, unconfirmed);
+}
+
+int main(int argc, char *argv[]) {
+    for (int a = 1; a < argc; a++) {
+        if (strcmp(argv[a], "--exact") == 0) {
+            exact_mode = 1;
+        } else if (strncmp(argv[a], "--db=", 5) == 0) {
+            db_path = argv[a] + 5;
+        } else if (strncmp(argv[a], "--limit=", 8) == 0) {
+            limit_stages = atoi(argv[a] + 8);
+        } else if (strncmp(argv[a], "--load=", 7) == 0 && num_load_files < MAX_LOAD_FILES) {
+            load_files[num_load_files++] = argv[a] + 7;
+        } else if (strncmp(argv[a], "--explore=", 10) == 0) {
+            explore_file = argv[a] + 10;
+        } else if (strncmp(argv[a], "--enumerate=", 12) == 0) {
+            if (sscanf(argv[a] + 12, "%dx%d", &enumerate_states, &enumerate_symbols) != 2) enumerate_states = -1;
+        } else if (strncmp(argv[a], "--depth=", 8) == 0) {
+            explore_depth = atoi(argv[a] + 8);
+        } else if (strcmp(argv[a], "--hashlife") == 0 || strncmp(argv[a], "--hashlife=", 11) == 0) {
+            hashlife_mode = 1;
+            if (argv[a][10]) hashlife_cache = strtoull(argv[a] + 11, NULL, 10);
+        } else if (strcmp(argv[a], "--exptape") == 0 || strncmp(argv[a], "--exptape=", 10) == 0) {
+            exptape_block = argv[a][9] ? atoi(argv[a] + 10) : 1;
+            if (exptape_block < 1) exptape_block = 1;
+        } else if (strncmp(argv[a], "--shard=", 8) == 0) {
+            if (sscanf(argv[a] + 8, "%u/%u", &shard_index, &num_shards) != 2 || num_shards < 1 || shard_index >= num_shards) {
+                printf("--shard=I/N needs 0 <= I < N.\n");
+                return 1;
+            }
+        } else if (strncmp(argv[a], "--split=", 8) == 0) {
+            split_depth = atoi(argv[a] + 8);
+        } else if (strncmp(argv[a], "--results=", 10) == 0) {
+            results_path = argv[a] + 10;
+        } else if (strncmp(argv[a], "--snapshot=", 11) == 0) {
+            snapshot_prefix = argv[a] + 11;
+        } else if (strncmp(argv[a], "--copies=", 9) == 0) {
+            load_copies = atoi(argv[a] + 9);
+        } else if (strncmp(argv[a], "--stages=", 9) == 0) {
+            stage_limit = strtoull(argv[a] + 9, NULL, 10);
+        } else if (strcmp(argv[a], "--live") == 0 || strncmp(argv[a], "--live=", 7) == 0) {
+            live_fps = argv[a][6] ? atof(argv[a] + 7) : 10;
+            if (live_fps <= 0) live_fps = 10;
+        } else if (strncmp(argv[a], "--break=", 8) == 0) {
+            if (!break_parse(&break_specs, argv[a] + 8, 1 << BREAK_STEP | 1 << BREAK_STAGE | 1 << BREAK_STATE | 1 << BREAK_HALT)) return 1;
+        } else if (strcmp(argv[a], "--run") == 0) {
+            break_specs.enabled = 1;
+        } else if (strcmp(argv[a], "--stats") == 0) {
+            show_stats = 1;
+        } else {
+            printf("Usage: %s [--exact] [--db=PATH] [--limit=K] [--live[=FPS]] [--break=SPEC]... [--run] [--stats]\n", argv[0]);
+            printf("       %s --load=FILE... [--copies=N] [--stages=N] [--snapshot=PREFIX | --hashlife[=CACHE] | --exptape[=K]]\n", argv[0]);
+            printf("           [--shard=I/N] [--results=FILE]\n");
+            printf("       %s --explore=FILE [--depth=N]\n", argv[0]);
+            printf("       %s --enumerate=SxK [--stages=N] [--shard=I/N [--split=D]] [--results=FILE]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (enumerate_states) { // Enumeration stands alone
+        if (explore_file || num_load_files || exact_mode || db_path || limit_stages || break_specs.enabled || live_fps ||
+            hashlife_mode || exptape_block || snapshot_prefix || load_copies != 1) {
+            printf("--enumerate cannot be combined with other modes or engines.\n");
+            return 1;
+        }
+        if (split_depth < 1 || split_depth >= TM_ENUM_MAX_ENTRIES) {
+            printf("--split takes a depth of 1-%d.\n", TM_ENUM_MAX_ENTRIES - 1);
+            return 1;
+        }
+        return enumerate_machines() ? 0 : 1;
+    }
+    if (!num_load_files && (num_shards > 1 || results_path)) {
+        printf("--shard and --results need --enumerate or --load.\n");
+        return 1;
+    }
+    if (explore_file) { // Nondeterministic exploration stands alone
+        if (num_load_files || exact_mode || db_path || limit_stages || break_specs.enabled || live_fps) {
+            printf("--explore cannot be combined with other modes.\n");
+            return 1;
+        }
+        return explore_nondet() ? 0 : 1;
+    }
+    if (num_load_files) { // Loaded machines replace the built-in templates
+        if (exact_mode || db_path || limit_stages || break_specs.enabled || live_fps || load_copies < 1) {
+            printf("--load cannot be combined with --exact, --db, --limit, --break or --live.\n");
+            return 1;
+        }
+        if (hashlife_mode + !!exptape_block + !!snapshot_prefix > 1) {
+            printf("--hashlife and --exptape are alternative engines, and --snapshot needs the plain one: pick one.\n");
+            return 1;
+        }
+        if ((hashlife_mode || exptape_block) && (num_shards > 1 || results_path)) {
+            printf("--shard and --results need the plain dovetail.\n");
+            return 1;
+        }
+        LoadRun load = {0};
+        if (!load_general(&load)) return 1;
+        if (hashlife_mode) {
+            printf("Running %u loaded machines under hashlife...\n", load.num_machines);
+            simulate_hashlife(&load);
+        } else if (exptape_block) {
+            printf("Running %u loaded machines on the exponent tape (%d-cell blocks)...\n", load.num_machines, exptape_block);
+            simulate_exptape(&load);
+        } else {
+            printf("Dovetailing %u loaded machines...\n", load.num_machines);
+            simulate_general(&load);
+            if (results_path && !write_general_results(&load, stage_limit ? stage_limit : MAX_STEPS)) return 1;
+        }
+        free(load.machines);
+        free(load.kernels);
+        free(load.index);
+        free(load.marks);
+        arena_free_all(&load.arena);
+        return 0;
+    }
+    if (hashlife_mode || exptape_block) {
+        printf("--hashlife and --exptape need --load=FILE.\n");
+        return 1;
+    }
+    if (live_fps && break_specs.enabled) {
+        printf("--live cannot be combined with --break or --run.\n");
+        return 1;
+    }
+    if (limit_stages > MAX_LIMITS || (limit_stages && (exact_mode || db_path))) {
+        printf("--limit takes 1-%d limit stages and cannot be combined with --exact or --db.\n", MAX_LIMITS);
+        return 1;
+    }
+    IttmRun *run = calloc(1, sizeof(IttmRun));
     int num_machines;
     printf("Enter number of machines (1-30): ");
     scanf("%d", &num_machines);
@@ -282,13 +1566,55 @@ int main() {
         printf("Invalid number of machines. Using 20.\n");
         num_machines = 20;
     }
+    run->num_machines = num_machines;
+    run->exact = exact_mode;
+    run->breaks = break_specs;
+    run->show_steps = 1;
     printf("Starting ITTM oracle simulation with %d machines and blank tape...\n", num_machines);
-    initialize_tapes(num_machines);
-    setup_rules(num_machines);
+    initialize_tapes(run);
+    setup_rules(run);
+    if (exact_mode || db_path || limit_stages) init_tape_keys();
+    if (exact_mode) init_exact(run);
+    find_classes(run); // Duplicates replay their class's first machine
+    HaltRecord start[MAX_MACHINES];
+    if (db_path) {
+        run->db.path = db_path;
+        if (!db_map(&run->db, db_path, DB_MIN_SLOTS)) return 1;
+        for (int m = 0; m < num_machines; m++) db_key(run, m, &start[m]);
+        db_lookup(run);
+        printf("Halting DB %s: %d/%d machines already decided.\n", db_path, run->db_hits, num_machines);
+    }
+    if (limit_stages) { // Headless: finite stages, then limits
+        simulate_limits(run, limit_stages);
+        print_halt_set(run);
+        return 0;
+    }
     printf("\nSimulation ready. Press Enter to begin...\n");
     getchar();
-    simulate(num_machines);
-    print_tapes(num_machines);
-    print_halt_set(num_machines);
+    if (live_fps) {
+        char header[DISPLAY_LINE];
+        format_header(header);
+        display_start(&run->display, num_machines, sizeof(MachineRow), live_fps, format_machine_row, header);
+    }
+    simulate(run);
+    if (live_fps) {
+        display_stop(&run->display);
+        printf("Live display: %ld frames drawn, %ld snapshots published\n", run->display.frames, run->display.published);
+    }
+    print_tapes(run);
+    print_halt_set(run);
+    if (show_stats) {
+        printf("Tape memory: %zu bytes in live tapes and rule tables, %zu KiB of arena pages, %zu blocks recycled\n",
+               run->arena.in_use, run->arena.reserved / 1024, run->arena.recycled);
+    }
+    if (exact_mode) print_exact_report(run);
+    if (db_path) {
+        db_insert(run, start);
+        printf("Halting DB %s: %d hits, %d verdicts added, %llu stored.\n",
+               db_path, run->db_hits, run->db_inserts, (unsigned long long)run->db.header->count);
+        db_unmap(&run->db);
+    }
+    arena_free_all(&run->arena);
+    free(run);
     return 0;
 }
\ No newline at end of file
@@ -3,6 +3,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "tm_core.h"
+#include "tm_snapshot.h"
+#include "tm_break.h"
 
 #define TAPE_LENGTH 1000
 #define MAX_STEPS 100
@@ -10,359 +13,273 @@
 #define NUM_SYMBOLS 3 // Symbols: 0, 1, 2 (2 for halt marker)
 #define MAX_ITERATIONS 3 // Halt after 3 segments
 
+// The rule table, tape, state and head live in a TmMachine (tm_core.h);
+// the front-end adds its step and segment counters
 typedef struct {
-    int write_symbol;  // Symbol to write (0, 1, or 2)
-    int move;          // -1 (left), 1 (right)
-    int next_state;    // Next state
-} Transition;
-
-typedef struct {
-    int state;            // Current state (0 to num_states-1, num_states for halt)
-    int position;         // Tape position
-    int halted;           // 1 if halted
+    TmMachine core;       // State (num_states halts), position, tape and rules
+    int halted;           // 1 if halted (or stopped on an error)
     int step_count;       // Current step
     int iteration_count;  // Track processed segments
-    int tape[TAPE_LENGTH]; // Tape
 } Machine;
 
+Arena machine_arena; // Rule table and tape
+Breakpoints breaks; // --break=SPEC / --run: run headless between stops
+int max_steps = MAX_STEPS; // --steps=N
+const char *tape_path = NULL; // --tape=[FORMAT:]FILE: the initial tape from a file, its first cell at 500
+int tape_format = TM_TAPE_RAW;
+const char *snapshot_path = NULL; // --snapshot=FILE: the whole final tape to FILE, and to FILE.STEP at each break stop
+int window_start = 500 - DISPLAY_SIZE / 2, window_end = 500 + DISPLAY_SIZE / 2; // Tape window shown at the last stop
+
 void init_tape(Machine *m) {
-    memset(m->tape, 0, TAPE_LENGTH * sizeof(int));
     // Tape: ...0, 1, 0, 0, 1, 0, 0, 1, 0, 0, 2, ... at 500–509
-    m->tape[500] = 1;
-    m->tape[501] = 0;
-    m->tape[502] = 0;
-    m->tape[503] = 1;
-    m->tape[504] = 0;
-    m->tape[505] = 0;
-    m->tape[506] = 1;
-    m->tape[507] = 0;
-    m->tape[508] = 0;
-    m->tape[509] = 2;
+    tm_write(&m->core, 500, 1);
+    tm_write(&m->core, 501, 0);
+    tm_write(&m->core, 502, 0);
+    tm_write(&m->core, 503, 1);
+    tm_write(&m->core, 504, 0);
+    tm_write(&m->core, 505, 0);
+    tm_write(&m->core, 506, 1);
+    tm_write(&m->core, 507, 0);
+    tm_write(&m->core, 508, 0);
+    tm_write(&m->core, 509, 2);
     // Debug: Verify tape initialization
     printf("Initial Tape (500-515): ");
     for (int i = 500; i <= 515; i++) {
-        printf("%d ", m->tape[i]);
+        printf("%d ", tm_read(&m->core, i));
     }
     printf("\n");
     printf("Initial Tape: ");
-    for (int i = m->position - DISPLAY_SIZE / 2; i <= m->position + DISPLAY_SIZE / 2; i++) {
-        if (i >= 0 && i < TAPE_LENGTH) {
-            printf(i == m->position ? "[%d]" : "%d", m->tape[i]);
-        } else {
-            printf(" ");
-        }
-        if (i < m->position + DISPLAY_SIZE / 2) printf(" ");
-    }
-    printf("\n");
+    tm_print_window(&m->core, DISPLAY_SIZE / 2, 0, TAPE_LENGTH);
 }
 
-void init_rules(Transition ***rules, int num_states) {
-    *rules = malloc(num_states * sizeof(Transition *));
-    if (!*rules) {
-        printf("Error: Memory allocation failed for rules.\n");
-        exit(1);
-    }
-    for (int i = 0; i < num_states; i++) {
-        (*rules)[i] = malloc(NUM_SYMBOLS * sizeof(Transition));
-        if (!(*rules)[i]) {
-            printf("Error: Memory allocation failed for rules[%d].\n", i);
-            exit(1);
-        }
-    }
+void init_rules(TmMachine *m) {
+    int num_states = m->num_states;
     // Rules: Process [1,0,0] to [0,1,1] for three segments, halt on 2 in state 14
     for (int state = 0; state < num_states; state++) {
         for (int symbol = 0; symbol < NUM_SYMBOLS; symbol++) {
             // State 0: Start, find first segment
             if (state == 0 && symbol == 1) {
-                (*rules)[state][symbol].write_symbol = 0;
-                (*rules)[state][symbol].move = 1;
-                (*rules)[state][symbol].next_state = 1;
+                tm_set_rule(m, state, symbol, 0, 1, 1);
             } else if (state == 0 && symbol == 0) {
-                (*rules)[state][symbol].write_symbol = 0;
-                (*rules)[state][symbol].move = 1;
-                (*rules)[state][symbol].next_state = 0;
+                tm_set_rule(m, state, symbol, 0, 1, 0);
             } else if (state == 0 && symbol == 2) {
-                (*rules)[state][symbol].write_symbol = 2;
-                (*rules)[state][symbol].move = 1;
-                (*rules)[state][symbol].next_state = 0;
+                tm_set_rule(m, state, symbol, 2, 1, 0);
             }
             // State 1: Process first 0 of first segment
             else if (state == 1 && symbol == 0) {
-                (*rules)[state][symbol].write_symbol = 1;
-                (*rules)[state][symbol].move = 1;
-                (*rules)[state][symbol].next_state = 2;
+                tm_set_rule(m, state, symbol, 1, 1, 2);
             } else if (state == 1 && (symbol == 1 || symbol == 2)) {
-                (*rules)[state][symbol].write_symbol = symbol;
-                (*rules)[state][symbol].move = 1;
-                (*rules)[state][symbol].next_state = 3;
+                tm_set_rule(m, state, symbol, symbol, 1, 3);
             }
             // State 2: Process second 0 of first segment
             else if (state == 2 && symbol == 0) {
-                (*rules)[state][symbol].write_symbol = 1;
-                (*rules)[state][symbol].move = 1;
-                (*rules)[state][symbol].next_state = 3;
+                tm_set_rule(m, state, symbol, 1, 1, 3);
             } else if (state == 2 && (symbol == 1 || symbol == 2)) {
-                (*rules)[state][symbol].write_symbol = symbol;
-                (*rules)[state][symbol].move = 1;
-                (*rules)[state][symbol].next_state = 3;
+                tm_set_rule(m, state, symbol, symbol, 1, 3);
             }
             // State 3: Navigate to second segment
             else if (state == 3 && symbol == 1) {
-                (*rules)[state][symbol].write_symbol = 0;
-                (*rules)[state][symbol].move = 1;
-                (*rules)[state][symbol].next_state = 4;
+                tm_set_rule(m, state, symbol, 0, 1, 4);
             } else if (state == 3 && symbol == 0) {
-                (*rules)[state][symbol].write_symbol = 0;
-                (*rules)[state][symbol].move = 1;
-                (*rules)[state][symbol].next_state = 3;
+                tm_set_rule(m, state, symbol, 0, 1, 3);
             } else if (state == 3 && symbol == 2) {
-                (*rules)[state][symbol].write_symbol = 2;
-                (*rules)[state][symbol].move = 1;
-                (*rules)[state][symbol].next_state = 3;
+                tm_set_rule(m, state, symbol, 2, 1, 3);
             }
             // State 4: Process first 0 of second segment
             else if (state == 4 && symbol == 0) {
-                (*rules)[state][symbol].write_symbol = 1;
-                (*rules)[state][symbol].move = 1;
-                (*rules)[state][symbol].next_state = 5;
+                tm_set_rule(m, state, symbol, 1, 1, 5);
             } else if (state == 4 && (symbol == 1 || symbol == 2)) {
-                (*rules)[state][symbol].write_symbol = symbol;
-                (*rules)[state][symbol].move = 1;
-                (*rules)[state][symbol].next_state = 6;
+                tm_set_rule(m, state, symbol, symbol, 1, 6);
             }
             // State 5: Process second 0 of second segment
             else if (state == 5 && symbol == 0) {
-                (*rules)[state][symbol].write_symbol = 1;
-                (*rules)[state][symbol].move = 1;
-                (*rules)[state][symbol].next_state = 6;
+                tm_set_rule(m, state, symbol, 1, 1, 6);
             } else if (state == 5 && (symbol == 1 || symbol == 2)) {
-                (*rules)[state][symbol].write_symbol = symbol;
-                (*rules)[state][symbol].move = 1;
-                (*rules)[state][symbol].next_state = 6;
+                tm_set_rule(m, state, symbol, symbol, 1, 6);
             }
             // State 6: Navigate to third segment
             else if (state == 6 && symbol == 1) {
-                (*rules)[state][symbol].write_symbol = 0;
-                (*rules)[state][symbol].move = 1;
-                (*rules)[state][symbol].next_state = 7;
+                tm_set_rule(m, state, symbol, 0, 1, 7);
             } else if (state == 6 && symbol == 0) {
-                (*rules)[state][symbol].write_symbol = 0;
-                (*rules)[state][symbol].move = 1;
-                (*rules)[state][symbol].next_state = 6;
+                tm_set_rule(m, state, symbol, 0, 1, 6);
             } else if (state == 6 && symbol == 2) {
-                (*rules)[state][symbol].write_symbol = 2;
-                (*rules)[state][symbol].move = 1;
-                (*rules)[state][symbol].next_state = 6;
+                tm_set_rule(m, state, symbol, 2, 1, 6);
             }
             // State 7: Process first 0 of third segment
             else if (state == 7 && symbol == 0) {
-                (*rules)[state][symbol].write_symbol = 1;
-                (*rules)[state][symbol].move = 1;
-                (*rules)[state][symbol].next_state = 8;
+                tm_set_rule(m, state, symbol, 1, 1, 8);
             } else if (state == 7 && (symbol == 1 || symbol == 2)) {
-                (*rules)[state][symbol].write_symbol = symbol;
-                (*rules)[state][symbol].move = 1;
-                (*rules)[state][symbol].next_state = 9;
+                tm_set_rule(m, state, symbol, symbol, 1, 9);
             }
             // State 8: Process second 0 of third segment
             else if (state == 8 && symbol == 0) {
-                (*rules)[state][symbol].write_symbol = 1;
-                (*rules)[state][symbol].move = -1;
-                (*rules)[state][symbol].next_state = 9;
+                tm_set_rule(m, state, symbol, 1, -1, 9);
             } else if (state == 8 && (symbol == 1 || symbol == 2)) {
-                (*rules)[state][symbol].write_symbol = symbol;
-                (*rules)[state][symbol].move = -1;
-                (*rules)[state][symbol].next_state = 9;
+                tm_set_rule(m, state, symbol, symbol, -1, 9);
             }
             // State 9: Verify third segment
             else if (state == 9 && symbol == 1) {
-                (*rules)[state][symbol].write_symbol = 1;
-                (*rules)[state][symbol].move = -1;
-                (*rules)[state][symbol].next_state = 9;
+                tm_set_rule(m, state, symbol, 1, -1, 9);
             } else if (state == 9 && symbol == 0) {
-                (*rules)[state][symbol].write_symbol = 0;
-                (*rules)[state][symbol].move = -1;
-                (*rules)[state][symbol].next_state = 10;
+                tm_set_rule(m, state, symbol, 0, -1, 10);
             } else if (state == 9 && symbol == 2) {
-                (*rules)[state][symbol].write_symbol = 2;
-                (*rules)[state][symbol].move = 1;
-                (*rules)[state][symbol].next_state = 12;
+                tm_set_rule(m, state, symbol, 2, 1, 12);
             }
             // State 10: Verify second segment
             else if (state == 10 && symbol == 1) {
-                (*rules)[state][symbol].write_symbol = 1;
-                (*rules)[state][symbol].move = -1;
-                (*rules)[state][symbol].next_state = 10;
+                tm_set_rule(m, state, symbol, 1, -1, 10);
             } else if (state == 10 && symbol == 0) {
-                (*rules)[state][symbol].write_symbol = 0;
-                (*rules)[state][symbol].move = -1;
-                (*rules)[state][symbol].next_state = 11;
+                tm_set_rule(m, state, symbol, 0, -1, 11);
             } else if (state == 10 && symbol == 2) {
-                (*rules)[state][symbol].write_symbol = 2;
-                (*rules)[state][symbol].move = 1;
-                (*rules)[state][symbol].next_state = 12;
+                tm_set_rule(m, state, symbol, 2, 1, 12);
             }
             // State 11: Verify first segment
             else if (state == 11 && symbol == 1) {
-                (*rules)[state][symbol].write_symbol = 1;
-                (*rules)[state][symbol].move = -1;
-                (*rules)[state][symbol].next_state = 11;
+                tm_set_rule(m, state, symbol, 1, -1, 11);
             } else if (state == 11 && symbol == 0) {
-                (*rules)[state][symbol].write_symbol = 0;
-                (*rules)[state][symbol].move = 1;
-                (*rules)[state][symbol].next_state = 12;
+                tm_set_rule(m, state, symbol, 0, 1, 12);
             } else if (state == 11 && symbol == 2) {
-                (*rules)[state][symbol].write_symbol = 2;
-                (*rules)[state][symbol].move = 1;
-                (*rules)[state][symbol].next_state = 12;
+                tm_set_rule(m, state, symbol, 2, 1, 12);
             }
             // State 12: Navigate to halt marker
             else if (state == 12 && symbol == 0) {
-                (*rules)[state][symbol].write_symbol = 0;
-                (*rules)[state][symbol].move = 1;
-                (*rules)[state][symbol].next_state = 13;
+                tm_set_rule(m, state, symbol, 0, 1, 13);
             } else if (state == 12 && symbol == 1) {
-                (*rules)[state][symbol].write_symbol = 1;
-                (*rules)[state][symbol].move = 1;
-                (*rules)[state][symbol].next_state = 13;
+                tm_set_rule(m, state, symbol, 1, 1, 13);
             } else if (state == 12 && symbol == 2) {
-                (*rules)[state][symbol].write_symbol = 2;
-                (*rules)[state][symbol].move = 1;
-                (*rules)[state][symbol].next_state = 14;
+                tm_set_rule(m, state, symbol, 2, 1, 14);
             }
             // State 13: Continue navigating to halt marker
             else if (state == 13 && symbol == 0) {
-                (*rules)[state][symbol].write_symbol = 0;
-                (*rules)[state][symbol].move = 1;
-                (*rules)[state][symbol].next_state = 13;
+                tm_set_rule(m, state, symbol, 0, 1, 13);
             } else if (state == 13 && symbol == 1) {
-                (*rules)[state][symbol].write_symbol = 1;
-                (*rules)[state][symbol].move = 1;
-                (*rules)[state][symbol].next_state = 13;
+                tm_set_rule(m, state, symbol, 1, 1, 13);
             } else if (state == 13 && symbol == 2) {
-                (*rules)[state][symbol].write_symbol = 2;
-                (*rules)[state][symbol].move = 0;  // Stay on 2
-                (*rules)[state][symbol].next_state = 14;
+                tm_set_rule(m, state, symbol, 2, 0, 14); // Stay on 2
             }
             // State 14: Check for halt
             else if (state == 14 && symbol == 0) {
-                (*rules)[state][symbol].write_symbol = 0;
-                (*rules)[state][symbol].move = 1;
-                (*rules)[state][symbol].next_state = 12;
+                tm_set_rule(m, state, symbol, 0, 1, 12);
             } else if (state == 14 && symbol == 1) {
-                (*rules)[state][symbol].write_symbol = 1;
-                (*rules)[state][symbol].move = 1;
-                (*rules)[state][symbol].next_state = 12;
+                tm_set_rule(m, state, symbol, 1, 1, 12);
             } else if (state == 14 && symbol == 2) {
-                (*rules)[state][symbol].write_symbol = 2;
-                (*rules)[state][symbol].move = 1;
-                (*rules)[state][symbol].next_state = 12;
+                tm_set_rule(m, state, symbol, 2, 1, 12);
             }
+            const TmRule *r = tm_rule(m, state, symbol);
             printf("State %d, Symbol %d: Write %d, Move %s, Next State %d\n",
-                   state, symbol, (*rules)[state][symbol].write_symbol,
-                   (*rules)[state][symbol].move == 1 ? "Right" : ((*rules)[state][symbol].move == -1 ? "Left" : "Stay"),
-                   (*rules)[state][symbol].next_state);
+                   state, symbol, r->write, r->move == 1 ? "Right" : (r->move == -1 ? "Left" : "Stay"), r->next);
         }
     }
 }
 
-void free_rules(Transition **rules, int num_states) {
-    for (int i = 0; i < num_states; i++) {
-        if (rules[i]) free(rules[i]);
+// Release the rule table and tape with the arena they came from
+void free_machine() {
+    arena_free_all(&machine_arena);
+}
+
+// Show where a breakpoint stopped the machine, and make that the window --break=window watches
+// --snapshot: the whole tape, not just the window shown (tm_snapshot.h)
+void save_snapshot(TmMachine *tm, int at_break) {
+    char path[4096];
+    if (at_break) {
+        snprintf(path, sizeof(path), "%s.%llu", snapshot_path, (unsigned long long)tm->steps);
+    } else {
+        snprintf(path, sizeof(path), "%s", snapshot_path);
     }
-    free(rules);
+    if (tm_snap_save(path, tm)) printf("Snapshot written to %s\n", path);
+}
+
+void print_break(Machine *m) {
+    printf("\nBreak at step %d: State=%d, Position=%d, Iteration Count=%d\n",
+           m->step_count, m->core.state, (int)m->core.position, m->iteration_count);
+    printf("Tape: ");
+    tm_print_window(&m->core, DISPLAY_SIZE / 2, 0, TAPE_LENGTH);
+    if (snapshot_path) save_snapshot(&m->core, 1);
 }
 
-void simulate(Machine *m, Transition **rules, int num_states) {
-    while (m->step_count < MAX_STEPS && !m->halted) {
+void simulate(Machine *m) {
+    TmMachine *tm = &m->core;
+    int num_states = tm->num_states;
+    while (m->step_count < max_steps && !m->halted) {
         m->step_count++;
-        if (m->state < 0 || m->state > num_states) {
-            printf("Error: Invalid state %d at step %d.\n", m->state, m->step_count);
+        int show = break_showing(&breaks);
+        if (tm->state > num_states) {
+            printf("Error: Invalid state %d at step %d.\n", tm->state, m->step_count);
             break;
         }
-        int symbol = m->tape[m->position];
+        int symbol = tm_read(tm, tm->position);
         if (symbol < 0 || symbol >= NUM_SYMBOLS) {
             printf("Error: Invalid symbol %d at step %d.\n", symbol, m->step_count);
             break;
         }
-        Transition rule = rules[m->state][symbol];
+        TmRule rule = *tm_rule(tm, tm->state, symbol);
         // Special case for state 14, symbol 2: check iteration count
-        if (m->state == 14 && symbol == 2) {
-            printf("Halt check: iteration_count=%d, MAX_ITERATIONS=%d\n", m->iteration_count, MAX_ITERATIONS);
+        if (tm->state == 14 && symbol == 2) {
+            if (show) printf("Halt check: iteration_count=%d, MAX_ITERATIONS=%d\n", m->iteration_count, MAX_ITERATIONS);
             if (m->iteration_count >= MAX_ITERATIONS) {
-                rule.write_symbol = 2;
-                rule.move = 0;
-                rule.next_state = num_states; // Halt state
+                rule = (TmRule){2, 0, num_states}; // Halt state
             }
         }
-        printf("\nStep %d: State=%d, Before Position=%d, Read=%d, Iteration Count=%d\n",
-               m->step_count, m->state, m->position, symbol, m->iteration_count);
+        if (show) {
+            printf("\nStep %d: State=%d, Before Position=%d, Read=%d, Iteration Count=%d\n",
+                   m->step_count, tm->state, (int)tm->position, symbol, m->iteration_count);
         
-        // Display tape before action
-        printf("Before Tape: ");
-        int start = m->position - DISPLAY_SIZE / 2;
-        int end = m->position + DISPLAY_SIZE / 2;
-        for (int i = start; i <= end; i++) {
-            if (i >= 0 && i < TAPE_LENGTH) {
-                printf(i == m->position ? "[%d]" : "%d", m->tape[i]);
-            } else {
-                printf(" ");
-            }
-            if (i < end) printf(" ");
-        }
-        printf("\n");
+            // Display tape before action
+            printf("Before Tape: ");
+            tm_print_window(tm, DISPLAY_SIZE / 2, 0, TAPE_LENGTH);
         
-        printf("Action: Write %d, Move %s, Next State %d\n",
-               rule.write_symbol, rule.move == 1 ? "Right" : (rule.move == -1 ? "Left" : "Stay"), rule.next_state);
+            printf("Action: Write %d, Move %s, Next State %d\n",
+                   rule.write, rule.move == 1 ? "Right" : (rule.move == -1 ? "Left" : "Stay"), rule.next);
+        }
         
-        m->tape[m->position] = rule.write_symbol;
-        m->position += rule.move;
-        if (m->position < 0 || m->position >= TAPE_LENGTH) {
+        int from_state = tm->state;
+        tm_apply(tm, &rule);
+        if (tm->position < 0 || tm->position >= TAPE_LENGTH) {
             printf("Error: Tape position out of bounds at step %d.\n", m->step_count);
             m->halted = 1;
             break;
         }
         // Increment iteration count after completing each segment (before state update)
-        if ((m->state == 2 && symbol == 0) || (m->state == 5 && symbol == 0) || (m->state == 8 && symbol == 0)) {
+        if ((from_state == 2 && symbol == 0) || (from_state == 5 && symbol == 0) || (from_state == 8 && symbol == 0)) {
             m->iteration_count++;
-            printf("Incrementing iteration_count to %d at state %d, symbol %d\n", m->iteration_count, m->state, symbol);
+            if (show) printf("Incrementing iteration_count to %d at state %d, symbol %d\n", m->iteration_count, from_state, symbol);
         }
-        m->state = rule.next_state;
         // Halt when entering state 15
-        if (m->state == num_states) {
-            m->halted = 1;
-        }
+        m->halted = tm->halted;
         // Safeguard for left loop in verification states
-        if ((m->state == 9 || m->state == 10 || m->state == 11) && m->position < 490) {
+        if ((tm->state == 9 || tm->state == 10 || tm->state == 11) && tm->position < 490) {
             printf("Error: Stuck left in verification, halting at step %d.\n", m->step_count);
             m->halted = 1;
             break;
         }
         // Prevent indefinite looping in state 13
-        if (m->state == 13 && m->position > 509 + 10) {
+        if (tm->state == 13 && tm->position > 509 + 10) {
             printf("Error: Stuck in state 13, halting at step %d.\n", m->step_count);
             m->halted = 1;
             break;
         }
         
-        printf("After Position: %d\n", m->position);
+        if (show) {
+            printf("After Position: %d\n", (int)tm->position);
         
-        printf("After Tape: ");
-        start = m->position - DISPLAY_SIZE / 2;
-        end = m->position + DISPLAY_SIZE / 2;
-        for (int i = start; i <= end; i++) {
-            if (i >= 0 && i < TAPE_LENGTH) {
-                printf(i == m->position ? "[%d]" : "%d", m->tape[i]);
-            } else {
-                printf(" ");
-            }
-            if (i < end) printf(" ");
+            printf("After Tape: ");
+            tm_print_window(tm, DISPLAY_SIZE / 2, 0, TAPE_LENGTH);
+        } else if (break_at(&breaks, BREAK_STEP, m->step_count) || break_at(&breaks, BREAK_STATE, tm->state) ||
+                   (m->halted && break_at(&breaks, BREAK_HALT, 0)) ||
+                   ((tm->position < window_start || tm->position > window_end) && break_at(&breaks, BREAK_WINDOW, 0))) {
+            print_break(m);
+            show = 1;
         }
-        printf("\n");
         
-        if (!m->halted) {
-            printf("Press Enter to continue...\n");
-            getchar();
+        if (!m->halted && show) {
+            window_start = tm->position - DISPLAY_SIZE / 2;
+            window_end = tm->position + DISPLAY_SIZE / 2;
+            if (breaks.enabled) {
+                break_wait(&breaks);
+            } else {
+                printf("Press Enter to continue...\n");
+                getchar();
+            }
         }
     }
     if (m->halted) {
@@ -372,37 +289,80 @@ void simulate(Machine *m, Transition **rules, int num_states) {
 
 void print_final(Machine *m) {
     printf("\nFinal State: %d, Position=%d, Halted=%d, Halt Step=%d, Iteration Count=%d\n",
-           m->state, m->position, m->halted, m->step_count, m->iteration_count);
+           m->core.state, (int)m->core.position, m->halted, m->step_count, m->iteration_count);
     printf("Final Tape: ");
-    int start = m->position - DISPLAY_SIZE / 2;
-    int end = m->position + DISPLAY_SIZE / 2;
-    for (int i = start; i <= end; i++) {
-        if (i >= 0 && i < TAPE_LENGTH) {
-            printf(i == m->position ? "[%d]" : "%d", m->tape[i]);
-        } else {
-            printf(" ");
-        }
-        if (i < end) printf(" ");
+    tm_print_window(&m->core, DISPLAY_SIZE / 2, 0, TAPE_LENGTH);
+    if (snapshot_path) save_snapshot(&m->core, 0);
+}
+
+// Write the machine in the format ittm_dovetail --load reads (tm_write_text)
+int export_machine(const char *path, Machine *m) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        perror(path);
+        return 0;
     }
-    printf("\n");
+    tm_write_text(f, &m->core);
+    fclose(f);
+    printf("Machine exported to %s\n", path);
+    return 1;
 }
 
 int main(int argc, char *argv[]) {
     int num_states = 15; // 15 states (0-14), plus halt state (15)
-    if (argc > 1) {
-        num_states = atoi(argv[1]);
+    const char *export_path = NULL; // --export=FILE: write the machine for ittm_dovetail --load
+    for (int a = 1; a < argc; a++) {
+        if (strncmp(argv[a], "--export=", 9) == 0) {
+            export_path = argv[a] + 9;
+            continue;
+        }
+        if (strncmp(argv[a], "--break=", 8) == 0) {
+            if (!break_parse(&breaks, argv[a] + 8, 1 << BREAK_STEP | 1 << BREAK_STATE | 1 << BREAK_HALT | 1 << BREAK_WINDOW)) return 1;
+            continue;
+        }
+        if (strcmp(argv[a], "--run") == 0) {
+            breaks.enabled = 1;
+            continue;
+        }
+        if (strncmp(argv[a], "--steps=", 8) == 0) {
+            max_steps = atoi(argv[a] + 8);
+            continue;
+        }
+        if (strncmp(argv[a], "--snapshot=", 11) == 0) {
+            snapshot_path = argv[a] + 11;
+            continue;
+        }
+        if (strncmp(argv[a], "--tape=", 7) == 0) {
+            tape_path = tm_tape_spec(argv[a] + 7, &tape_format);
+            continue;
+        }
+        num_states = atoi(argv[a]);
         if (num_states < 1 || num_states > 100) {
             printf("Error: Number of states must be between 1 and 100.\n");
             return 1;
         }
     }
     printf("Starting Turing Machine simulation with %d states (plus halt state %d)...\n", num_states, num_states);
-    Machine m = {0, 500, 0, 0, 0, {0}}; // Initialize with state 0, position 500
-    Transition **rules;
-    init_tape(&m);
-    init_rules(&rules, num_states);
-    simulate(&m, rules, num_states);
+    Machine m = {0};
+    tm_init(&m.core, &machine_arena, num_states, NUM_SYMBOLS, 500, 0); // Initialize with state 0, position 500
+    if (tape_path) {
+        if (!tm_map_tape(&m.core, tape_path, tape_format, 500)) {
+            free_machine();
+            return 1;
+        }
+        printf("Initial Tape: ");
+        tm_print_window(&m.core, DISPLAY_SIZE / 2, 0, TAPE_LENGTH);
+    } else {
+        init_tape(&m);
+    }
+    init_rules(&m.core);
+    if (export_path) {
+        int ok = export_machine(export_path, &m);
+        free_machine();
+        return ok ? 0 : 1;
+    }
+    simulate(&m);
     print_final(&m);
-    free_rules(rules, num_states);
+    free_machine();
     return 0;
 }
\ No newline at end of file
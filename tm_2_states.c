@@ -4,215 +4,224 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "tm_core.h"
+#include "tm_snapshot.h"
+#include "tm_break.h"
 
 #define TAPE_LENGTH 1000
 #define MAX_STEPS 500
 #define DISPLAY_SIZE 25
 #define NUM_SYMBOLS 3 // Symbols: 0, 1, 2 (2 for halting)
 
-typedef struct {
-    int write_symbol;  // Symbol to write (0, 1, or 2)
-    int move;          // Tape movement: -1 (left), 1 (right)
-    int next_state;    // Next state
-} Rule;
+// The machine is a TmMachine (tm_core.h): state, head position, tape and
+// rules; num_states is the halt state. Positions stay within TAPE_LENGTH.
+Arena machine_arena; // Rule table and tape
+Breakpoints breaks; // --break=SPEC / --run: run headless between stops
+int max_steps = MAX_STEPS; // --steps=N
+const char *tape_path = NULL; // --tape=[FORMAT:]FILE: the initial tape from a file, its first cell at 500
+int tape_format = TM_TAPE_RAW;
+const char *snapshot_path = NULL; // --snapshot=FILE: the whole final tape to FILE, and to FILE.STEP at each break stop
+int window_start = 500 - DISPLAY_SIZE / 2, window_end = 500 + DISPLAY_SIZE / 2; // Tape window shown at the last stop
 
-typedef struct {
-    int current_state;    // Current state (0 to num_states-1, num_states for halt)
-    int tape_position;    // Current position on tape
-    int halted;           // 1 if halted
-    int halt_step;        // Step at which machine halted
-    int tape[TAPE_LENGTH]; // Input tape
-} TuringMachine;
-
-void initialize_tape(TuringMachine *tm) {
-    memset(tm->tape, 0, TAPE_LENGTH * sizeof(int));
+void initialize_tape(TmMachine *tm) {
     // Set up tape: ...0, 1, 0, 1, 0, 1, 0, 2, ...
-    tm->tape[500] = 1;
-    tm->tape[501] = 0;
-    tm->tape[502] = 1;
-    tm->tape[503] = 0;
-    tm->tape[504] = 1;
-    tm->tape[505] = 0;
-    tm->tape[506] = 2; // Trigger halt after three loops
+    tm_write(tm, 500, 1);
+    tm_write(tm, 501, 0);
+    tm_write(tm, 502, 1);
+    tm_write(tm, 503, 0);
+    tm_write(tm, 504, 1);
+    tm_write(tm, 505, 0);
+    tm_write(tm, 506, 2); // Trigger halt after three loops
     printf("Initial Tape: ");
-    for (int i = tm->tape_position - DISPLAY_SIZE / 2; i <= tm->tape_position + DISPLAY_SIZE / 2; i++) {
-        if (i >= 0 && i < TAPE_LENGTH) {
-            if (i == tm->tape_position) {
-                printf("[%d]", tm->tape[i]);
-            } else {
-                printf("%d", tm->tape[i]);
-            }
-        } else {
-            printf(" ");
-        }
-        if (i < tm->tape_position + DISPLAY_SIZE / 2) printf(" ");
-    }
-    printf("\n");
+    tm_print_window(tm, DISPLAY_SIZE / 2, 0, TAPE_LENGTH);
 }
 
-void setup_rules(Rule ***rules, int num_states) {
-    *rules = malloc(num_states * sizeof(Rule *));
-    for (int i = 0; i < num_states; i++) {
-        (*rules)[i] = malloc(NUM_SYMBOLS * sizeof(Rule));
-    }
+void setup_rules(TmMachine *tm) {
+    int num_states = tm->num_states;
     // Rules: Loop by flipping [1,0] to [0,1] with state cycle 0->1->0, moving left/right, halt on 2 in state 1
     for (int state = 0; state < num_states; state++) {
         for (int symbol = 0; symbol < NUM_SYMBOLS; symbol++) {
             if (state == 1 && symbol == 2) {
                 // Clear halting rule: In state 1, reading a 2 halts (go to state num_states)
-                (*rules)[state][symbol].write_symbol = 2;
-                (*rules)[state][symbol].move = 1;
-                (*rules)[state][symbol].next_state = num_states;
+                tm_set_rule(tm, state, symbol, 2, 1, num_states);
             } else if (state == 0 && symbol == 1) {
                 // Loop: Read 1 in state 0, write 0, move right, go to state 1
-                (*rules)[state][symbol].write_symbol = 0;
-                (*rules)[state][symbol].move = 1;
-                (*rules)[state][symbol].next_state = 1;
+                tm_set_rule(tm, state, symbol, 0, 1, 1);
             } else if (state == 1 && symbol == 0) {
                 // Loop: Read 0 in state 1, write 1, move left, go to state 0
-                (*rules)[state][symbol].write_symbol = 1;
-                (*rules)[state][symbol].move = -1;
-                (*rules)[state][symbol].next_state = 0;
+                tm_set_rule(tm, state, symbol, 1, -1, 0);
             } else if (state == 0 && symbol == 0) {
                 // Skip 0s in state 0, move right
-                (*rules)[state][symbol].write_symbol = 0;
-                (*rules)[state][symbol].move = 1;
-                (*rules)[state][symbol].next_state = 0;
+                tm_set_rule(tm, state, symbol, 0, 1, 0);
             } else if (state == 1 && symbol == 1) {
                 // Continue processing 1s in state 1, move right
-                (*rules)[state][symbol].write_symbol = 1;
-                (*rules)[state][symbol].move = 1;
-                (*rules)[state][symbol].next_state = 1;
+                tm_set_rule(tm, state, symbol, 1, 1, 1);
             } else {
                 // Maintain state for unused cases (e.g., state 0, symbol 2)
-                (*rules)[state][symbol].write_symbol = symbol;
-                (*rules)[state][symbol].move = 1;
-                (*rules)[state][symbol].next_state = state;
+                tm_set_rule(tm, state, symbol, symbol, 1, state);
             }
+            const TmRule *r = tm_rule(tm, state, symbol);
             printf("State %d, Symbol %d: Write %d, Move %s, Next State %d\n",
-                   state, symbol, (*rules)[state][symbol].write_symbol,
-                   (*rules)[state][symbol].move == 1 ? "Right" : "Left",
-                   (*rules)[state][symbol].next_state);
+                   state, symbol, r->write, r->move == 1 ? "Right" : "Left", r->next);
         }
     }
 }
 
-void free_rules(Rule **rules, int num_states) {
-    for (int i = 0; i < num_states; i++) {
-        free(rules[i]);
+// Release the rule table and tape with the arena they came from
+void free_machine() {
+    arena_free_all(&machine_arena);
+}
+
+// --snapshot: the whole tape, not just the window shown (tm_snapshot.h)
+void save_snapshot(TmMachine *tm, int at_break) {
+    char path[4096];
+    if (at_break) {
+        snprintf(path, sizeof(path), "%s.%llu", snapshot_path, (unsigned long long)tm->steps);
+    } else {
+        snprintf(path, sizeof(path), "%s", snapshot_path);
     }
-    free(rules);
+    if (tm_snap_save(path, tm)) printf("Snapshot written to %s\n", path);
 }
 
-void simulate(TuringMachine *tm, Rule **rules, int num_states) {
-    for (int step = 1; step <= MAX_STEPS; step++) {
+// Show where a breakpoint stopped the machine, and make that the window --break=window watches
+void print_break(TmMachine *tm) {
+    printf("\nBreak at step %llu: State=%d, Position=%lld\n",
+           (unsigned long long)tm->steps, tm->state, (long long)tm->position);
+    printf("Tape: ");
+    tm_print_window(tm, DISPLAY_SIZE / 2, 0, TAPE_LENGTH);
+    if (snapshot_path) save_snapshot(tm, 1);
+}
+
+void simulate(TmMachine *tm) {
+    for (int step = 1; step <= max_steps; step++) {
         if (tm->halted) {
-            printf("Machine halted at step %d.\n", tm->halt_step);
+            printf("Machine halted at step %llu.\n", (unsigned long long)tm->steps);
             break;
         }
-        int symbol = tm->tape[tm->tape_position];
-        Rule rule = rules[tm->current_state][symbol];
-        printf("\nStep %d: State=%d, Position=%d, Read=%d\n",
-               step, tm->current_state, tm->tape_position, symbol);
-        
-        // Display tape before action
-        printf("Before Tape: ");
-        int start = tm->tape_position - DISPLAY_SIZE / 2;
-        int end = tm->tape_position + DISPLAY_SIZE / 2;
-        for (int i = start; i <= end; i++) {
-            if (i >= 0 && i < TAPE_LENGTH) {
-                if (i == tm->tape_position) {
-                    printf("[%d]", tm->tape[i]);
-                } else {
-                    printf("%d", tm->tape[i]);
-                }
-            } else {
-                printf(" ");
-            }
-            if (i < end) printf(" ");
+        int show = break_showing(&breaks);
+        TmRule rule = *tm_next_rule(tm);
+        if (show) {
+            printf("\nStep %d: State=%d, Position=%lld, Read=%d\n",
+                   step, tm->state, (long long)tm->position, tm_read(tm, tm->position));
+            
+            // Display tape before action
+            printf("Before Tape: ");
+            tm_print_window(tm, DISPLAY_SIZE / 2, 0, TAPE_LENGTH);
+            
+            printf("Action: Write %d, Move %s, Next State %d\n",
+                   rule.write, rule.move == 1 ? "Right" : "Left", rule.next);
         }
-        printf("\n");
-        
-        printf("Action: Write %d, Move %s, Next State %d\n",
-               rule.write_symbol, rule.move == 1 ? "Right" : "Left", rule.next_state);
-        tm->tape[tm->tape_position] = rule.write_symbol;
-        tm->tape_position += rule.move;
-        if (tm->tape_position < 0 || tm->tape_position >= TAPE_LENGTH) {
+        tm_apply(tm, &rule);
+        if (tm->position < 0 || tm->position >= TAPE_LENGTH) {
             printf("Error: Tape position out of bounds at step %d.\n", step);
             break;
         }
-        tm->current_state = rule.next_state;
-        tm->halt_step = step;
-        if (tm->current_state == num_states) {
-            tm->halted = 1;
-        }
         
-        // Display new position after action
-        printf("After Position: %d\n", tm->tape_position);
+        if (show) {
+            // Display new position after action
+            printf("After Position: %lld\n", (long long)tm->position);
+            
+            // Display tape after action
+            printf("After Tape: ");
+            tm_print_window(tm, DISPLAY_SIZE / 2, 0, TAPE_LENGTH);
+        } else if (break_at(&breaks, BREAK_STEP, step) || break_at(&breaks, BREAK_STATE, tm->state) ||
+                   (tm->halted && break_at(&breaks, BREAK_HALT, 0)) ||
+                   ((tm->position < window_start || tm->position > window_end) &&
+                    break_at(&breaks, BREAK_WINDOW, 0))) {
+            print_break(tm);
+            show = 1;
+        }
         
-        // Display tape after action
-        printf("After Tape: ");
-        start = tm->tape_position - DISPLAY_SIZE / 2;
-        end = tm->tape_position + DISPLAY_SIZE / 2;
-        for (int i = start; i <= end; i++) {
-            if (i >= 0 && i < TAPE_LENGTH) {
-                if (i == tm->tape_position) {
-                    printf("[%d]", tm->tape[i]);
-                } else {
-                    printf("%d", tm->tape[i]);
-                }
+        if (!tm->halted && show) {
+            window_start = tm->position - DISPLAY_SIZE / 2;
+            window_end = tm->position + DISPLAY_SIZE / 2;
+            if (breaks.enabled) {
+                break_wait(&breaks);
             } else {
-                printf(" ");
+                printf("Press Enter to continue...\n");
+                int c;
+                while ((c = getchar()) != '\n' && c != EOF); // Clear input buffer
             }
-            if (i < end) printf(" ");
-        }
-        printf("\n");
-        
-        if (!tm->halted) {
-            printf("Press Enter to continue...\n");
-            int c;
-            while ((c = getchar()) != '\n' && c != EOF); // Clear input buffer
         }
     }
 }
 
-void print_final_state(TuringMachine *tm) {
-    printf("\nFinal State: %d, Position: %d, Halted: %d, Halt Step: %d\n",
-           tm->current_state, tm->tape_position, tm->halted, tm->halt_step);
+void print_final_state(TmMachine *tm) {
+    printf("\nFinal State: %d, Position: %lld, Halted: %d, Halt Step: %llu\n",
+           tm->state, (long long)tm->position, tm->halted, (unsigned long long)tm->steps);
     printf("Final Tape: ");
-    int start = tm->tape_position - DISPLAY_SIZE / 2;
-    int end = tm->tape_position + DISPLAY_SIZE / 2;
-    for (int i = start; i <= end; i++) {
-        if (i >= 0 && i < TAPE_LENGTH) {
-            if (i == tm->tape_position) {
-                printf("[%d]", tm->tape[i]);
-            } else {
-                printf("%d", tm->tape[i]);
-            }
-        } else {
-            printf(" ");
-        }
-        if (i < end) printf(" ");
+    tm_print_window(tm, DISPLAY_SIZE / 2, 0, TAPE_LENGTH);
+    if (snapshot_path) save_snapshot(tm, 0);
+}
+
+// Write the machine in the format ittm_dovetail --load reads (tm_write_text)
+int export_machine(const char *path, TmMachine *tm) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        perror(path);
+        return 0;
     }
-    printf("\n");
+    tm_write_text(f, tm);
+    fclose(f);
+    printf("Machine exported to %s\n", path);
+    return 1;
 }
 
 int main(int argc, char *argv[]) {
     int num_states = 2; // Default to 2 states (0, 1, with 2 as halt)
-    if (argc > 1) {
-        num_states = atoi(argv[1]);
+    const char *export_path = NULL; // --export=FILE: write the machine for ittm_dovetail --load
+    for (int a = 1; a < argc; a++) {
+        if (strncmp(argv[a], "--export=", 9) == 0) {
+            export_path = argv[a] + 9;
+            continue;
+        }
+        if (strncmp(argv[a], "--break=", 8) == 0) {
+            if (!break_parse(&breaks, argv[a] + 8, 1 << BREAK_STEP | 1 << BREAK_STATE | 1 << BREAK_HALT | 1 << BREAK_WINDOW)) return 1;
+            continue;
+        }
+        if (strcmp(argv[a], "--run") == 0) {
+            breaks.enabled = 1;
+            continue;
+        }
+        if (strncmp(argv[a], "--steps=", 8) == 0) {
+            max_steps = atoi(argv[a] + 8);
+            continue;
+        }
+        if (strncmp(argv[a], "--snapshot=", 11) == 0) {
+            snapshot_path = argv[a] + 11;
+            continue;
+        }
+        if (strncmp(argv[a], "--tape=", 7) == 0) {
+            tape_path = tm_tape_spec(argv[a] + 7, &tape_format);
+            continue;
+        }
+        num_states = atoi(argv[a]);
         if (num_states < 1 || num_states > 100) {
             printf("Error: Number of states must be between 1 and 100.\n");
             return 1;
         }
     }
     printf("Starting Turing Machine simulation with %d states...\n", num_states);
-    TuringMachine tm = {0, 500, 0, 0, {0}};
-    Rule **rules;
-    initialize_tape(&tm);
-    setup_rules(&rules, num_states);
-    simulate(&tm, rules, num_states);
+    TmMachine tm;
+    tm_init(&tm, &machine_arena, num_states, NUM_SYMBOLS, 500, 0);
+    if (tape_path) {
+        if (!tm_map_tape(&tm, tape_path, tape_format, 500)) {
+            free_machine();
+            return 1;
+        }
+        printf("Initial Tape: ");
+        tm_print_window(&tm, DISPLAY_SIZE / 2, 0, TAPE_LENGTH);
+    } else {
+        initialize_tape(&tm);
+    }
+    setup_rules(&tm);
+    if (export_path) {
+        int ok = export_machine(export_path, &tm);
+        free_machine();
+        return ok ? 0 : 1;
+    }
+    simulate(&tm);
     print_final_state(&tm);
-    free_rules(rules, num_states);
+    free_machine();
     return 0;
 }
\ No newline at end of file
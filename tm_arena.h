@@ -0,0 +1,180 @@
+// Arena allocator for machine tapes and rule tables
+
+// Allocations are carved from ARENA_PAGE_SIZE pages in power-of-two size
+// classes. A freed allocation goes on its class's free list and is reused
+// by the next allocation of that class, so tapes can start small, grow a
+// class at a time, and be recycled when their machine halts. Requests larger
+// than a page get a block of their own, which goes back to malloc when it is
+// freed. The whole arena is released at once at the end of a run.
+
+#ifndef TM_ARENA_H
+#define TM_ARENA_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#define ARENA_PAGE_SIZE (1 << 16)  // Bytes per page (larger requests get their own)
+#define ARENA_MIN_CLASS 4          // Smallest size class: 2^4 = 16 bytes
+#define ARENA_CLASSES 13           // Size classes 2^4 .. 2^16
+
+typedef struct ArenaPage {
+    struct ArenaPage *next;        // Earlier page
+    size_t size;                   // Usable bytes after the header
+    size_t used;
+    struct ArenaPage *prev;        // Large blocks: later block (also keeps the data 16-byte aligned)
+} ArenaPage;
+
+typedef struct ArenaFree {
+    struct ArenaFree *next;
+} ArenaFree;
+
+typedef struct {
+    ArenaPage *head;               // Page being filled
+    ArenaPage *large;              // Blocks of requests larger than a page, newest first
+    ArenaFree *free_list[ARENA_CLASSES];
+    size_t in_use;                 // Bytes held by live allocations (rounded to their class)
+    size_t reserved;               // Bytes held in pages
+    size_t recycled;               // Allocations served from a free list
+} Arena;
+
+// Size class of a request (ARENA_CLASSES for requests larger than a page)
+static inline int arena_class(size_t size) {
+    int c = 0;
+    while (c < ARENA_CLASSES && ((size_t)1 << (c + ARENA_MIN_CLASS)) < size) c++;
+    return c;
+}
+
+// Bytes actually set aside for a request of size bytes
+static inline size_t arena_rounded(size_t size) {
+    int c = arena_class(size);
+    return c < ARENA_CLASSES ? (size_t)1 << (c + ARENA_MIN_CLASS) : (size + 15) & ~(size_t)15;
+}
+
+// Start a new page with room for at least size bytes
+static inline ArenaPage *arena_new_page(Arena *a, size_t size) {
+    size_t page_size = size > ARENA_PAGE_SIZE ? size : ARENA_PAGE_SIZE;
+    ArenaPage *p = malloc(sizeof(ArenaPage) + page_size);
+    if (!p) {
+        printf("Error: Arena out of memory (%zu bytes).\n", page_size);
+        exit(1);
+    }
+    p->next = a->head;
+    p->size = page_size;
+    p->used = 0;
+    a->head = p;
+    a->reserved += page_size;
+    return p;
+}
+
+// Give a request larger than a page a block of its own; NULL if malloc fails
+static inline void *arena_alloc_large(Arena *a, size_t size) {
+    ArenaPage *p = size < SIZE_MAX - sizeof(ArenaPage) ? malloc(sizeof(ArenaPage) + size) : NULL;
+    if (!p) return NULL;
+    p->next = a->large;
+    p->prev = NULL;
+    p->size = size;
+    p->used = size;
+    if (a->large) a->large->prev = p;
+    a->large = p;
+    a->reserved += size;
+    return p + 1;
+}
+
+// Allocate size bytes, zeroed and 16-byte aligned
+static inline void *arena_alloc(Arena *a, size_t size) {
+    int c = arena_class(size);
+    size = arena_rounded(size);
+    void *ptr;
+    if (c == ARENA_CLASSES) {
+        ptr = arena_alloc_large(a, size);
+        if (!ptr) {
+            printf("Error: Arena out of memory (%zu bytes).\n", size);
+            exit(1);
+        }
+    } else if (a->free_list[c]) {
+        ptr = a->free_list[c];
+        a->free_list[c] = a->free_list[c]->next;
+        a->recycled++;
+    } else {
+        ArenaPage *p = a->head;
+        if (!p || p->size - p->used < size) {
+            // A page's unused tail is handed to the free lists, largest classes first
+            for (int k = ARENA_CLASSES - 1; p && k >= 0; k--) {
+                size_t bytes = (size_t)1 << (k + ARENA_MIN_CLASS);
+                while (p->size - p->used >= bytes) {
+                    ArenaFree *f = (ArenaFree *)((char *)(p + 1) + p->used);
+                    f->next = a->free_list[k];
+                    a->free_list[k] = f;
+                    p->used += bytes;
+                }
+            }
+            p = arena_new_page(a, size);
+        }
+        ptr = (char *)(p + 1) + p->used;
+        p->used += size;
+    }
+    a->in_use += size;
+    memset(ptr, 0, size);
+    return ptr;
+}
+
+// arena_alloc() for sizes that come from untrusted input: NULL instead of
+// exiting when a request larger than a page cannot be met
+static inline void *arena_try_alloc(Arena *a, size_t size) {
+    if (arena_class(size) < ARENA_CLASSES) return arena_alloc(a, size);
+    if (size > SIZE_MAX - 16) return NULL;
+    size = arena_rounded(size);
+    void *ptr = arena_alloc_large(a, size);
+    if (!ptr) return NULL;
+    a->in_use += size;
+    memset(ptr, 0, size);
+    return ptr;
+}
+
+// Return an allocation of size bytes to its class's free list, or a block
+// larger than a page to malloc
+static inline void arena_free(Arena *a, void *ptr, size_t size) {
+    int c = arena_class(size);
+    if (!ptr) return;
+    a->in_use -= arena_rounded(size);
+    if (c == ARENA_CLASSES) {
+        ArenaPage *p = (ArenaPage *)ptr - 1;
+        if (p->prev) p->prev->next = p->next;
+        else a->large = p->next;
+        if (p->next) p->next->prev = p->prev;
+        a->reserved -= p->size;
+        free(p);
+        return;
+    }
+    ArenaFree *f = ptr;
+    f->next = a->free_list[c];
+    a->free_list[c] = f;
+}
+
+// Move an allocation to a larger one; the new bytes are zero and the old block is recycled
+static inline void *arena_grow(Arena *a, void *ptr, size_t old_size, size_t new_size) {
+    if (arena_rounded(new_size) == arena_rounded(old_size)) return ptr;
+    void *grown = arena_alloc(a, new_size);
+    memcpy(grown, ptr, old_size);
+    arena_free(a, ptr, old_size);
+    return grown;
+}
+
+// Free every allocation at once
+static inline void arena_free_all(Arena *a) {
+    while (a->head) {
+        ArenaPage *next = a->head->next;
+        free(a->head);
+        a->head = next;
+    }
+    while (a->large) {
+        ArenaPage *next = a->large->next;
+        free(a->large);
+        a->large = next;
+    }
+    memset(a, 0, sizeof(*a));
+}
+
+#endif
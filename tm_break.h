@@ -0,0 +1,98 @@
+// Breakpoints and fast-forward for the interactive simulators
+
+// Without --break or --run the programs pause after every step or stage, as
+// they always have. With them, the simulation runs without output until a
+// breakpoint is hit, shows where it stopped, and waits: Enter runs on to the
+// next breakpoint, "s" then Enter takes a single step (or stage) at a time.
+//
+//   --break=step:N    after step N (personal step N of any machine in the ITTM programs)
+//   --break=stage:N   after dovetail stage N (ITTM programs)
+//   --break=state:Q   when a machine enters state Q
+//   --break=halt      when a machine halts; halt:M waits for machine M (ITTM programs)
+//   --break=window    when the head leaves the window shown at the last stop (tm_* programs)
+//   --run             no breakpoints: run straight to the end
+
+#ifndef TM_BREAK_H
+#define TM_BREAK_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_BREAKPOINTS 16
+
+#define BREAK_STEP 1
+#define BREAK_STAGE 2
+#define BREAK_STATE 3
+#define BREAK_HALT 4
+#define BREAK_WINDOW 5
+
+typedef struct {
+    int kind;
+    long long value;            // Step, stage or state; machine for BREAK_HALT (-1 = any)
+} Breakpoint;
+
+typedef struct {
+    Breakpoint points[MAX_BREAKPOINTS];
+    int count;
+    int enabled;                // --break or --run given: run headless between stops
+    int stepping;               // "s" at a stop: show and stop after every step again
+    int no_input;               // stdin closed: never wait again
+} Breakpoints;
+
+// Parse one --break=SPEC (spec points at SPEC); kinds is a mask of (1 << BREAK_*) the program supports
+static inline int break_parse(Breakpoints *b, const char *spec, int kinds) {
+    static const char *names[] = {NULL, "step", "stage", "state", "halt", "window"};
+    if (b->count == MAX_BREAKPOINTS) {
+        printf("Error: At most %d breakpoints.\n", MAX_BREAKPOINTS);
+        return 0;
+    }
+    for (int kind = BREAK_STEP; kind <= BREAK_WINDOW; kind++) {
+        size_t len = strlen(names[kind]);
+        if (strncmp(spec, names[kind], len) != 0 || (spec[len] != '\0' && spec[len] != ':')) continue;
+        if (!(kinds & (1 << kind))) break;
+        Breakpoint *p = &b->points[b->count];
+        p->kind = kind;
+        p->value = -1;
+        if (spec[len] == ':') {
+            char *end;
+            p->value = strtoll(spec + len + 1, &end, 10);
+            if (*end || end == spec + len + 1 || p->value < 0) break;
+        } else if (kind != BREAK_HALT && kind != BREAK_WINDOW) {
+            break; // step, stage and state need a value
+        }
+        b->count++;
+        b->enabled = 1;
+        return 1;
+    }
+    printf("Error: Unsupported breakpoint '%s'.\n", spec);
+    return 0;
+}
+
+// Whether a breakpoint of this kind matches value (halt and window match any value unless given one)
+static inline int break_at(const Breakpoints *b, int kind, long long value) {
+    for (int i = 0; i < b->count; i++) {
+        if (b->points[i].kind == kind && (b->points[i].value < 0 || b->points[i].value == value)) return 1;
+    }
+    return 0;
+}
+
+// Whether every step should be shown: no breakpoints given, or single-stepping from a stop
+static inline int break_showing(const Breakpoints *b) {
+    return !b->enabled || b->stepping;
+}
+
+// Wait at a stop: Enter runs to the next breakpoint, "s" steps; EOF runs to the end
+static inline void break_wait(Breakpoints *b) {
+    char line[64];
+    if (b->no_input) return;
+    printf("Enter runs to the next breakpoint, s + Enter steps...\n");
+    if (!fgets(line, sizeof(line), stdin)) {
+        b->no_input = 1;
+        b->stepping = 0;
+        return;
+    }
+    b->stepping = (line[0] == 's');
+}
+
+#endif
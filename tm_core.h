@@ -0,0 +1,496 @@
+// Reentrant Turing machine core for the tm_* programs and ittm_dovetail --load
+
+// A TmMachine holds everything one run needs: its state, its head, a
+// two-way tape that grows on demand and a flat rule table. The tape and
+// rules come from an Arena the caller owns, and no function here touches
+// anything outside the machine and its arena, so separate simulations (one
+// arena each) can run side by side in one process.
+//
+// tm_apply() and tm_step() take single steps for front-ends that show each
+// one. TM_DEFINE_KERNEL(name, STATES, SYMBOLS, MOVES) generates a run loop
+// specialised on the halt state, symbol count and move set: with constant
+// arguments the table stride and halt test are immediates, and right-only
+// machines never load a move. tm_kernel() picks the tightest kernel that
+// fits a machine.
+//
+// tm_map_tape() puts a tape file under a machine instead: raw files become
+// the cells themselves through a private mapping, so large inputs start
+// without a parse or copy pass.
+
+#ifndef TM_CORE_H
+#define TM_CORE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "tm_arena.h"
+
+#define TM_TAPE_MIN 16     // Initial cells of a tape
+#define TM_MOVES_RIGHT 1   // Move set: every rule moves right
+#define TM_MOVES_ANY 2     // Move set: left, stay or right
+#define TM_TAPE_RAW 0      // Tape files: one byte per cell (the cells' own layout)
+#define TM_TAPE_BITS 1     // Tape files: eight cells per byte, first cell in bit 0
+#define TM_TAPE_RLE 2      // Tape files: runs of a symbol byte and a LEB128 count
+#define TM_TAPE_PAD (1 << 20) // Blank cells reserved on each side of a tape file
+#define TM_TEXT_POS_MAX (1LL << 60) // Largest position a machine file may give (either sign)
+
+typedef struct {
+    uint8_t write;
+    int8_t move;               // -1 (left), 0 (stay), 1 (right)
+    uint16_t next;             // num_states is the halt state
+} TmRule;
+
+typedef struct {
+    uint16_t num_states, num_symbols;
+    uint16_t state;
+    uint8_t halted;
+    uint64_t steps;            // Steps taken
+    int64_t position;          // Head position, any integer
+    int64_t origin;            // Position of cells[0]
+    uint64_t length;           // Cells allocated
+    uint8_t *cells;
+    TmRule *rules;             // rules[state * num_symbols + symbol]
+    Arena *arena;              // Holds cells and rules
+    uint64_t mapped;           // Bytes mapped for a tape file (tm_map_tape), 0 if cells are in the arena
+} TmMachine;
+
+typedef uint64_t (*TmKernel)(TmMachine *m, uint64_t max_steps);
+
+// 64-bit finalizer (MurmurHash3's fmix64) for the engines' hash tables
+static inline uint64_t tm_mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    return x ^ (x >> 33);
+}
+
+// Set up a machine with a blank tape and a zeroed rule table (every entry
+// writes 0, stays and goes to state 0 until set)
+static inline void tm_init(TmMachine *m, Arena *arena, int num_states, int num_symbols,
+                           int64_t position, int state) {
+    memset(m, 0, sizeof(*m));
+    m->arena = arena;
+    m->num_states = num_states;
+    m->num_symbols = num_symbols;
+    m->state = state;
+    m->halted = state == num_states;
+    m->position = m->origin = position;
+    m->length = TM_TAPE_MIN;
+    m->cells = arena_alloc(arena, m->length);
+    m->rules = arena_alloc(arena, (size_t)num_states * num_symbols * sizeof(TmRule));
+}
+
+static inline TmRule *tm_rule(const TmMachine *m, int state, int symbol) {
+    return &m->rules[state * m->num_symbols + symbol];
+}
+
+static inline void tm_set_rule(TmMachine *m, int state, int symbol, int write, int move, int next) {
+    *tm_rule(m, state, symbol) = (TmRule){write, move, next};
+}
+
+// Give the tape back: to the arena, or unmapped if it came from a file
+static inline void tm_free_tape(TmMachine *m) {
+    if (m->mapped) {
+        munmap(m->cells, m->mapped);
+    } else {
+        arena_free(m->arena, m->cells, m->length);
+    }
+    m->cells = NULL;
+    m->mapped = 0;
+}
+
+// Grow the tape so it covers pos, doubling toward the side that ran out;
+// 0 (the tape unchanged) if the larger tape cannot be allocated
+static inline int tm_try_grow(TmMachine *m, int64_t pos) {
+    if (pos >= m->origin && pos < m->origin + (int64_t)m->length) return 1;
+    int64_t length = m->length * 2;
+    while (pos < m->origin + (int64_t)m->length - length || pos >= m->origin + length) length *= 2;
+    int64_t origin = (pos < m->origin) ? m->origin + (int64_t)m->length - length : m->origin;
+    uint8_t *cells = arena_try_alloc(m->arena, length);
+    if (!cells) return 0;
+    memcpy(cells + (m->origin - origin), m->cells, m->length);
+    tm_free_tape(m);
+    m->cells = cells;
+    m->origin = origin;
+    m->length = length;
+    return 1;
+}
+
+static inline void tm_grow(TmMachine *m, int64_t pos) {
+    if (pos >= m->origin && pos < m->origin + (int64_t)m->length) return;
+    if (!tm_try_grow(m, pos)) {
+        printf("Error: Tape out of memory (growing to position %lld).\n", (long long)pos);
+        exit(1);
+    }
+}
+
+// Symbol at pos (blank outside the allocated cells)
+static inline int tm_read(const TmMachine *m, int64_t pos) {
+    if (pos < m->origin || pos >= m->origin + (int64_t)m->length) return 0;
+    return m->cells[pos - m->origin];
+}
+
+static inline void tm_write(TmMachine *m, int64_t pos, int symbol) {
+    tm_grow(m, pos);
+    m->cells[pos - m->origin] = symbol;
+}
+
+// The rule the machine would apply next
+static inline TmRule *tm_next_rule(const TmMachine *m) {
+    return tm_rule(m, m->state, m->cells[m->position - m->origin]);
+}
+
+// Apply a rule at the head (callers may pass an overridden copy of tm_next_rule)
+static inline int tm_apply(TmMachine *m, const TmRule *r) {
+    m->cells[m->position - m->origin] = r->write;
+    m->position += r->move;
+    m->state = r->next;
+    m->steps++;
+    tm_grow(m, m->position); // The head's cell always exists
+    m->halted = m->state == m->num_states;
+    return m->halted;
+}
+
+// One step; returns 1 once the machine has halted
+static inline int tm_step(TmMachine *m) {
+    return tm_apply(m, tm_next_rule(m));
+}
+
+// Run loop specialised on (halt state, symbols, move set); STATES and SYMBOLS
+// may be constants or m->num_states / m->num_symbols. Returns steps taken.
+#define TM_DEFINE_KERNEL(name, STATES, SYMBOLS, MOVES)                          \
+static inline uint64_t name(TmMachine *m, uint64_t max_steps) {                 \
+    uint64_t n = 0;                                                             \
+    uint32_t state = m->state;                                                  \
+    int64_t offset = m->position - m->origin; /* Head as an index into cells */ \
+    while (n < max_steps && state != (uint32_t)(STATES)) {                      \
+        uint8_t *cell = m->cells + offset;                                      \
+        const TmRule *r = &m->rules[state * (SYMBOLS) + *cell];                 \
+        *cell = r->write;                                                       \
+        offset += (MOVES) == TM_MOVES_RIGHT ? 1 : r->move;                      \
+        state = r->next;                                                        \
+        n++;                                                                    \
+        if ((uint64_t)offset >= m->length) { /* Off either end */               \
+            int64_t pos = m->origin + offset;                                   \
+            tm_grow(m, pos);                                                    \
+            offset = pos - m->origin;                                           \
+        }                                                                       \
+    }                                                                           \
+    m->position = m->origin + offset;                                           \
+    m->state = state;                                                           \
+    m->steps += n;                                                              \
+    m->halted = state == m->num_states;                                         \
+    return n;                                                                   \
+}
+
+TM_DEFINE_KERNEL(tm_run, m->num_states, m->num_symbols, TM_MOVES_ANY)
+TM_DEFINE_KERNEL(tm_run_ittm, 2, 2, TM_MOVES_RIGHT) // 2 states + halt, 2 symbols, moving right
+TM_DEFINE_KERNEL(tm_run_s2_right, m->num_states, 2, TM_MOVES_RIGHT)
+TM_DEFINE_KERNEL(tm_run_s2, m->num_states, 2, TM_MOVES_ANY)
+TM_DEFINE_KERNEL(tm_run_s3, m->num_states, 3, TM_MOVES_ANY)
+
+// The most specialised kernel that runs this machine exactly
+static inline TmKernel tm_kernel(const TmMachine *m) {
+    int right = 1;
+    for (int i = 0; i < m->num_states * m->num_symbols; i++) right &= m->rules[i].move == 1;
+    if (m->num_symbols == 2 && right) return m->num_states == 2 ? tm_run_ittm : tm_run_s2_right;
+    if (m->num_symbols == 2) return tm_run_s2;
+    if (m->num_symbols == 3) return tm_run_s3;
+    return tm_run;
+}
+
+// Little-endian integers and LEB128 counts (7 bits a byte, low first), as
+// the tape, snapshot and result files store them
+static inline void tm_put_le(FILE *f, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; i++) fputc((v >> (8 * i)) & 0xFF, f);
+}
+
+static inline uint64_t tm_get_le(FILE *f, int bytes) {
+    uint64_t v = 0;
+    for (int i = 0; i < bytes; i++) v |= (uint64_t)(fgetc(f) & 0xFF) << (8 * i);
+    return v;
+}
+
+// v as LEB128 at out; returns the bytes written (at most 10)
+static inline int tm_leb128_encode(uint8_t *out, uint64_t v) {
+    int n = 0;
+    for (; v >= 0x80; v >>= 7) out[n++] = (v & 0x7F) | 0x80;
+    out[n++] = v;
+    return n;
+}
+
+// The LEB128 value at data[*i], advancing *i; 0 if it runs to end or past 64 bits
+static inline int tm_leb128_decode(const uint8_t *data, uint64_t end, uint64_t *i, uint64_t *v) {
+    *v = 0;
+    for (int shift = 0; shift < 64 && *i < end; shift += 7) {
+        uint8_t byte = data[(*i)++];
+        *v |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return 1;
+    }
+    return 0;
+}
+
+static inline void tm_put_leb128(FILE *f, uint64_t v) {
+    uint8_t buf[10];
+    fwrite(buf, 1, tm_leb128_encode(buf, v), f);
+}
+
+static inline int tm_get_leb128(FILE *f, uint64_t *v) {
+    *v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int c = fgetc(f);
+        if (c == EOF) return 0;
+        *v |= (uint64_t)(c & 0x7F) << shift;
+        if (!(c & 0x80)) return 1;
+    }
+    return 0;
+}
+
+// TM_TAPE_RAW, TM_TAPE_BITS or TM_TAPE_RLE by name ("raw", "bits", "rle"), -1 if none
+static inline int tm_tape_format(const char *name) {
+    if (strcmp(name, "raw") == 0) return TM_TAPE_RAW;
+    if (strcmp(name, "bits") == 0) return TM_TAPE_BITS;
+    if (strcmp(name, "rle") == 0) return TM_TAPE_RLE;
+    return -1;
+}
+
+// The path in a "[FORMAT:]PATH" tape option, with its format (raw without a prefix)
+static inline const char *tm_tape_spec(const char *spec, int *format) {
+    char name[8];
+    const char *colon = strchr(spec, ':');
+    *format = TM_TAPE_RAW;
+    if (!colon || colon - spec >= (int)sizeof(name)) return spec;
+    memcpy(name, spec, colon - spec);
+    name[colon - spec] = 0;
+    if (tm_tape_format(name) < 0) return spec;
+    *format = tm_tape_format(name);
+    return colon + 1;
+}
+
+// Replace the tape with the cells of a tape file, its first cell at pos.
+// A raw file is mapped as the cells themselves (MAP_PRIVATE): nothing is
+// copied up front, pages are read on first touch and writes go to private
+// copies of pages, never to the file. Its symbols are checked against
+// num_symbols in one read-only pass, since the kernels index the rule table
+// with them. bits (two symbols) and rle files are decoded in one pass
+// straight into the mapping. The cells sit between TM_TAPE_PAD blank cells
+// on each side (anonymous pages, only allocated when touched), so the head
+// can go that far past the file before the tape is copied to grow. Returns
+// 0 with a message on failure.
+static inline int tm_map_tape(TmMachine *m, const char *path, int format, int64_t pos) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        perror(path);
+        if (fd >= 0) close(fd);
+        return 0;
+    }
+    uint64_t size = st.st_size, cells = size;
+    const uint8_t *file = NULL;
+    if (size) {
+        file = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (file == MAP_FAILED) {
+            perror(path);
+            close(fd);
+            return 0;
+        }
+    }
+    const char *error = NULL;
+    if (format == TM_TAPE_RAW && m->num_symbols < 256) {
+        uint64_t high = 0, i = 0, ones = 0x0101010101010101ULL;
+        if (m->num_symbols <= 128) { // Eight cells at a time: bit 7 of a byte ends up set iff it is >= num_symbols
+            uint64_t add = ones * (128 - m->num_symbols);
+            for (; i + 8 <= size; i += 8) {
+                uint64_t x;
+                memcpy(&x, file + i, 8);
+                high |= (x + add) | x;
+            }
+            high &= ones << 7;
+        }
+        for (; i < size; i++) high |= file[i] >= m->num_symbols;
+        if (high) error = "symbol out of range";
+    } else if (format == TM_TAPE_BITS) {
+        cells = size * 8;
+        if (m->num_symbols < 2) error = "bits tapes need two symbols";
+    } else if (format == TM_TAPE_RLE) { // First pass: the decoded length
+        cells = 0;
+        for (uint64_t i = 0; i < size && !error;) {
+            uint64_t count;
+            if (file[i++] >= m->num_symbols) error = "symbol out of range";
+            else if (!tm_leb128_decode(file, size, &i, &count)) error = "truncated run";
+            else cells += count;
+        }
+    } else if (format != TM_TAPE_RAW) {
+        error = "unknown format";
+    }
+    uint64_t page = sysconf(_SC_PAGESIZE);
+    uint64_t total = (TM_TAPE_PAD + cells + TM_TAPE_PAD + page - 1) / page * page;
+    uint8_t *base = MAP_FAILED;
+    if (!error) {
+        base = mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (base == MAP_FAILED) error = strerror(errno);
+    }
+    if (!error && format == TM_TAPE_RAW && size) {
+        if (mmap(base + TM_TAPE_PAD, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+            error = strerror(errno);
+        }
+    } else if (!error && format == TM_TAPE_BITS) {
+        for (uint64_t i = 0; i < size; i++) {
+            for (int b = 0; b < 8; b++) base[TM_TAPE_PAD + i * 8 + b] = (file[i] >> b) & 1;
+        }
+    } else if (!error && format == TM_TAPE_RLE) { // Second pass: the cells
+        uint8_t *out = base + TM_TAPE_PAD;
+        for (uint64_t i = 0; i < size;) {
+            uint8_t symbol = file[i++];
+            uint64_t count;
+            tm_leb128_decode(file, size, &i, &count); // Checked by the first pass
+            if (symbol) memset(out, symbol, count); // Blank runs stay untouched zero pages
+            out += count;
+        }
+    }
+    if (file) munmap((void *)file, size);
+    close(fd);
+    if (error) {
+        if (base != MAP_FAILED) munmap(base, total);
+        printf("%s: %s.\n", path, error);
+        return 0;
+    }
+    tm_free_tape(m);
+    m->cells = base;
+    m->origin = pos - TM_TAPE_PAD;
+    m->length = m->mapped = total;
+    tm_grow(m, m->position); // The head's cell always exists
+    return 1;
+}
+
+// Read the next machine from a file written by tm_write_text()
+// Format: "machine STATES SYMBOLS", "start POSITION STATE", "tapefile
+// POSITION FORMAT PATH" (tm_map_tape), "tape POSITION SYMBOL...", one "rule
+// STATE SYMBOL WRITE MOVE NEXT" per entry, then "end". Entries without a
+// rule halt in place. Positions lie within TM_TEXT_POS_MAX of 0, and the
+// head and the tape lines within max_cells cells of each other; tapefile
+// lines are malformed unless tape_files is set. Returns 1
+// on a machine, 0 at end of file, -1 on a malformed one (or one whose tape
+// cannot be allocated), whose tape and rules go back to the arena.
+static inline int tm_read_text_limited(FILE *f, TmMachine *m, Arena *arena, uint64_t max_cells, int tape_files) {
+    char word[16];
+    unsigned states, symbols;
+    if (fscanf(f, " %15s", word) != 1) return 0;
+    if (strcmp(word, "machine") != 0 || fscanf(f, "%u %u", &states, &symbols) != 2 ||
+        states < 1 || states > 65535 || symbols < 1 || symbols > 256) return -1;
+    tm_init(m, arena, states, symbols, 0, 0);
+    for (uint32_t i = 0; i < states * symbols; i++) {
+        m->rules[i].write = i % symbols;
+        m->rules[i].next = states;
+    }
+    int started = 0; // Set once the head position is fixed
+    int ok = 1;
+    int64_t lo = 0, hi = 0; // Cells the head and the tape lines span
+    while (ok && fscanf(f, " %15s", word) == 1 && strcmp(word, "end") != 0) {
+        if (strcmp(word, "start") == 0) { // Must precede the tape lines
+            long long pos;
+            unsigned state;
+            ok = !started && fscanf(f, "%lld %u", &pos, &state) == 2 && state <= states &&
+                 pos >= -TM_TEXT_POS_MAX && pos <= TM_TEXT_POS_MAX;
+            if (!ok) break;
+            m->position = m->origin = lo = hi = pos;
+            m->state = state;
+            m->halted = state == states;
+            started = 1;
+        } else if (strcmp(word, "tapefile") == 0) { // Replaces the tape, so it precedes the tape lines
+            long long pos;
+            char format[16], path[4096];
+            ok = tape_files && fscanf(f, "%lld %15s %4095s", &pos, format, path) == 3 && tm_tape_format(format) >= 0 &&
+                 pos >= -TM_TEXT_POS_MAX && pos <= TM_TEXT_POS_MAX &&
+                 tm_map_tape(m, path, tm_tape_format(format), pos);
+            started = 1;
+        } else if (strcmp(word, "tape") == 0) {
+            long long pos;
+            char *line = NULL, *p, *end;
+            size_t cap = 0;
+            ok = fscanf(f, "%lld", &pos) == 1 && getline(&line, &cap, f) >= 0;
+            for (p = line; ok; p = end) { // Symbols to the end of the line
+                unsigned long sym = strtoul(p, &end, 10);
+                if (end == p) break;
+                int64_t new_lo = pos < lo ? pos : lo, new_hi = pos > hi ? pos : hi;
+                ok = sym < symbols && pos >= -TM_TEXT_POS_MAX && pos <= TM_TEXT_POS_MAX &&
+                     (uint64_t)(new_hi - new_lo) < max_cells && tm_try_grow(m, pos);
+                if (!ok) break;
+                m->cells[pos++ - m->origin] = sym;
+                lo = new_lo;
+                hi = new_hi;
+            }
+            started = 1;
+            free(line);
+        } else if (strcmp(word, "rule") == 0) {
+            unsigned state, sym, write, next;
+            int move;
+            ok = fscanf(f, "%u %u %u %d %u", &state, &sym, &write, &move, &next) == 5 &&
+                 state < states && sym < symbols && write < symbols && move >= -1 && move <= 1 &&
+                 next <= states;
+            if (ok) tm_set_rule(m, state, sym, write, move, next);
+        } else {
+            ok = 0;
+        }
+    }
+    if (!ok) {
+        tm_free_tape(m);
+        arena_free(arena, m->rules, (size_t)states * symbols * sizeof(TmRule));
+        m->rules = NULL;
+        return -1;
+    }
+    return 1;
+}
+
+// tm_read_text_limited() for trusted files: any extent that fits in memory, tape files allowed
+static inline int tm_read_text(FILE *f, TmMachine *m, Arena *arena) {
+    return tm_read_text_limited(f, m, arena, UINT64_MAX, 1);
+}
+
+// Write a machine for tm_read_text(): start, the nonblank part of the tape, every rule
+static inline void tm_write_text(FILE *f, const TmMachine *m) {
+    int64_t first = -1, last = -1;
+    for (uint64_t i = 0; i < m->length; i++) {
+        if (m->cells[i]) {
+            if (first < 0) first = i;
+            last = i;
+        }
+    }
+    fprintf(f, "machine %d %d\n", m->num_states, m->num_symbols);
+    fprintf(f, "start %lld %d\n", (long long)m->position, m->state);
+    if (last >= 0) {
+        fprintf(f, "tape %lld", (long long)(m->origin + first));
+        for (int64_t i = first; i <= last; i++) fprintf(f, " %d", m->cells[i]);
+        fprintf(f, "\n");
+    }
+    for (int state = 0; state < m->num_states; state++) {
+        for (int symbol = 0; symbol < m->num_symbols; symbol++) {
+            const TmRule *r = tm_rule(m, state, symbol);
+            fprintf(f, "rule %d %d %d %d %d\n", state, symbol, r->write, r->move, r->next);
+        }
+    }
+    fprintf(f, "end\n");
+}
+
+// Print the cells within radius of the head, the head's in brackets; cells
+// outside [lo, hi) print as blanks (the tm_* programs' fixed tape bounds)
+static inline void tm_print_window(const TmMachine *m, int radius, int64_t lo, int64_t hi) {
+    for (int64_t i = m->position - radius; i <= m->position + radius; i++) {
+        if (i >= lo && i < hi) {
+            printf(i == m->position ? "[%d]" : "%d", tm_read(m, i));
+        } else {
+            printf(" ");
+        }
+        if (i < m->position + radius) printf(" ");
+    }
+    printf("\n");
+}
+
+#endif
@@ -0,0 +1,177 @@
+// Live display for the dovetail programs (--live=FPS)
+
+// The simulation runs at full speed and, whenever the display thread is
+// ready for a frame, copies its rows into the back buffer and publishes it.
+// The display thread draws at most fps frames per second, and redraws only
+// the rows that changed since the last frame (ANSI cursor addressing).
+// Enter toggles a pause, which holds the simulation at its next publish.
+
+#ifndef TM_DISPLAY_H
+#define TM_DISPLAY_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define DISPLAY_LINE 256 // Longest formatted row
+
+// Formats row index of a snapshot (rows points at row_size bytes) into line
+typedef void (*DisplayFormat)(const void *row, int index, char *line);
+
+typedef struct {
+    int num_rows;
+    size_t row_size;
+    DisplayFormat format;
+    const char *header;          // Column header, drawn once
+    double fps;
+    uint8_t *buffers[2];         // Snapshots: the display draws front, the simulation fills the other
+    char status[2][DISPLAY_LINE]; // Status line of each snapshot
+    int front;
+    uint8_t *shown;              // Rows as last drawn
+    int want_frame;              // Set by the display when it can take a snapshot
+    int fresh;                   // A published snapshot waits to be drawn
+    int paused, done;
+    int input_closed;            // stdin hit EOF: frames are paced by sleeping instead
+    long frames, published;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t thread;
+} Display;
+
+// Draw the front snapshot: rows that changed, then the status line
+static inline void display_draw(Display *d, int first) {
+    const uint8_t *rows = d->buffers[d->front];
+    char line[DISPLAY_LINE];
+    if (first) printf("\033[2J\033[1;1H%s\033[K", d->header);
+    for (int i = 0; i < d->num_rows; i++) {
+        const uint8_t *row = rows + i * d->row_size;
+        if (!first && memcmp(row, d->shown + i * d->row_size, d->row_size) == 0) continue;
+        d->format(row, i, line);
+        printf("\033[%d;1H%s\033[K", i + 2, line);
+    }
+    memcpy(d->shown, rows, d->num_rows * d->row_size);
+    printf("\033[%d;1H%s%s\033[K", d->num_rows + 2, d->status[d->front], d->paused ? " [paused]" : "");
+    fflush(stdout);
+    d->frames++;
+}
+
+// Toggle the pause if Enter was pressed within wait_ms, and show it on the status line
+static inline void display_poll_input(Display *d, int wait_ms) {
+    struct pollfd in = {STDIN_FILENO, POLLIN, 0};
+    char buf[64];
+    if (d->input_closed) {
+        struct timespec ts = {wait_ms / 1000, (wait_ms % 1000) * 1000000L};
+        nanosleep(&ts, NULL);
+        return;
+    }
+    if (poll(&in, 1, wait_ms) <= 0 || !(in.revents & (POLLIN | POLLHUP))) return;
+    if (read(STDIN_FILENO, buf, sizeof(buf)) <= 0) {
+        d->input_closed = 1;
+        return;
+    }
+    pthread_mutex_lock(&d->lock);
+    d->paused = !d->paused;
+    printf("\033[%d;1H%s%s\033[K", d->num_rows + 2, d->status[d->front], d->paused ? " [paused]" : "");
+    fflush(stdout);
+    pthread_cond_broadcast(&d->cond);
+    pthread_mutex_unlock(&d->lock);
+}
+
+static inline void *display_thread(void *arg) {
+    Display *d = arg;
+    long frame_ns = (long)(1e9 / d->fps);
+    int first = 1;
+    for (;;) {
+        pthread_mutex_lock(&d->lock);
+        d->want_frame = 1;
+        pthread_cond_broadcast(&d->cond);
+        while (!d->fresh && !d->done) { // Idle (or paused): keep watching the keyboard
+            pthread_mutex_unlock(&d->lock);
+            display_poll_input(d, 50);
+            pthread_mutex_lock(&d->lock);
+        }
+        if (!d->fresh) { // Done, and the last snapshot is drawn
+            pthread_mutex_unlock(&d->lock);
+            break;
+        }
+        d->fresh = 0;
+        pthread_mutex_unlock(&d->lock);
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        display_draw(d, first);
+        first = 0;
+        // Wait out the rest of the frame
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        long left = frame_ns - ((t1.tv_sec - t0.tv_sec) * 1000000000L + (t1.tv_nsec - t0.tv_nsec));
+        if (left > 0 && !d->done) display_poll_input(d, left / 1000000);
+    }
+    printf("\033[%d;1H\n", d->num_rows + 3);
+    fflush(stdout);
+    return NULL;
+}
+
+static inline void display_start(Display *d, int num_rows, size_t row_size, double fps,
+                                 DisplayFormat format, const char *header) {
+    memset(d, 0, sizeof(*d));
+    d->num_rows = num_rows;
+    d->row_size = row_size;
+    d->format = format;
+    d->header = header;
+    d->fps = fps > 0 ? fps : 10;
+    d->buffers[0] = calloc(num_rows, row_size);
+    d->buffers[1] = calloc(num_rows, row_size);
+    d->shown = calloc(num_rows, row_size);
+    pthread_mutex_init(&d->lock, NULL);
+    pthread_cond_init(&d->cond, NULL);
+    pthread_create(&d->thread, NULL, display_thread, d);
+}
+
+// Whether the display can take a snapshot now (one load: cheap to call every stage)
+static inline int display_due(Display *d) {
+    return __atomic_load_n(&d->want_frame, __ATOMIC_ACQUIRE);
+}
+
+// The buffer to fill before display_publish(); the display is not reading it
+static inline void *display_back(Display *d) {
+    return d->buffers[1 - d->front];
+}
+
+// Hand the back buffer and its status line to the display; waits while paused
+static inline void display_publish(Display *d, const char *status) {
+    pthread_mutex_lock(&d->lock);
+    snprintf(d->status[1 - d->front], DISPLAY_LINE, "%s", status);
+    d->front = 1 - d->front;
+    d->fresh = 1;
+    d->want_frame = 0;
+    d->published++;
+    pthread_cond_broadcast(&d->cond);
+    while (d->paused && !d->done) pthread_cond_wait(&d->cond, &d->lock);
+    pthread_mutex_unlock(&d->lock);
+}
+
+// Block until the display can take a snapshot (for the last one, which must not be skipped)
+static inline void display_wait(Display *d) {
+    pthread_mutex_lock(&d->lock);
+    while (!d->want_frame) pthread_cond_wait(&d->cond, &d->lock);
+    pthread_mutex_unlock(&d->lock);
+}
+
+// Stop the display once it has drawn everything published
+static inline void display_stop(Display *d) {
+    pthread_mutex_lock(&d->lock);
+    d->done = 1;
+    d->paused = 0;
+    pthread_cond_broadcast(&d->cond);
+    pthread_mutex_unlock(&d->lock);
+    pthread_join(d->thread, NULL);
+    free(d->buffers[0]);
+    free(d->buffers[1]);
+    free(d->shown);
+}
+
+#endif
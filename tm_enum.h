@@ -0,0 +1,338 @@
+// Tree-normal-form enumeration of blank-tape machines, children resuming from their parent
+
+// Machines are enumerated as a tree of partial rule tables. A node runs from
+// the blank tape until it reaches an entry that is still undefined (or runs
+// out of steps: undecided). That entry is where the machine halts if the
+// entry is the halt rule, so the node is one halting machine; its children
+// fill the entry with every normal-form rule instead (written symbols and
+// next states at most one past those used so far, the first move to the
+// right) and go on, as long as another undefined entry is left to halt on.
+// At power-of-two steps a node checks whether it runs away: only blank tape
+// ahead of the head and defined rules on blank that all move that way, which
+// never reach an undefined entry again, so the node and its subtree are done.
+//
+// A child behaves exactly like its parent up to that step, so it does not
+// start again from step 0: it forks the parent's configuration and resumes.
+// The tape is a directory of TM_ENUM_PAGE-cell pages with reference counts;
+// a fork copies only the directory and shares every page, and a page is
+// copied the first time the head enters it in a node that shares it (NULL
+// pages are blank). Simulation across the tree then costs one run per edge
+// instead of one run from the blank tape per node.
+//
+// Shards: with shards > 1 the nodes at split_depth are dealt out in
+// enumeration order, node k to shard k mod shards, and a shard runs only the
+// subtrees it was dealt. Nodes above split_depth are run by every shard (so
+// each one reaches the same split nodes in the same order) but counted by
+// shard 0 alone, so the shards' counts add up to the whole tree's. A node's
+// path (its child index at each level) identifies it across shards, and
+// record, if set, is called for every node the shard counts, in
+// depth-first order (tm_results.h keeps them).
+
+#ifndef TM_ENUM_H
+#define TM_ENUM_H
+
+#include "tm_core.h"
+
+#define TM_ENUM_PAGE_BITS 8
+#define TM_ENUM_PAGE (1 << TM_ENUM_PAGE_BITS) // Cells per tape page
+#define TM_ENUM_MAX_ENTRIES 64                // Most states * symbols
+#define TM_ENUM_UNDEFINED 0xFFFF              // TmRule.next of an entry not filled in yet
+#define TM_ENUM_AT_UNDEFINED 0                // Run results: reached an undefined entry
+#define TM_ENUM_OUT_OF_STEPS 1                // Ran out of steps (undecided)
+#define TM_ENUM_NEVER_HALTS 2                 // Proven to run away into blank tape
+#define TM_ENUM_FIRST_CHECK 16                // Runaway checks at steps 16, 32, 64 ...
+
+typedef struct {
+    uint32_t refs;             // Nodes sharing the page
+    uint8_t cells[TM_ENUM_PAGE];
+} TmEnumPage;
+
+typedef struct {
+    TmRule rules[TM_ENUM_MAX_ENTRIES]; // rules[state * num_symbols + symbol]
+    uint8_t states_used, symbols_used; // Highest next state / written symbol so far, plus one
+    uint8_t moved;             // A move is defined (the first one is fixed to the right)
+    uint8_t undefined;         // Entries not filled in yet
+    uint16_t state;
+    int64_t position;
+    uint64_t steps, marks;     // marks: nonblank cells
+    int64_t first_page;        // Page number of pages[0] (page p covers cells p * TM_ENUM_PAGE ...)
+    uint32_t num_pages;
+    TmEnumPage **pages;
+    uint8_t depth;             // Entries defined below the root
+    uint8_t path[TM_ENUM_MAX_ENTRIES]; // Child index taken at each level
+} TmEnumNode;
+
+struct TmEnum;
+
+// Called for each node a shard counts, with its run's TM_ENUM_* result
+// (TM_ENUM_AT_UNDEFINED: the node is a halting machine)
+typedef void (*TmEnumRecord)(void *arg, const struct TmEnum *en, const TmEnumNode *n, int result);
+
+typedef struct TmEnum {
+    int num_states, num_symbols;
+    uint64_t max_steps;        // Budget per machine
+    int resume;                // 0: every node runs from the blank tape (for comparison)
+    Arena *arena;              // Holds tape pages and directories
+    uint64_t nodes, halting, undecided, never_halts;
+    uint64_t steps_run;        // Steps simulated
+    uint64_t steps_resumed;    // Steps children did not run again thanks to their parent's snapshot
+    uint64_t pages_copied;
+    uint64_t best_steps, best_marks; // Champions among the halting machines
+    TmRule best_steps_rules[TM_ENUM_MAX_ENTRIES], best_marks_rules[TM_ENUM_MAX_ENTRIES];
+    uint32_t shard, shards;    // This process runs the split nodes dealt to shard (shards 1: all of them)
+    int split_depth;
+    uint64_t split_nodes;      // Split nodes dealt so far
+    TmEnumRecord record;
+    void *record_arg;
+} TmEnum;
+
+static inline void tm_enum_init(TmEnum *en, Arena *arena, int num_states, int num_symbols, uint64_t max_steps) {
+    memset(en, 0, sizeof(*en));
+    en->arena = arena;
+    en->num_states = num_states;
+    en->num_symbols = num_symbols;
+    en->max_steps = max_steps;
+    en->resume = 1;
+    en->shards = 1;
+}
+
+// The root: every entry undefined, blank tape, state 0
+static inline void tm_enum_root(const TmEnum *en, TmEnumNode *n) {
+    memset(n, 0, sizeof(*n));
+    for (int i = 0; i < en->num_states * en->num_symbols; i++) n->rules[i].next = TM_ENUM_UNDEFINED;
+    n->states_used = n->symbols_used = 1;
+    n->undefined = en->num_states * en->num_symbols;
+}
+
+// A node's pages are released; the rules and counters stay readable
+static inline void tm_enum_release(TmEnum *en, TmEnumNode *n) {
+    for (uint32_t i = 0; i < n->num_pages; i++) {
+        if (n->pages[i] && --n->pages[i]->refs == 0) arena_free(en->arena, n->pages[i], sizeof(TmEnumPage));
+    }
+    arena_free(en->arena, n->pages, n->num_pages * sizeof(TmEnumPage *));
+    n->pages = NULL;
+    n->num_pages = 0;
+}
+
+// child = parent's configuration, every page shared
+static inline void tm_enum_fork(TmEnum *en, TmEnumNode *child, const TmEnumNode *parent) {
+    *child = *parent;
+    if (!parent->num_pages) return;
+    child->pages = arena_alloc(en->arena, parent->num_pages * sizeof(TmEnumPage *));
+    memcpy(child->pages, parent->pages, parent->num_pages * sizeof(TmEnumPage *));
+    for (uint32_t i = 0; i < parent->num_pages; i++) {
+        if (child->pages[i]) child->pages[i]->refs++;
+    }
+}
+
+// Cells of page p, private to this node: the directory grows to cover it
+// (doubling toward the side that ran out) and a shared page is copied
+static inline uint8_t *tm_enum_page(TmEnum *en, TmEnumNode *n, int64_t p) {
+    if (!n->num_pages || p < n->first_page || p >= n->first_page + (int64_t)n->num_pages) {
+        uint32_t length = n->num_pages ? n->num_pages * 2 : 1;
+        int64_t first = n->num_pages ? n->first_page : p;
+        while (p < first + (int64_t)n->num_pages - length || p >= first + (int64_t)length) length *= 2;
+        if (p < first) first = first + n->num_pages - length;
+        TmEnumPage **pages = arena_alloc(en->arena, length * sizeof(TmEnumPage *));
+        if (n->num_pages) memcpy(pages + (n->first_page - first), n->pages, n->num_pages * sizeof(TmEnumPage *));
+        arena_free(en->arena, n->pages, n->num_pages * sizeof(TmEnumPage *));
+        n->pages = pages;
+        n->first_page = first;
+        n->num_pages = length;
+    }
+    TmEnumPage **slot = &n->pages[p - n->first_page];
+    if (!*slot) {
+        *slot = arena_alloc(en->arena, sizeof(TmEnumPage));
+        (*slot)->refs = 1;
+    } else if ((*slot)->refs > 1) {
+        TmEnumPage *copy = arena_alloc(en->arena, sizeof(TmEnumPage));
+        memcpy(copy->cells, (*slot)->cells, TM_ENUM_PAGE);
+        copy->refs = 1;
+        (*slot)->refs--;
+        *slot = copy;
+        en->pages_copied++;
+    }
+    return (*slot)->cells;
+}
+
+// Symbol at pos without making its page private
+static inline int tm_enum_read(const TmEnumNode *n, int64_t pos) {
+    int64_t p = pos >> TM_ENUM_PAGE_BITS;
+    if (p < n->first_page || p >= n->first_page + (int64_t)n->num_pages || !n->pages[p - n->first_page]) return 0;
+    return n->pages[p - n->first_page]->cells[pos & (TM_ENUM_PAGE - 1)];
+}
+
+// The head is on blank with only blank ahead, and the rules on blank are
+// defined and move that way for num_states steps: their states cycle, so the
+// machine moves out over blank tape forever
+static inline int tm_enum_runs_away(const TmEnum *en, const TmEnumNode *n) {
+    const TmRule *r = &n->rules[n->state * en->num_symbols];
+    if (r->next == TM_ENUM_UNDEFINED || r->move == 0 || tm_enum_read(n, n->position)) return 0;
+    int move = r->move;
+    int64_t end = move > 0 ? (n->first_page + n->num_pages) * TM_ENUM_PAGE : n->first_page * TM_ENUM_PAGE - 1;
+    for (int64_t pos = n->position + move; pos != end; pos += move) {
+        if (tm_enum_read(n, pos)) return 0;
+    }
+    uint32_t state = n->state;
+    for (int i = 0; i < en->num_states; i++, state = r->next) {
+        r = &n->rules[state * en->num_symbols];
+        if (r->next == TM_ENUM_UNDEFINED || r->move != move) return 0;
+    }
+    return 1;
+}
+
+// Run until the next entry is undefined, the node is proven to run away or
+// the step budget is spent
+static inline int tm_enum_run(TmEnum *en, TmEnumNode *n) {
+    const int symbols = en->num_symbols;
+    int64_t page = n->position >> TM_ENUM_PAGE_BITS;
+    int offset = n->position & (TM_ENUM_PAGE - 1);
+    uint8_t *cells = tm_enum_page(en, n, page);
+    uint32_t state = n->state;
+    uint64_t steps = n->steps, start = n->steps, marks = n->marks;
+    uint64_t check = TM_ENUM_FIRST_CHECK;
+    while (check < steps) check *= 2;
+    int result = TM_ENUM_AT_UNDEFINED;
+    for (;;) {
+        const TmRule *r = &n->rules[state * symbols + cells[offset]];
+        if (r->next == TM_ENUM_UNDEFINED) break;
+        if (steps >= en->max_steps) {
+            result = TM_ENUM_OUT_OF_STEPS;
+            break;
+        }
+        if (steps == check) {
+            n->position = page * TM_ENUM_PAGE + offset;
+            n->state = state;
+            check *= 2;
+            if (tm_enum_runs_away(en, n)) {
+                result = TM_ENUM_NEVER_HALTS;
+                break;
+            }
+        }
+        marks += (r->write != 0) - (cells[offset] != 0);
+        cells[offset] = r->write;
+        state = r->next;
+        steps++;
+        offset += r->move;
+        if ((unsigned)offset >= TM_ENUM_PAGE) { // Into the next page either way
+            page += offset < 0 ? -1 : 1;
+            offset &= TM_ENUM_PAGE - 1;
+            cells = tm_enum_page(en, n, page);
+        }
+    }
+    n->position = page * TM_ENUM_PAGE + offset;
+    n->state = state;
+    n->steps = steps;
+    n->marks = marks;
+    en->steps_run += steps - start;
+    return result;
+}
+
+// Fill entry i of a node with a rule, keeping the normal-form counters
+static inline void tm_enum_define(TmEnumNode *n, int i, int write, int move, int next) {
+    n->rules[i] = (TmRule){write, move, next};
+    if (write + 1 > n->symbols_used) n->symbols_used = write + 1;
+    if (next + 1 > n->states_used) n->states_used = next + 1;
+    n->moved = 1;
+    n->undefined--;
+}
+
+// Marks of the node as a halting machine (the halting step writes 1)
+static inline uint64_t tm_enum_halt_marks(const TmEnum *en, const TmEnumNode *n) {
+    return n->marks + (tm_enum_read(n, n->position) == 0 && en->num_symbols > 1);
+}
+
+// The node as a halting machine: its undefined entry under the head halts, writing 1
+static inline void tm_enum_halter(TmEnum *en, const TmEnumNode *n, int entry) {
+    uint64_t steps = n->steps + 1;
+    uint64_t marks = tm_enum_halt_marks(en, n);
+    en->halting++;
+    if (steps > en->best_steps) {
+        en->best_steps = steps;
+        memcpy(en->best_steps_rules, n->rules, sizeof(n->rules));
+        en->best_steps_rules[entry] = (TmRule){en->num_symbols > 1, 1, en->num_states};
+    }
+    if (marks > en->best_marks) {
+        en->best_marks = marks;
+        memcpy(en->best_marks_rules, n->rules, sizeof(n->rules));
+        en->best_marks_rules[entry] = (TmRule){en->num_symbols > 1, 1, en->num_states};
+    }
+}
+
+// Enumerate the subtree under a node, depth first (the node's pages are left to the caller)
+static inline void tm_enum_expand(TmEnum *en, TmEnumNode *n) {
+    int counted = 1;
+    if (en->shards > 1) {
+        if (n->depth == en->split_depth && en->split_nodes++ % en->shards != en->shard) return; // Another shard's
+        counted = n->depth >= en->split_depth || en->shard == 0;
+    }
+    int result = tm_enum_run(en, n);
+    if (counted) {
+        en->nodes++;
+        if (en->record) en->record(en->record_arg, en, n, result);
+    }
+    if (result != TM_ENUM_AT_UNDEFINED) {
+        en->undecided += counted && result == TM_ENUM_OUT_OF_STEPS;
+        en->never_halts += counted && result == TM_ENUM_NEVER_HALTS;
+        return;
+    }
+    int entry = n->state * en->num_symbols + tm_enum_read(n, n->position);
+    if (counted) tm_enum_halter(en, n, entry);
+    if (n->undefined <= 1) return; // Filled in, it would leave nothing to halt on
+    int max_write = n->symbols_used < en->num_symbols ? n->symbols_used : en->num_symbols - 1;
+    int max_next = n->states_used < en->num_states ? n->states_used : en->num_states - 1;
+    int index = 0;
+    for (int write = 0; write <= max_write; write++) {
+        for (int move = n->moved ? -1 : 1; move <= 1; move += 2) {
+            for (int next = 0; next <= max_next; next++) {
+                TmEnumNode child;
+                if (en->resume) {
+                    tm_enum_fork(en, &child, n);
+                    en->steps_resumed += n->steps;
+                } else { // Same rules, from the blank tape
+                    tm_enum_root(en, &child);
+                    memcpy(child.rules, n->rules, sizeof(n->rules));
+                    child.states_used = n->states_used;
+                    child.symbols_used = n->symbols_used;
+                    child.moved = n->moved;
+                    child.undefined = n->undefined;
+                    memcpy(child.path, n->path, sizeof(n->path));
+                }
+                tm_enum_define(&child, entry, write, move, next);
+                child.path[n->depth] = index++;
+                child.depth = n->depth + 1;
+                tm_enum_expand(en, &child);
+                tm_enum_release(en, &child);
+            }
+        }
+    }
+}
+
+// Enumerate every machine of the enumerator's size
+static inline void tm_enum_all(TmEnum *en) {
+    TmEnumNode root;
+    tm_enum_root(en, &root);
+    tm_enum_expand(en, &root);
+    tm_enum_release(en, &root);
+}
+
+// Standard text for a rule table: "1RB1LB_1LA1RZ", "---" for undefined entries
+static inline char *tm_enum_format(char *buf, const TmRule *rules, int num_states, int num_symbols) {
+    char *p = buf;
+    for (int state = 0; state < num_states; state++) {
+        if (state) *p++ = '_';
+        for (int sym = 0; sym < num_symbols; sym++) {
+            const TmRule *r = &rules[state * num_symbols + sym];
+            if (r->next == TM_ENUM_UNDEFINED) {
+                p += sprintf(p, "---");
+            } else {
+                p += sprintf(p, "%d%c%c", r->write, r->move < 0 ? 'L' : r->move > 0 ? 'R' : 'N',
+                             r->next == num_states ? 'Z' : 'A' + r->next);
+            }
+        }
+    }
+    *p = 0;
+    return buf;
+}
+
+#endif
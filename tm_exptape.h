@@ -0,0 +1,635 @@
+// Exponent-notation tape for TmMachine rule tables: block counts as big integers, sweeps and proven rules
+
+// The tape is cut into macro cells of `block` cells each (block 1: plain
+// cells), and stored as two stacks of runs (macro cell, count) leading away
+// from the head, so "100^n 111 100^m" is three runs whatever n and m are;
+// blank tape beyond the last run is not stored. Run counts and the step
+// count are TmBig, fixed-width unsigned integers of TM_BIG_LIMBS 64-bit limbs.
+//
+// The head sits at one edge of a macro cell. A macro step runs the machine
+// inside the macro cell until the head leaves it (cached per macro cell,
+// state and edge); when it leaves on the far side in the state it came in
+// with (a sweep), it crosses the whole run of equal macro cells ahead in one
+// operation: n macro cells, n times the steps, one run written behind. A
+// sweep into blank tape that never ends is a proof of non-halting, as is a
+// macro cell the head never leaves.
+//
+// Rules: when the tape shape (state, edge, macro cell under the head, the
+// macro cell of every run) repeats with different counts, the macro steps
+// between the two occurrences are replayed symbolically, with every count a
+// variable y_i plus a known part. If the replay only ever takes cells off the
+// known parts and ends in the same shape with count i changed by a constant
+// d_i, that is a proven rule: shape(y + b) -> shape(y + b + d) in K + sum
+// B_i y_i steps for every y >= 0. The rule is then applied as many times as
+// the shrinking counts allow, in one operation, with the exact step total (a
+// sum of arithmetic series). A rule where no count shrinks is a proof of
+// non-halting. A count outgrowing TM_BIG_LIMBS limbs sets overflow and stops.
+
+#ifndef TM_EXPTAPE_H
+#define TM_EXPTAPE_H
+
+#include "tm_core.h"
+
+#define TM_BIG_LIMBS 8              // 512-bit counts and steps (up to ~1.3e154)
+#define TM_BIG_DIGITS 160           // Buffer size for a formatted TmBig
+#define TM_EXP_MAX_MACRO (1u << 24) // Most distinct macro cells (num_symbols^block)
+#define TM_EXP_MAX_RUNS 24          // Shapes with more runs are not remembered (no rules)
+#define TM_EXP_SYM_RUNS 64          // Runs a symbolic replay may grow to
+#define TM_EXP_HISTORY 1024         // Remembered shapes (direct-mapped)
+#define TM_EXP_MAX_PROOF 100000     // Longest replay (macro steps) tried as a rule
+#define TM_EXP_BASE_BITS 20         // Known part of a count in a replay is below 2^this
+
+#define TM_EXP_MOVES 0              // Macro rule outcomes: the head leaves the macro cell
+#define TM_EXP_HALTS 1              // The machine halts inside it
+#define TM_EXP_LOOPS 2              // The head never leaves it
+
+typedef struct {
+    uint64_t limb[TM_BIG_LIMBS];    // Least significant first
+} TmBig;
+
+static inline TmBig tm_big(uint64_t v) {
+    TmBig b = {{v}};
+    return b;
+}
+
+static inline int tm_big_cmp(const TmBig *a, const TmBig *b) {
+    for (int i = TM_BIG_LIMBS - 1; i >= 0; i--) {
+        if (a->limb[i] != b->limb[i]) return a->limb[i] < b->limb[i] ? -1 : 1;
+    }
+    return 0;
+}
+
+// Whether the value fits in bits (at most 64)
+static inline int tm_big_fits(const TmBig *a, int bits) {
+    for (int i = 1; i < TM_BIG_LIMBS; i++) {
+        if (a->limb[i]) return 0;
+    }
+    return bits >= 64 || a->limb[0] < ((uint64_t)1 << bits);
+}
+
+static inline int tm_big_is(const TmBig *a, uint64_t v) {
+    return tm_big_fits(a, 64) && a->limb[0] == v;
+}
+
+// a += b; returns 1 on overflow
+static inline int tm_big_add(TmBig *a, const TmBig *b) {
+    unsigned __int128 carry = 0;
+    for (int i = 0; i < TM_BIG_LIMBS; i++) {
+        carry += (unsigned __int128)a->limb[i] + b->limb[i];
+        a->limb[i] = (uint64_t)carry;
+        carry >>= 64;
+    }
+    return carry != 0;
+}
+
+static inline int tm_big_add_small(TmBig *a, uint64_t v) {
+    TmBig b = tm_big(v);
+    return tm_big_add(a, &b);
+}
+
+// a -= b (a >= b)
+static inline void tm_big_sub(TmBig *a, const TmBig *b) {
+    uint64_t borrow = 0;
+    for (int i = 0; i < TM_BIG_LIMBS; i++) {
+        uint64_t x = a->limb[i], y = b->limb[i];
+        a->limb[i] = x - y - borrow;
+        borrow = (x < y) || (x - y < borrow);
+    }
+}
+
+static inline void tm_big_sub_small(TmBig *a, uint64_t v) {
+    TmBig b = tm_big(v);
+    tm_big_sub(a, &b);
+}
+
+// a *= v; returns 1 on overflow
+static inline int tm_big_mul_small(TmBig *a, uint64_t v) {
+    unsigned __int128 carry = 0;
+    for (int i = 0; i < TM_BIG_LIMBS; i++) {
+        carry += (unsigned __int128)a->limb[i] * v;
+        a->limb[i] = (uint64_t)carry;
+        carry >>= 64;
+    }
+    return carry != 0;
+}
+
+// out = a * b; returns 1 on overflow
+static inline int tm_big_mul(TmBig *out, const TmBig *a, const TmBig *b) {
+    TmBig r = tm_big(0);
+    int overflow = 0;
+    for (int i = 0; i < TM_BIG_LIMBS; i++) {
+        if (!a->limb[i]) continue;
+        unsigned __int128 carry = 0;
+        for (int j = 0; j < TM_BIG_LIMBS; j++) {
+            if (i + j >= TM_BIG_LIMBS) {
+                overflow |= b->limb[j] != 0;
+                continue;
+            }
+            carry += (unsigned __int128)a->limb[i] * b->limb[j] + r.limb[i + j];
+            r.limb[i + j] = (uint64_t)carry;
+            carry >>= 64;
+        }
+        overflow |= carry != 0;
+    }
+    *out = r;
+    return overflow;
+}
+
+// a /= v; returns the remainder
+static inline uint64_t tm_big_div_small(TmBig *a, uint64_t v) {
+    unsigned __int128 rem = 0;
+    for (int i = TM_BIG_LIMBS - 1; i >= 0; i--) {
+        rem = (rem << 64) | a->limb[i];
+        a->limb[i] = (uint64_t)(rem / v);
+        rem %= v;
+    }
+    return (uint64_t)rem;
+}
+
+// Decimal into buf (TM_BIG_DIGITS bytes)
+static inline char *tm_big_format(char *buf, TmBig a) {
+    char digits[TM_BIG_DIGITS];
+    int n = 0;
+    TmBig zero = tm_big(0);
+    do {
+        digits[n++] = '0' + (int)tm_big_div_small(&a, 10);
+    } while (tm_big_cmp(&a, &zero) != 0);
+    for (int i = 0; i < n; i++) buf[i] = digits[n - 1 - i];
+    buf[n] = '\0';
+    return buf;
+}
+
+typedef struct {
+    uint32_t cell;                  // Macro cell: cell i of the block is digit i in base num_symbols
+    TmBig count;
+} TmRun;
+
+typedef struct {
+    TmRun *runs;                    // runs[count - 1] is next to the head
+    uint32_t count, capacity;
+} TmRunStack;
+
+// What the machine does in one macro cell from a state and edge
+typedef struct {
+    uint32_t write;                 // The macro cell afterwards
+    uint8_t outcome;                // TM_EXP_*
+    int8_t move;                    // Side it leaves by: -1 or 1
+    uint16_t next;                  // State * 2 + edge it enters the next macro cell at
+    uint64_t steps;
+} TmExpRule;
+
+typedef struct {
+    uint32_t cell;
+    uint16_t state;                 // State * 2 + edge
+    uint8_t used;
+    TmExpRule rule;
+} TmExpRuleSlot;
+
+// A shape seen before, with its counts then
+typedef struct {
+    uint64_t hash;
+    uint64_t macro_step;
+    uint32_t cell;
+    uint16_t state;
+    uint8_t used;
+    uint8_t num_runs[2];
+    TmRun runs[TM_EXP_MAX_RUNS];    // Left stack bottom to top, then right
+} TmExpShape;
+
+typedef struct {
+    uint16_t num_states, num_symbols;
+    const TmRule *rules;            // rules[state * num_symbols + symbol], num_states halts
+    int block;                      // Cells per macro cell
+    uint32_t num_cells;             // Distinct macro cells: num_symbols^block
+    TmRunStack side[2];             // 0: left of the head, 1: right
+    uint32_t cell;                  // Macro cell under the head
+    uint16_t state;                 // State * 2 + edge (0: the head is at its left cell, 1: right); halt * 2 once halted
+    uint8_t halted, infinite;       // infinite: proven never to halt
+    uint8_t overflow;               // A count outgrew TmBig: stopped
+    TmBig steps;
+    uint64_t macro_steps, sweeps, rules_proven; // Macro steps exclude rule applications
+    TmExpRuleSlot *rule_cache;
+    uint32_t rule_mask, rules_cached;
+    TmExpShape *history;            // TM_EXP_HISTORY entries
+} TmExpTape;
+
+// Nonblank cells in a macro cell
+static inline int tm_exp_cell_marks(const TmExpTape *e, uint32_t cell) {
+    int marks = 0;
+    for (int i = 0; i < e->block; i++, cell /= e->num_symbols) marks += cell % e->num_symbols != 0;
+    return marks;
+}
+
+// Run the machine inside one macro cell
+static inline TmExpRule tm_exp_compute_rule(const TmExpTape *e, uint32_t cell, int state) {
+    uint8_t cells[32];
+    uint32_t c = cell;
+    for (int i = 0; i < e->block; i++, c /= e->num_symbols) cells[i] = c % e->num_symbols;
+    int q = state >> 1, pos = (state & 1) ? e->block - 1 : 0;
+    TmExpRule r = {0, TM_EXP_LOOPS, 0, 0, 0};
+    // Inside configurations: position, state, contents; more steps than that is a loop
+    uint64_t limit = (uint64_t)e->block * e->num_states * e->num_cells;
+    while (r.steps <= limit) {
+        const TmRule *t = &e->rules[q * e->num_symbols + cells[pos]];
+        cells[pos] = t->write;
+        pos += t->move;
+        q = t->next;
+        r.steps++;
+        if (q == e->num_states) {
+            r.outcome = TM_EXP_HALTS;
+            break;
+        }
+        if (pos < 0 || pos >= e->block) {
+            r.outcome = TM_EXP_MOVES;
+            r.move = pos < 0 ? -1 : 1;
+            r.next = q * 2 + (pos < 0); // Entering the left neighbour at its right cell
+            break;
+        }
+    }
+    for (int i = e->block - 1; i >= 0; i--) r.write = r.write * e->num_symbols + cells[i];
+    return r;
+}
+
+// The macro rule for a macro cell, state and edge (computed once)
+static inline const TmExpRule *tm_exp_rule(TmExpTape *e, uint32_t cell, int state) {
+    uint32_t slot = tm_mix64((uint64_t)cell << 17 | state) & e->rule_mask;
+    while (e->rule_cache[slot].used) {
+        if (e->rule_cache[slot].cell == cell && e->rule_cache[slot].state == state) return &e->rule_cache[slot].rule;
+        slot = (slot + 1) & e->rule_mask;
+    }
+    if ((e->rules_cached + 1) * 2 > e->rule_mask) { // Keep the cache at most half full
+        TmExpRuleSlot *old = e->rule_cache;
+        uint32_t old_slots = e->rule_mask + 1;
+        e->rule_mask = e->rule_mask * 2 + 1;
+        e->rule_cache = calloc((size_t)e->rule_mask + 1, sizeof(TmExpRuleSlot));
+        for (uint32_t i = 0; i < old_slots; i++) {
+            if (!old[i].used) continue;
+            slot = tm_mix64((uint64_t)old[i].cell << 17 | old[i].state) & e->rule_mask;
+            while (e->rule_cache[slot].used) slot = (slot + 1) & e->rule_mask;
+            e->rule_cache[slot] = old[i];
+        }
+        free(old);
+        slot = tm_mix64((uint64_t)cell << 17 | state) & e->rule_mask;
+        while (e->rule_cache[slot].used) slot = (slot + 1) & e->rule_mask;
+    }
+    e->rules_cached++;
+    e->rule_cache[slot] = (TmExpRuleSlot){cell, state, 1, tm_exp_compute_rule(e, cell, state)};
+    return &e->rule_cache[slot].rule;
+}
+
+static inline void tm_exp_push(TmExpTape *e, int side, uint32_t cell, const TmBig *count) {
+    TmRunStack *s = &e->side[side];
+    if (s->count && s->runs[s->count - 1].cell == cell) {
+        e->overflow |= tm_big_add(&s->runs[s->count - 1].count, count);
+        return;
+    }
+    if (!s->count && cell == 0) return; // Blank against blank tape
+    if (s->count == s->capacity) {
+        s->capacity = s->capacity ? s->capacity * 2 : 16;
+        s->runs = realloc(s->runs, s->capacity * sizeof(TmRun));
+    }
+    s->runs[s->count++] = (TmRun){cell, *count};
+}
+
+// Take the macro cell next to the head off a side (blank past the last run)
+static inline uint32_t tm_exp_pop(TmExpTape *e, int side) {
+    TmRunStack *s = &e->side[side];
+    if (!s->count) return 0;
+    TmRun *r = &s->runs[s->count - 1];
+    uint32_t cell = r->cell;
+    tm_big_sub_small(&r->count, 1);
+    if (tm_big_is(&r->count, 0)) s->count--;
+    if (s->count == 1 && s->runs[0].cell == 0) s->count--; // Blanks out to blank tape
+    return cell;
+}
+
+// Set up from a machine's rules, tape, head and state (the rule table is
+// shared). Macro cells are laid out from the head, which starts at the left
+// cell of its own. Returns 0 if num_symbols^block is over TM_EXP_MAX_MACRO.
+static inline int tm_exp_init(TmExpTape *e, const TmMachine *m, int block) {
+    memset(e, 0, sizeof(*e));
+    e->num_states = m->num_states;
+    e->num_symbols = m->num_symbols;
+    e->rules = m->rules;
+    e->block = block;
+    e->num_cells = 1;
+    for (int i = 0; i < block; i++) {
+        if (block > 32 || e->num_cells > TM_EXP_MAX_MACRO / m->num_symbols) return 0;
+        e->num_cells *= m->num_symbols;
+    }
+    e->state = m->state * 2;
+    e->halted = m->halted;
+    // Macro cell j covers block cells from position + j * block; j runs over the allocated tape
+    int64_t lo = -((m->position - m->origin + block - 1) / block), hi = (m->origin + m->length - 1 - m->position) / block;
+    TmBig one = tm_big(1);
+    for (int64_t j = lo; j <= hi; j++) {
+        uint32_t cell = 0;
+        for (int i = block - 1; i >= 0; i--) cell = cell * m->num_symbols + tm_read(m, m->position + j * block + i);
+        if (j < 0) tm_exp_push(e, 0, cell, &one);
+        if (j == 0) e->cell = cell;
+    }
+    for (int64_t j = hi; j > 0; j--) { // The right stack is built from its far end
+        uint32_t cell = 0;
+        for (int i = block - 1; i >= 0; i--) cell = cell * m->num_symbols + tm_read(m, m->position + j * block + i);
+        tm_exp_push(e, 1, cell, &one);
+    }
+    e->rule_mask = 1023;
+    e->rule_cache = calloc(e->rule_mask + 1, sizeof(TmExpRuleSlot));
+    e->history = calloc(TM_EXP_HISTORY, sizeof(TmExpShape));
+    return 1;
+}
+
+static inline void tm_exp_free(TmExpTape *e) {
+    free(e->side[0].runs);
+    free(e->side[1].runs);
+    free(e->rule_cache);
+    free(e->history);
+}
+
+// One macro step: the machine inside one macro cell, or a sweep across a run
+static inline void tm_exp_step(TmExpTape *e) {
+    const TmExpRule *r = tm_exp_rule(e, e->cell, e->state);
+    TmBig n = tm_big(1);
+    e->macro_steps++;
+    if (r->outcome == TM_EXP_LOOPS) {
+        e->infinite = 1;
+        return;
+    }
+    if (r->outcome == TM_EXP_HALTS) {
+        e->cell = r->write;
+        e->overflow |= tm_big_add_small(&e->steps, r->steps);
+        e->state = e->num_states * 2;
+        e->halted = 1;
+        return;
+    }
+    int ahead = r->move > 0, behind = !ahead;
+    TmRunStack *s = &e->side[ahead];
+    if (r->next == e->state) { // Sweep: this macro cell and the run of equal ones ahead
+        if (s->count && s->runs[s->count - 1].cell == e->cell) {
+            e->overflow |= tm_big_add(&n, &s->runs[--s->count].count);
+        } else if (!s->count && e->cell == 0) { // Into blank tape, forever
+            e->infinite = 1;
+            return;
+        }
+        e->sweeps++;
+    }
+    tm_exp_push(e, behind, r->write, &n);
+    e->cell = tm_exp_pop(e, ahead);
+    e->overflow |= tm_big_mul_small(&n, r->steps);
+    e->overflow |= tm_big_add(&e->steps, &n);
+    e->state = r->next;
+}
+
+// Symbolic count: k + sum coef[i] * y_i
+typedef struct {
+    int64_t k;
+    int32_t coef[TM_EXP_MAX_RUNS];
+} TmSymCount;
+
+typedef struct {
+    uint32_t cell;
+    TmSymCount count;
+} TmSymRun;
+
+typedef struct {
+    TmSymRun side[2][TM_EXP_SYM_RUNS];
+    uint32_t count[2];
+    uint32_t cell;
+    uint16_t state;
+    TmSymCount steps;
+} TmSymTape;
+
+// a += b * factor
+static inline void tm_sym_add(TmSymCount *a, const TmSymCount *b, int64_t factor) {
+    a->k += b->k * factor;
+    for (int i = 0; i < TM_EXP_MAX_RUNS; i++) a->coef[i] += b->coef[i] * factor;
+}
+
+static inline int tm_sym_known(const TmSymCount *a) {
+    for (int i = 0; i < TM_EXP_MAX_RUNS; i++) {
+        if (a->coef[i]) return 0;
+    }
+    return 1;
+}
+
+// Returns 0 if the replay has outgrown TM_EXP_SYM_RUNS
+static inline int tm_sym_push(TmSymTape *t, int side, uint32_t cell, const TmSymCount *count) {
+    uint32_t *n = &t->count[side];
+    if (*n && t->side[side][*n - 1].cell == cell) {
+        tm_sym_add(&t->side[side][*n - 1].count, count, 1);
+        return 1;
+    }
+    if (!*n && cell == 0) return 1;
+    if (*n == TM_EXP_SYM_RUNS) return 0;
+    t->side[side][(*n)++] = (TmSymRun){cell, *count};
+    return 1;
+}
+
+// Take one macro cell; returns -1 unless the count is known to be at least 1
+// before and afterwards (or known to reach exactly 0)
+static inline int64_t tm_sym_pop(TmSymTape *t, int side) {
+    uint32_t *n = &t->count[side];
+    if (!*n) return 0;
+    TmSymRun *r = &t->side[side][*n - 1];
+    if (r->count.k < 1) return -1;
+    r->count.k--;
+    uint32_t cell = r->cell;
+    if (tm_sym_known(&r->count)) {
+        if (r->count.k == 0) (*n)--;
+    } else if (r->count.k < 1) {
+        return -1; // y_i + 0 macro cells might be none: the shape would depend on y
+    }
+    if (*n == 1 && t->side[side][0].cell == 0) (*n)--;
+    return cell;
+}
+
+// Replay macro steps on symbolic counts; returns 0 if any step depends on a variable
+static inline int tm_sym_run(TmExpTape *e, TmSymTape *t, uint64_t macro_steps) {
+    for (uint64_t i = 0; i < macro_steps; i++) {
+        const TmExpRule *r = tm_exp_rule(e, t->cell, t->state);
+        TmSymCount n = {1, {0}};
+        if (r->outcome != TM_EXP_MOVES) return 0;
+        int ahead = r->move > 0, behind = !ahead;
+        uint32_t *c = &t->count[ahead];
+        if (r->next == t->state) {
+            if (*c && t->side[ahead][*c - 1].cell == t->cell) {
+                tm_sym_add(&n, &t->side[ahead][--*c].count, 1);
+            } else if (!*c && t->cell == 0) {
+                return 0;
+            }
+        }
+        if (!tm_sym_push(t, behind, r->write, &n)) return 0;
+        int64_t cell = tm_sym_pop(t, ahead);
+        if (cell < 0) return 0;
+        t->cell = cell;
+        tm_sym_add(&t->steps, &n, r->steps);
+        t->state = r->next;
+    }
+    return 1;
+}
+
+static inline uint64_t tm_exp_shape_hash(const TmExpTape *e) {
+    uint64_t h = tm_mix64((uint64_t)e->state << 32 ^ e->cell ^ (uint64_t)e->side[0].count << 48 ^ (uint64_t)e->side[1].count << 56);
+    for (int s = 0; s < 2; s++) {
+        for (uint32_t i = 0; i < e->side[s].count; i++) h = tm_mix64(h ^ e->side[s].runs[i].cell);
+    }
+    return h;
+}
+
+// Run i in shape order (left bottom to top, then right bottom to top)
+static inline TmRun *tm_exp_run_at(TmExpTape *e, int i) {
+    return i < (int)e->side[0].count ? &e->side[0].runs[i] : &e->side[1].runs[i - e->side[0].count];
+}
+
+// Try to prove a rule from the shape seen before and apply it; returns 1 if applied
+static inline int tm_exp_apply_rule(TmExpTape *e, const TmExpShape *then) {
+    int runs = then->num_runs[0] + then->num_runs[1];
+    int64_t base[TM_EXP_MAX_RUNS], delta[TM_EXP_MAX_RUNS];
+    TmSymTape *t = calloc(1, sizeof(TmSymTape));
+    t->state = e->state;
+    t->cell = e->cell;
+    int variable[TM_EXP_MAX_RUNS];
+    for (int i = 0; i < runs; i++) {
+        // A count that changed is y_i + base[i], base[i] as much as both occurrences had; one that
+        // did not stays known (if small)
+        const TmRun *now = tm_exp_run_at(e, i);
+        int cmp = tm_big_cmp(&now->count, &then->runs[i].count);
+        const TmBig *smaller = cmp < 0 ? &now->count : &then->runs[i].count;
+        base[i] = tm_big_fits(smaller, TM_EXP_BASE_BITS) ? (int64_t)smaller->limb[0] : (int64_t)1 << TM_EXP_BASE_BITS;
+        variable[i] = cmp != 0 || !tm_big_fits(smaller, TM_EXP_BASE_BITS);
+        int side = i >= then->num_runs[0];
+        TmSymRun *r = &t->side[side][t->count[side]++];
+        r->cell = now->cell;
+        r->count.k = base[i];
+        r->count.coef[i] = variable[i];
+    }
+    int ok = tm_sym_run(e, t, e->macro_steps - then->macro_step) && t->state == e->state &&
+             t->cell == e->cell && t->count[0] == then->num_runs[0] && t->count[1] == then->num_runs[1];
+    for (int i = 0; ok && i < runs; i++) { // Same shape, every count y_i + base[i] + delta[i]
+        int side = i >= then->num_runs[0];
+        const TmSymRun *r = &t->side[side][side ? i - then->num_runs[0] : i];
+        ok = r->cell == tm_exp_run_at(e, i)->cell;
+        for (int j = 0; ok && j < runs; j++) ok = r->count.coef[j] == (i == j && variable[i]);
+        delta[i] = r->count.k - base[i];
+        ok = ok && (variable[i] || delta[i] == 0);
+    }
+    // Applications possible: while every shrinking count still has y_i >= 0
+    TmBig times = tm_big(0), y[TM_EXP_MAX_RUNS];
+    int bounded = 0;
+    for (int i = 0; ok && i < runs; i++) {
+        y[i] = tm_exp_run_at(e, i)->count;
+        tm_big_sub_small(&y[i], base[i]);
+        if (delta[i] >= 0) continue;
+        TmBig j = y[i];
+        tm_big_div_small(&j, -delta[i]);
+        tm_big_add_small(&j, 1);
+        if (!bounded || tm_big_cmp(&j, &times) < 0) times = j;
+        bounded = 1;
+    }
+    if (ok && !bounded) { // Nothing shrinks: the shape recurs forever
+        e->infinite = 1;
+        e->rules_proven++;
+    } else if (ok) {
+        // Steps: sum over applications a = 0 .. times - 1 of K + sum B_i (y_i + a delta_i)
+        TmBig total, series, prev = times, term, shrink = tm_big(0), k = tm_big(t->steps.k);
+        tm_big_sub_small(&prev, 1);
+        e->overflow |= tm_big_mul(&series, &times, &prev);
+        tm_big_div_small(&series, 2); // times (times - 1) / 2
+        e->overflow |= tm_big_mul(&total, &times, &k);
+        for (int i = 0; i < runs; i++) {
+            uint64_t coef = t->steps.coef[i];
+            if (!coef) continue;
+            e->overflow |= tm_big_mul(&term, &times, &y[i]);
+            e->overflow |= tm_big_mul_small(&term, coef);
+            e->overflow |= tm_big_add(&total, &term);
+            term = series;
+            e->overflow |= tm_big_mul_small(&term, coef * (uint64_t)(delta[i] < 0 ? -delta[i] : delta[i]));
+            e->overflow |= tm_big_add(delta[i] > 0 ? &total : &shrink, &term);
+        }
+        tm_big_sub(&total, &shrink);
+        e->overflow |= tm_big_add(&e->steps, &total);
+        for (int i = 0; i < runs; i++) { // Counts move by times * delta
+            term = times;
+            e->overflow |= tm_big_mul_small(&term, delta[i] < 0 ? -delta[i] : delta[i]);
+            if (delta[i] > 0) e->overflow |= tm_big_add(&tm_exp_run_at(e, i)->count, &term);
+            else if (delta[i] < 0) tm_big_sub(&tm_exp_run_at(e, i)->count, &term);
+        }
+        e->rules_proven++;
+    }
+    free(t);
+    return ok;
+}
+
+// Remember the current shape, or prove and apply a rule if it was seen before
+static inline void tm_exp_check_shape(TmExpTape *e) {
+    int runs = e->side[0].count + e->side[1].count;
+    if (runs > TM_EXP_MAX_RUNS) return;
+    uint64_t hash = tm_exp_shape_hash(e);
+    TmExpShape *s = &e->history[hash % TM_EXP_HISTORY];
+    int same = s->used && s->hash == hash && s->state == e->state && s->cell == e->cell &&
+               s->num_runs[0] == e->side[0].count && s->num_runs[1] == e->side[1].count;
+    for (int i = 0; same && i < runs; i++) same = s->runs[i].cell == tm_exp_run_at(e, i)->cell;
+    if (same && e->macro_steps - s->macro_step <= TM_EXP_MAX_PROOF) tm_exp_apply_rule(e, s);
+    if (e->infinite) return;
+    s->hash = hash;
+    s->macro_step = e->macro_steps;
+    s->state = e->state;
+    s->cell = e->cell;
+    s->used = 1;
+    s->num_runs[0] = e->side[0].count;
+    s->num_runs[1] = e->side[1].count;
+    for (int i = 0; i < runs; i++) s->runs[i] = *tm_exp_run_at(e, i);
+}
+
+// Run until the machine halts, is proven never to halt, overflows TmBig or
+// has taken max_macro_steps macro steps. Returns 1 once it has halted.
+static inline int tm_exp_run(TmExpTape *e, uint64_t max_macro_steps) {
+    while (!e->halted && !e->infinite && !e->overflow && e->macro_steps < max_macro_steps) {
+        tm_exp_step(e);
+        if (!e->halted && !e->infinite) tm_exp_check_shape(e);
+    }
+    return e->halted;
+}
+
+// Nonblank cells (sigma for 0/1 machines)
+static inline TmBig tm_exp_marks(const TmExpTape *e) {
+    TmBig marks = tm_big(tm_exp_cell_marks(e, e->cell)), term;
+    for (int s = 0; s < 2; s++) {
+        for (uint32_t i = 0; i < e->side[s].count; i++) {
+            term = e->side[s].runs[i].count;
+            tm_big_mul_small(&term, tm_exp_cell_marks(e, e->side[s].runs[i].cell));
+            tm_big_add(&marks, &term);
+        }
+    }
+    return marks;
+}
+
+static inline void tm_exp_print_cell(const TmExpTape *e, FILE *f, uint32_t cell) {
+    for (int i = 0; i < e->block; i++, cell /= e->num_symbols) fprintf(f, "%u", cell % e->num_symbols);
+}
+
+// The tape as "100^12 [0>110] 111^3": runs outward from the head, at most
+// max_runs a side; the head's macro cell shows its state and edge (> left, < right)
+static inline void tm_exp_print(const TmExpTape *e, FILE *f, uint32_t max_runs) {
+    char buf[TM_BIG_DIGITS];
+    const TmRunStack *l = &e->side[0], *r = &e->side[1];
+    if (l->count > max_runs) fprintf(f, "... ");
+    for (uint32_t i = l->count > max_runs ? l->count - max_runs : 0; i < l->count; i++) {
+        tm_exp_print_cell(e, f, l->runs[i].cell);
+        if (!tm_big_is(&l->runs[i].count, 1)) fprintf(f, "^%s", tm_big_format(buf, l->runs[i].count));
+        fprintf(f, " ");
+    }
+    fprintf(f, "[%d%c", e->state >> 1, (e->state & 1) ? '<' : '>');
+    tm_exp_print_cell(e, f, e->cell);
+    fprintf(f, "]");
+    for (uint32_t n = 0; n < r->count && n < max_runs; n++) {
+        const TmRun *run = &r->runs[r->count - 1 - n];
+        fprintf(f, " ");
+        tm_exp_print_cell(e, f, run->cell);
+        if (!tm_big_is(&run->count, 1)) fprintf(f, "^%s", tm_big_format(buf, run->count));
+    }
+    if (r->count > max_runs) fprintf(f, " ...");
+    fprintf(f, "\n");
+}
+
+#endif
@@ -0,0 +1,310 @@
+// Hashlife-style engine for TmMachine rule tables: memoized runs over hash-consed tape trees
+
+// The tape is a perfect binary tree: a level-k node covers 2^k cells and is
+// a pair of level-(k-1) nodes, a level-0 node is one cell (its id is its
+// symbol). Nodes are hash-consed, so equal segments anywhere on the tape or
+// in time are one node, and a blank segment of any size costs one node per
+// level.
+//
+// The unit of work is "run node N from state q until the head leaves N, the
+// machine halts, or it provably loops inside N". A level-k run is a sequence
+// of runs of the two children, and a run that starts at an edge of its node
+// (the only way a head enters a child after the first) depends only on
+// (node, state, side). Those results are memoized, with the steps they took,
+// so a segment the machine has swept before is crossed in one lookup however
+// long the sweep was, and the saving compounds level by level. A level-k run
+// that repeats (both children, state, side) is a loop (Brent's cycle test,
+// constant space).
+//
+// The memo table holds at most memo_limit entries and is flushed when full
+// (entries are only a cache); lookups, hits and flushes are counted. Step
+// counts are 128-bit.
+
+#ifndef TM_HASHLIFE_H
+#define TM_HASHLIFE_H
+
+#include "tm_core.h"
+
+#define TM_HL_MAX_LEVEL 62       // Largest tree: 2^62 cells
+#define TM_HL_MEMO_LEVEL 2       // Runs of nodes this level or above are memoized
+#define TM_HL_MEMO_DEFAULT (1u << 20) // Memo entries unless set
+
+#define TM_HL_EXIT 0             // Head left the node (offset -1 or the node's size)
+#define TM_HL_HALT 1
+#define TM_HL_LOOP 2             // Never leaves the node and never halts
+
+typedef unsigned __int128 TmSteps;
+
+typedef struct {
+    uint32_t left, right;        // Children (unused for cells)
+    uint64_t marks;              // Nonblank cells below
+} TmHlNode;
+
+typedef struct {
+    uint32_t node;               // The node afterwards
+    uint16_t state;
+    uint8_t outcome;             // TM_HL_*
+    int64_t offset;              // Head afterwards, relative to the node's first cell
+    TmSteps steps;
+} TmHlResult;
+
+typedef struct {
+    uint32_t node;               // Key: node, state and side entered from
+    uint16_t state;
+    uint8_t side;                // 0 = first cell, 1 = last cell
+    uint8_t used;
+    TmHlResult result;
+} TmHlMemo;
+
+typedef struct {
+    uint16_t num_states, num_symbols;
+    const TmRule *rules;         // rules[state * num_symbols + symbol], num_states halts
+    uint32_t root;               // The tape: 2^level cells from origin
+    int level;
+    int64_t origin, position;
+    uint16_t state;
+    uint8_t halted, looping;
+    TmSteps steps;
+    TmHlNode *nodes;             // nodes[0 .. num_symbols) are the cells
+    uint32_t num_nodes, node_capacity;
+    uint32_t *node_slots;        // Hash table of pair ids (0 = empty; cell ids never go here)
+    uint32_t node_mask;
+    uint32_t blank[TM_HL_MAX_LEVEL + 1];
+    TmHlMemo *memo;
+    uint64_t memo_mask, memo_used, memo_limit;
+    uint64_t lookups, hits, flushes;
+} TmHashlife;
+
+static inline uint32_t tm_hl_node_slot(const TmHashlife *h, uint32_t left, uint32_t right) {
+    return tm_mix64((uint64_t)left << 32 | right) & h->node_mask;
+}
+
+// The node with these children (interned)
+static inline uint32_t tm_hl_pair(TmHashlife *h, uint32_t left, uint32_t right) {
+    uint32_t slot = tm_hl_node_slot(h, left, right), id;
+    while ((id = h->node_slots[slot])) {
+        if (h->nodes[id].left == left && h->nodes[id].right == right) return id;
+        slot = (slot + 1) & h->node_mask;
+    }
+    if (h->num_nodes == h->node_capacity) {
+        h->node_capacity *= 2;
+        h->nodes = realloc(h->nodes, h->node_capacity * sizeof(TmHlNode));
+    }
+    id = h->num_nodes++;
+    h->nodes[id] = (TmHlNode){left, right, h->nodes[left].marks + h->nodes[right].marks};
+    h->node_slots[slot] = id;
+    if (h->num_nodes * 2 > h->node_mask) { // Keep the table at most half full
+        free(h->node_slots);
+        h->node_mask = h->node_mask * 2 + 1;
+        h->node_slots = calloc((size_t)h->node_mask + 1, sizeof(uint32_t));
+        for (uint32_t i = h->num_symbols; i < h->num_nodes; i++) {
+            slot = tm_hl_node_slot(h, h->nodes[i].left, h->nodes[i].right);
+            while (h->node_slots[slot]) slot = (slot + 1) & h->node_mask;
+            h->node_slots[slot] = i;
+        }
+    }
+    return id;
+}
+
+// Build a subtree of 2^level cells starting at pos from a TmMachine's tape
+static inline uint32_t tm_hl_build(TmHashlife *h, const TmMachine *m, int level, int64_t pos) {
+    if (level == 0) return tm_read(m, pos);
+    if (pos >= m->origin + (int64_t)m->length || pos + ((int64_t)1 << level) <= m->origin) return h->blank[level];
+    return tm_hl_pair(h, tm_hl_build(h, m, level - 1, pos),
+                      tm_hl_build(h, m, level - 1, pos + ((int64_t)1 << (level - 1))));
+}
+
+// Set up the engine on a machine's rules, tape, head and state (the machine
+// must outlive it: the rule table is shared); memo_limit 0 takes the default
+static inline void tm_hl_init(TmHashlife *h, const TmMachine *m, uint64_t memo_limit) {
+    memset(h, 0, sizeof(*h));
+    h->num_states = m->num_states;
+    h->num_symbols = m->num_symbols;
+    h->rules = m->rules;
+    h->node_capacity = 1024;
+    while (h->node_capacity < 2u * m->num_symbols) h->node_capacity *= 2;
+    h->nodes = malloc(h->node_capacity * sizeof(TmHlNode));
+    for (uint32_t s = 0; s < m->num_symbols; s++) h->nodes[s] = (TmHlNode){0, 0, s != 0};
+    h->num_nodes = m->num_symbols;
+    h->node_mask = h->node_capacity * 2 - 1;
+    h->node_slots = calloc((size_t)h->node_mask + 1, sizeof(uint32_t));
+    for (int k = 1; k <= TM_HL_MAX_LEVEL; k++) h->blank[k] = tm_hl_pair(h, h->blank[k - 1], h->blank[k - 1]);
+    h->memo_limit = memo_limit ? memo_limit : TM_HL_MEMO_DEFAULT;
+    h->memo_mask = 1023;
+    while (h->memo_mask + 1 < 2 * h->memo_limit) h->memo_mask = h->memo_mask * 2 + 1;
+    h->memo = calloc(h->memo_mask + 1, sizeof(TmHlMemo));
+    h->level = 1;
+    while (((int64_t)1 << h->level) < (int64_t)m->length) h->level++;
+    h->origin = m->origin;
+    h->root = tm_hl_build(h, m, h->level, h->origin);
+    h->position = m->position;
+    h->state = m->state;
+    h->halted = m->halted;
+}
+
+static inline void tm_hl_free(TmHashlife *h) {
+    free(h->nodes);
+    free(h->node_slots);
+    free(h->memo);
+}
+
+static inline TmHlMemo *tm_hl_memo_slot(TmHashlife *h, uint32_t node, int state, int side) {
+    uint64_t slot = tm_mix64((uint64_t)node << 32 | (uint32_t)state << 1 | side) & h->memo_mask;
+    while (h->memo[slot].used &&
+           (h->memo[slot].node != node || h->memo[slot].state != state || h->memo[slot].side != side)) {
+        slot = (slot + 1) & h->memo_mask;
+    }
+    return &h->memo[slot];
+}
+
+static inline void tm_hl_memo_store(TmHashlife *h, uint32_t node, int state, int side, const TmHlResult *r) {
+    if (h->memo_used == h->memo_limit) { // Full: start over
+        memset(h->memo, 0, (h->memo_mask + 1) * sizeof(TmHlMemo));
+        h->memo_used = 0;
+        h->flushes++;
+    }
+    TmHlMemo *e = tm_hl_memo_slot(h, node, state, side);
+    if (!e->used) h->memo_used++;
+    *e = (TmHlMemo){node, state, side, 1, *r};
+}
+
+// Run one cell: steps that stay apply in place until the head moves, the
+// machine halts, or a (state, symbol) pair repeats
+static inline TmHlResult tm_hl_run_cell(const TmHashlife *h, uint32_t symbol, int state) {
+    TmHlResult r = {symbol, state, TM_HL_LOOP, 0, 0};
+    for (int n = 0; n <= h->num_states * h->num_symbols; n++) {
+        const TmRule *rule = &h->rules[r.state * h->num_symbols + r.node];
+        r.node = rule->write;
+        r.state = rule->next;
+        r.steps++;
+        if (rule->next == h->num_states) {
+            r.outcome = TM_HL_HALT;
+            r.offset = rule->move;
+            return r;
+        }
+        if (rule->move) {
+            r.outcome = TM_HL_EXIT;
+            r.offset = rule->move;
+            return r;
+        }
+    }
+    return r;
+}
+
+// Run a level-k node with the head at offset; memoized when it starts at an edge
+static inline TmHlResult tm_hl_run(TmHashlife *h, uint32_t node, int level, int64_t offset, int state) {
+    if (level == 0) return tm_hl_run_cell(h, node, state);
+    int64_t half = (int64_t)1 << (level - 1);
+    int side = offset == 0 ? 0 : offset == 2 * half - 1 ? 1 : -1, start_state = state;
+    if (side >= 0 && level >= TM_HL_MEMO_LEVEL) {
+        h->lookups++;
+        TmHlMemo *e = tm_hl_memo_slot(h, node, state, side);
+        if (e->used) {
+            h->hits++;
+            return e->result;
+        }
+    }
+    uint32_t child[2] = {h->nodes[node].left, h->nodes[node].right};
+    int cur = offset >= half;
+    int64_t sub = offset - cur * half;
+    TmHlResult r, out = {0, 0, TM_HL_EXIT, 0, 0};
+    // Brent's cycle test on the configuration between child runs
+    uint32_t saved[2] = {child[0], child[1]};
+    int saved_state = -1, saved_cur = -1;
+    uint64_t power = 1, lam = 0;
+    for (;;) {
+        r = tm_hl_run(h, child[cur], level - 1, sub, state);
+        child[cur] = r.node;
+        state = r.state;
+        out.steps += r.steps;
+        if (r.outcome != TM_HL_EXIT) {
+            out.outcome = r.outcome;
+            out.offset = cur * half + r.offset;
+            break;
+        }
+        if (r.offset < 0 && cur == 0) { // Out of the left edge
+            out.offset = -1;
+            break;
+        }
+        if (r.offset >= half && cur == 1) { // Out of the right edge
+            out.offset = 2 * half;
+            break;
+        }
+        cur = r.offset < 0 ? 0 : 1; // Into the sibling, at its near edge
+        sub = cur ? 0 : half - 1;
+        if (child[0] == saved[0] && child[1] == saved[1] && state == saved_state && cur == saved_cur) {
+            out.outcome = TM_HL_LOOP;
+            out.offset = cur * half + sub;
+            break;
+        }
+        if (++lam == power) {
+            saved[0] = child[0];
+            saved[1] = child[1];
+            saved_state = state;
+            saved_cur = cur;
+            power *= 2;
+            lam = 0;
+        }
+    }
+    out.node = tm_hl_pair(h, child[0], child[1]);
+    out.state = state;
+    if (side >= 0 && level >= TM_HL_MEMO_LEVEL) tm_hl_memo_store(h, node, start_state, side, &out);
+    return out;
+}
+
+// Run until the machine halts or loops, the tape would pass 2^TM_HL_MAX_LEVEL
+// cells, or at least max_steps steps have been taken (0 = no limit; a single
+// memoized run may go far past it). Returns 1 once the machine has halted.
+static inline int tm_hl_run_until(TmHashlife *h, TmSteps max_steps) {
+    while (!h->halted && !h->looping && (!max_steps || h->steps < max_steps)) {
+        TmHlResult r = tm_hl_run(h, h->root, h->level, h->position - h->origin, h->state);
+        h->root = r.node;
+        h->state = r.state;
+        h->steps += r.steps;
+        h->position = h->origin + r.offset;
+        h->halted = r.outcome == TM_HL_HALT;
+        h->looping = r.outcome == TM_HL_LOOP;
+        if (r.outcome != TM_HL_EXIT) break;
+        if (h->level == TM_HL_MAX_LEVEL) break;
+        if (r.offset < 0) { // Double the tape toward the side the head left by
+            h->root = tm_hl_pair(h, h->blank[h->level], h->root);
+            h->origin -= (int64_t)1 << h->level;
+        } else {
+            h->root = tm_hl_pair(h, h->root, h->blank[h->level]);
+        }
+        h->level++;
+    }
+    return h->halted;
+}
+
+// Symbol at pos (blank outside the tree)
+static inline int tm_hl_read(const TmHashlife *h, int64_t pos) {
+    if (pos < h->origin || pos - h->origin >= ((int64_t)1 << h->level)) return 0;
+    uint32_t node = h->root;
+    int64_t offset = pos - h->origin;
+    for (int k = h->level; k > 0; k--) {
+        int right = offset >> (k - 1) & 1;
+        node = right ? h->nodes[node].right : h->nodes[node].left;
+    }
+    return node;
+}
+
+// Nonblank cells on the tape (sigma for 0/1 machines)
+static inline uint64_t tm_hl_marks(const TmHashlife *h) {
+    return h->nodes[h->root].marks;
+}
+
+// Decimal step count into buf (40 bytes is enough)
+static inline char *tm_hl_format_steps(char *buf, TmSteps steps) {
+    char digits[40];
+    int n = 0;
+    do {
+        digits[n++] = '0' + (int)(steps % 10);
+        steps /= 10;
+    } while (steps);
+    for (int i = 0; i < n; i++) buf[i] = digits[n - 1 - i];
+    buf[n] = '\0';
+    return buf;
+}
+
+#endif
@@ -0,0 +1,229 @@
+// k-tape machines for tm_core.h: independent heads, one rule per symbol tuple
+
+// Each tape packs its cells TM_MULTI_BITS(symbols) bits apiece into 64-bit
+// words and grows in both directions like a TmMachine tape. The rule table
+// is flat: the symbols under the k heads are concatenated below the state,
+// tape 0 highest, so finding a rule costs one shift-or per tape.
+// TM_DEFINE_MULTI_KERNEL specialises the run loop on the tape count and cell
+// width, which unrolls the per-tape work.
+//
+// tm_multi_init_ittm() sets up the three-tape ITTM layout over {0,1}: input,
+// scratch and output tapes starting at cell 0 under one head position, with
+// a read-only input tape. Its rules go in with tm_multi_set_ittm_rule().
+// (Limit stages stay with the dovetail programs' --limit machinery.)
+
+#ifndef TM_MULTI_H
+#define TM_MULTI_H
+
+#include "tm_core.h"
+
+#define TM_MAX_TAPES 4
+#define TM_MULTI_INDEX_BITS 16 // Most bits of symbol tuple per state (the table is states << this)
+#define TM_MULTI_BITS(symbols) ((symbols) <= 2 ? 1 : (symbols) <= 4 ? 2 : (symbols) <= 16 ? 4 : 8)
+
+#define TM_ITTM_INPUT 0
+#define TM_ITTM_SCRATCH 1
+#define TM_ITTM_OUTPUT 2
+
+typedef struct {
+    uint8_t write[TM_MAX_TAPES];
+    int8_t move[TM_MAX_TAPES];   // -1 (left), 0 (stay), 1 (right) per head
+    uint16_t next;               // num_states is the halt state
+} TmMultiRule;
+
+typedef struct {
+    uint64_t *words;
+    int64_t origin;              // Position of the first cell of words[0]
+    uint32_t num_words;
+    int64_t position;            // Head position
+} TmTape;
+
+typedef struct {
+    uint16_t num_tapes, num_states, num_symbols;
+    uint8_t bits;                // Bits per packed cell: 1, 2, 4 or 8
+    uint16_t state;
+    uint8_t halted;
+    uint8_t left_bounded;        // Heads stop at their tape's first cell instead of growing it
+    uint64_t steps;
+    TmTape tapes[TM_MAX_TAPES];
+    TmMultiRule *rules;          // rules[state << (num_tapes * bits) | tuple]
+    Arena *arena;                // Holds the tapes and rules
+} TmMultiMachine;
+
+// Set up a machine with blank tapes, every head at position and a zeroed rule
+// table (every entry writes 0s, stays and goes to state 0 until set).
+// Returns 0 if the symbol tuple would not fit TM_MULTI_INDEX_BITS.
+static inline int tm_multi_init(TmMultiMachine *m, Arena *arena, int num_tapes, int num_states,
+                                int num_symbols, int64_t position, int state) {
+    memset(m, 0, sizeof(*m));
+    int bits = TM_MULTI_BITS(num_symbols);
+    if (num_tapes < 1 || num_tapes > TM_MAX_TAPES || num_symbols > 256 ||
+        num_tapes * bits > TM_MULTI_INDEX_BITS) return 0;
+    m->arena = arena;
+    m->num_tapes = num_tapes;
+    m->num_states = num_states;
+    m->num_symbols = num_symbols;
+    m->bits = bits;
+    m->state = state;
+    m->halted = state == num_states;
+    for (int t = 0; t < num_tapes; t++) {
+        TmTape *tape = &m->tapes[t];
+        tape->num_words = TM_TAPE_MIN / 8;
+        tape->words = arena_alloc(arena, tape->num_words * sizeof(uint64_t));
+        tape->origin = tape->position = position;
+    }
+    m->rules = arena_alloc(arena, ((size_t)num_states << (num_tapes * bits)) * sizeof(TmMultiRule));
+    return 1;
+}
+
+// Grow a tape so it covers pos, doubling toward the side that ran out
+static inline void tm_tape_grow(TmTape *tape, Arena *arena, int bits, int64_t pos) {
+    int64_t cells = (int64_t)tape->num_words * (64 / bits);
+    if (pos >= tape->origin && pos < tape->origin + cells) return;
+    uint32_t num_words = tape->num_words * 2;
+    while (pos < tape->origin + cells - (int64_t)num_words * (64 / bits) ||
+           pos >= tape->origin + (int64_t)num_words * (64 / bits)) num_words *= 2;
+    uint32_t shift = (pos < tape->origin) ? num_words - tape->num_words : 0; // Words added on the left
+    uint64_t *words = arena_alloc(arena, num_words * sizeof(uint64_t));
+    memcpy(words + shift, tape->words, tape->num_words * sizeof(uint64_t));
+    arena_free(arena, tape->words, tape->num_words * sizeof(uint64_t));
+    tape->words = words;
+    tape->origin -= (int64_t)shift * (64 / bits);
+    tape->num_words = num_words;
+}
+
+// Symbol at pos on a tape (blank outside the allocated words)
+static inline int tm_tape_read(const TmTape *tape, int bits, int64_t pos) {
+    uint64_t i = pos - tape->origin;
+    if (i >= (uint64_t)tape->num_words * (64 / bits)) return 0;
+    return (tape->words[i * bits / 64] >> (i * bits % 64)) & ((1u << bits) - 1);
+}
+
+static inline void tm_tape_write(TmTape *tape, Arena *arena, int bits, int64_t pos, int symbol) {
+    tm_tape_grow(tape, arena, bits, pos);
+    uint64_t i = pos - tape->origin;
+    uint64_t *w = &tape->words[i * bits / 64];
+    int shift = i * bits % 64;
+    *w = (*w & ~((((uint64_t)1 << bits) - 1) << shift)) | ((uint64_t)symbol << shift);
+}
+
+// Rule for a state and the symbols under the heads (syms[t] for tape t)
+static inline TmMultiRule *tm_multi_rule(const TmMultiMachine *m, int state, const int *syms) {
+    uint32_t index = state;
+    for (int t = 0; t < m->num_tapes; t++) index = (index << m->bits) | syms[t];
+    return &m->rules[index];
+}
+
+static inline void tm_multi_set_rule(TmMultiMachine *m, int state, const int *syms, const int *write,
+                                     const int *move, int next) {
+    TmMultiRule *r = tm_multi_rule(m, state, syms);
+    for (int t = 0; t < m->num_tapes; t++) {
+        r->write[t] = write[t];
+        r->move[t] = move[t];
+    }
+    r->next = next;
+}
+
+// One step; returns 1 once the machine has halted
+static inline int tm_multi_step(TmMultiMachine *m) {
+    uint32_t index = m->state;
+    for (int t = 0; t < m->num_tapes; t++) {
+        index = (index << m->bits) | tm_tape_read(&m->tapes[t], m->bits, m->tapes[t].position);
+    }
+    const TmMultiRule *r = &m->rules[index];
+    for (int t = 0; t < m->num_tapes; t++) {
+        TmTape *tape = &m->tapes[t];
+        tm_tape_write(tape, m->arena, m->bits, tape->position, r->write[t]);
+        tape->position += r->move[t];
+        if (m->left_bounded && tape->position < tape->origin) tape->position = tape->origin;
+        tm_tape_grow(tape, m->arena, m->bits, tape->position); // Every head's cell exists
+    }
+    m->state = r->next;
+    m->steps++;
+    m->halted = m->state == m->num_states;
+    return m->halted;
+}
+
+// Run loop specialised on the tape count and cell width (the machine must
+// match them); reads and writes go straight to the packed words. Returns
+// steps taken.
+#define TM_DEFINE_MULTI_KERNEL(name, TAPES, BITS)                                   \
+static inline uint64_t name(TmMultiMachine *m, uint64_t max_steps) {                \
+    uint64_t n = 0, offset[TAPES];                                                  \
+    uint32_t state = m->state;                                                      \
+    const uint64_t mask = ((uint64_t)1 << (BITS)) - 1;                              \
+    for (int t = 0; t < (TAPES); t++) offset[t] = m->tapes[t].position - m->tapes[t].origin; \
+    while (n < max_steps && state != m->num_states) {                               \
+        uint32_t index = state;                                                     \
+        for (int t = 0; t < (TAPES); t++) {                                         \
+            index = (index << (BITS)) | ((m->tapes[t].words[offset[t] * (BITS) / 64] \
+                                          >> (offset[t] * (BITS) % 64)) & mask);    \
+        }                                                                           \
+        const TmMultiRule *r = &m->rules[index];                                    \
+        for (int t = 0; t < (TAPES); t++) {                                         \
+            TmTape *tape = &m->tapes[t];                                            \
+            uint64_t *w = &tape->words[offset[t] * (BITS) / 64];                    \
+            int shift = offset[t] * (BITS) % 64;                                    \
+            *w = (*w & ~(mask << shift)) | ((uint64_t)r->write[t] << shift);        \
+            offset[t] += r->move[t];                                                \
+            if (offset[t] >= (uint64_t)tape->num_words * (64 / (BITS))) { /* Off either end */ \
+                int64_t pos = tape->origin + (int64_t)offset[t];                    \
+                if (m->left_bounded && pos < tape->origin) pos = tape->origin;      \
+                tm_tape_grow(tape, m->arena, (BITS), pos);                          \
+                offset[t] = pos - tape->origin;                                     \
+            }                                                                       \
+        }                                                                           \
+        state = r->next;                                                            \
+        n++;                                                                        \
+    }                                                                               \
+    for (int t = 0; t < (TAPES); t++) m->tapes[t].position = m->tapes[t].origin + (int64_t)offset[t]; \
+    m->state = state;                                                               \
+    m->steps += n;                                                                  \
+    m->halted = state == m->num_states;                                             \
+    return n;                                                                       \
+}
+
+TM_DEFINE_MULTI_KERNEL(tm_multi_run_1x1, 1, 1)
+TM_DEFINE_MULTI_KERNEL(tm_multi_run_2x1, 2, 1)
+TM_DEFINE_MULTI_KERNEL(tm_multi_run_ittm, 3, 1) // Input, scratch, output over {0,1}
+TM_DEFINE_MULTI_KERNEL(tm_multi_run_2x2, 2, 2)
+TM_DEFINE_MULTI_KERNEL(tm_multi_run_3x2, 3, 2)
+
+// Any machine: the specialised kernel if there is one, single steps otherwise
+static inline uint64_t tm_multi_run(TmMultiMachine *m, uint64_t max_steps) {
+    switch (m->num_tapes * 16 + m->bits) {
+    case 1 * 16 + 1: return tm_multi_run_1x1(m, max_steps);
+    case 2 * 16 + 1: return tm_multi_run_2x1(m, max_steps);
+    case 3 * 16 + 1: return tm_multi_run_ittm(m, max_steps);
+    case 2 * 16 + 2: return tm_multi_run_2x2(m, max_steps);
+    case 3 * 16 + 2: return tm_multi_run_3x2(m, max_steps);
+    }
+    uint64_t n = 0;
+    while (n < max_steps && !m->halted) {
+        tm_multi_step(m);
+        n++;
+    }
+    return n;
+}
+
+// The three-tape ITTM layout: input, scratch and output tapes over {0,1},
+// infinite to the right only, with the head starting at cell 0 and staying
+// there on a move left
+static inline int tm_multi_init_ittm(TmMultiMachine *m, Arena *arena, int num_states) {
+    if (!tm_multi_init(m, arena, 3, num_states, 2, 0, 0)) return 0;
+    m->left_bounded = 1;
+    return 1;
+}
+
+// An ITTM rule: the three cells under the head decide; input is left as it
+// is, scratch and output are written, and the one head moves for all tapes
+static inline void tm_multi_set_ittm_rule(TmMultiMachine *m, int state, int input, int scratch,
+                                          int output, int write_scratch, int write_output,
+                                          int move, int next) {
+    int syms[3] = {input, scratch, output};
+    int write[3] = {input, write_scratch, write_output};
+    int moves[3] = {move, move, move};
+    tm_multi_set_rule(m, state, syms, write, moves, next);
+}
+
+#endif
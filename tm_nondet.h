@@ -0,0 +1,265 @@
+// Breadth-first explorer for nondeterministic machines (several rules per state/symbol)
+
+// A configuration is (state, symbol under the head, tape left of the head,
+// tape right of the head). Each half-tape is a list of cells leading away
+// from the head, and every list cell is hash-consed: a (symbol, rest) pair
+// is stored once and named by its index, so configurations that share tape
+// share it structurally, equal tapes have equal indices, and a configuration
+// is a fixed 12-byte key. Blank cells at the far end are never stored (index
+// 0 is the blank half-tape), which makes the encoding canonical. Positions
+// are relative to the head, so configurations that differ only by a shift
+// are one configuration.
+//
+// Each level expands the frontier through every rule of (state, symbol) and
+// keeps only successors not seen before. A rule into state num_states halts,
+// and halting is acceptance. A (state, symbol) pair with no rule is a branch
+// that dies.
+
+#ifndef TM_NONDET_H
+#define TM_NONDET_H
+
+#include "tm_core.h"
+
+#define TM_ND_MIN_SLOTS 1024 // Initial hash table sizes (powers of two)
+
+typedef struct {
+    uint32_t left, right;      // Half-tapes (hash-consed list cells; 0 is blank)
+    uint16_t state;
+    uint8_t symbol;            // Under the head
+    uint8_t used;              // Slot in use (hash set entries)
+} TmConfig;
+
+typedef struct {
+    uint16_t num_states, num_symbols;
+    uint32_t *first;           // Rules of entry i = state * num_symbols + symbol: rules[first[i] .. first[i + 1])
+    TmRule *rules;
+    uint32_t num_rules;
+    TmConfig start;
+    // List cells: cell i is node_symbol[i] followed by cell node_rest[i]
+    uint8_t *node_symbol;
+    uint32_t *node_rest;
+    uint32_t num_nodes, node_capacity;
+    uint32_t *node_slots;      // Hash table of cell indices (0 = empty)
+    uint32_t node_mask;
+    TmConfig *seen;            // Hash set of every configuration reached
+    uint64_t seen_mask, num_seen;
+} TmNondet;
+
+static inline void tm_nd_init(TmNondet *nd) {
+    memset(nd, 0, sizeof(*nd));
+    nd->node_capacity = TM_ND_MIN_SLOTS;
+    nd->node_symbol = malloc(nd->node_capacity);
+    nd->node_rest = malloc(nd->node_capacity * sizeof(uint32_t));
+    nd->node_symbol[0] = 0; // Cell 0: the blank half-tape
+    nd->node_rest[0] = 0;
+    nd->num_nodes = 1;
+    nd->node_mask = TM_ND_MIN_SLOTS - 1;
+    nd->node_slots = calloc(TM_ND_MIN_SLOTS, sizeof(uint32_t));
+    nd->seen_mask = TM_ND_MIN_SLOTS - 1;
+    nd->seen = calloc(TM_ND_MIN_SLOTS, sizeof(TmConfig));
+}
+
+static inline void tm_nd_free(TmNondet *nd) {
+    free(nd->first);
+    free(nd->rules);
+    free(nd->node_symbol);
+    free(nd->node_rest);
+    free(nd->node_slots);
+    free(nd->seen);
+}
+
+static inline uint32_t tm_nd_node_slot(const TmNondet *nd, int symbol, uint32_t rest) {
+    return tm_mix64((uint64_t)rest << 8 | symbol) & nd->node_mask;
+}
+
+// The half-tape with symbol in front of rest (interned; blank on blank is blank)
+static inline uint32_t tm_nd_push(TmNondet *nd, int symbol, uint32_t rest) {
+    if (symbol == 0 && rest == 0) return 0;
+    uint32_t slot = tm_nd_node_slot(nd, symbol, rest), id;
+    while ((id = nd->node_slots[slot])) {
+        if (nd->node_symbol[id] == symbol && nd->node_rest[id] == rest) return id;
+        slot = (slot + 1) & nd->node_mask;
+    }
+    if (nd->num_nodes == nd->node_capacity) {
+        nd->node_capacity *= 2;
+        nd->node_symbol = realloc(nd->node_symbol, nd->node_capacity);
+        nd->node_rest = realloc(nd->node_rest, nd->node_capacity * sizeof(uint32_t));
+    }
+    id = nd->num_nodes++;
+    nd->node_symbol[id] = symbol;
+    nd->node_rest[id] = rest;
+    nd->node_slots[slot] = id;
+    if (nd->num_nodes * 2 > nd->node_mask) { // Keep the table at most half full
+        free(nd->node_slots);
+        nd->node_mask = nd->node_mask * 2 + 1;
+        nd->node_slots = calloc(nd->node_mask + 1, sizeof(uint32_t));
+        for (uint32_t i = 1; i < nd->num_nodes; i++) {
+            slot = tm_nd_node_slot(nd, nd->node_symbol[i], nd->node_rest[i]);
+            while (nd->node_slots[slot]) slot = (slot + 1) & nd->node_mask;
+            nd->node_slots[slot] = i;
+        }
+    }
+    return id;
+}
+
+static inline uint64_t tm_nd_config_hash(const TmConfig *c) {
+    return tm_mix64(((uint64_t)c->left << 32 | c->right) ^ tm_mix64((uint64_t)c->state << 8 | c->symbol));
+}
+
+// Add a configuration to the seen set; returns 0 if it was already there
+static inline int tm_nd_insert(TmNondet *nd, TmConfig c) {
+    c.used = 1;
+    uint64_t slot = tm_nd_config_hash(&c) & nd->seen_mask;
+    while (nd->seen[slot].used) {
+        const TmConfig *s = &nd->seen[slot];
+        if (s->left == c.left && s->right == c.right && s->state == c.state && s->symbol == c.symbol) return 0;
+        slot = (slot + 1) & nd->seen_mask;
+    }
+    nd->seen[slot] = c;
+    if (++nd->num_seen * 2 > nd->seen_mask) { // Keep the set at most half full
+        TmConfig *old = nd->seen;
+        uint64_t old_slots = nd->seen_mask + 1;
+        nd->seen_mask = nd->seen_mask * 2 + 1;
+        nd->seen = calloc(nd->seen_mask + 1, sizeof(TmConfig));
+        for (uint64_t i = 0; i < old_slots; i++) {
+            if (!old[i].used) continue;
+            slot = tm_nd_config_hash(&old[i]) & nd->seen_mask;
+            while (nd->seen[slot].used) slot = (slot + 1) & nd->seen_mask;
+            nd->seen[slot] = old[i];
+        }
+        free(old);
+    }
+    return 1;
+}
+
+// Read the next machine in the tm_read_text() format, where several "rule"
+// lines for one (state, symbol) are its choices. Returns 1 on a machine, 0 at
+// end of file, -1 on a malformed one.
+static inline int tm_nd_read_text(FILE *f, TmNondet *nd) {
+    char word[16];
+    unsigned states, symbols;
+    if (fscanf(f, " %15s", word) != 1) return 0;
+    if (strcmp(word, "machine") != 0 || fscanf(f, "%u %u", &states, &symbols) != 2 ||
+        states < 1 || states > 65535 || symbols < 1 || symbols > 256) return -1;
+    nd->num_states = states;
+    nd->num_symbols = symbols;
+    uint32_t entries = states * symbols, capacity = entries;
+    uint32_t *entry = malloc(capacity * sizeof(uint32_t)); // Entry of each rule, in file order
+    nd->rules = malloc(capacity * sizeof(TmRule));
+    long long start = 0;
+    int64_t lo = 0, hi = -1; // Tape cells given, relative positions lo..hi
+    uint8_t *cells = NULL;
+    int ok = 1;
+    while (ok && fscanf(f, " %15s", word) == 1 && strcmp(word, "end") != 0) {
+        if (strcmp(word, "start") == 0) {
+            unsigned state;
+            ok = fscanf(f, "%lld %u", &start, &state) == 2 && state <= states && !cells;
+            nd->start.state = state;
+        } else if (strcmp(word, "tape") == 0) {
+            long long pos;
+            char *line = NULL, *p, *end;
+            size_t cap = 0;
+            if (fscanf(f, "%lld", &pos) != 1 || getline(&line, &cap, f) < 0) {
+                ok = 0;
+                break;
+            }
+            for (p = line;; p = end) {
+                unsigned long sym = strtoul(p, &end, 10);
+                if (end == p) break;
+                if (sym >= symbols) {
+                    ok = 0;
+                    break;
+                }
+                int64_t at = pos++ - start;
+                if (hi < lo) lo = hi = at;
+                int64_t new_lo = at < lo ? at : lo, new_hi = at > hi ? at : hi;
+                uint8_t *grown = calloc(new_hi - new_lo + 1, 1);
+                if (cells) memcpy(grown + (lo - new_lo), cells, hi - lo + 1);
+                free(cells);
+                cells = grown;
+                lo = new_lo;
+                hi = new_hi;
+                cells[at - lo] = sym;
+            }
+            free(line);
+        } else if (strcmp(word, "rule") == 0) {
+            unsigned state, sym, write, next;
+            int move;
+            ok = fscanf(f, "%u %u %u %d %u", &state, &sym, &write, &move, &next) == 5 &&
+                 state < states && sym < symbols && write < symbols && move >= -1 && move <= 1 &&
+                 next <= states;
+            if (!ok) break;
+            if (nd->num_rules == capacity) {
+                capacity *= 2;
+                entry = realloc(entry, capacity * sizeof(uint32_t));
+                nd->rules = realloc(nd->rules, capacity * sizeof(TmRule));
+            }
+            entry[nd->num_rules] = state * symbols + sym;
+            nd->rules[nd->num_rules++] = (TmRule){write, move, next};
+        } else {
+            ok = 0;
+        }
+    }
+    if (ok) {
+        // Group the rules by entry (a stable counting sort keeps the file order of choices)
+        TmRule *sorted = malloc((nd->num_rules + 1) * sizeof(TmRule));
+        nd->first = calloc(entries + 1, sizeof(uint32_t));
+        for (uint32_t i = 0; i < nd->num_rules; i++) nd->first[entry[i] + 1]++;
+        for (uint32_t i = 0; i < entries; i++) nd->first[i + 1] += nd->first[i];
+        uint32_t *fill = malloc((entries + 1) * sizeof(uint32_t));
+        memcpy(fill, nd->first, (entries + 1) * sizeof(uint32_t));
+        for (uint32_t i = 0; i < nd->num_rules; i++) sorted[fill[entry[i]]++] = nd->rules[i];
+        free(fill);
+        free(nd->rules);
+        nd->rules = sorted;
+        // Half-tapes are built from their far ends toward the head
+        nd->start.left = nd->start.right = 0;
+        for (int64_t at = lo; at < 0 && at <= hi; at++) nd->start.left = tm_nd_push(nd, cells[at - lo], nd->start.left);
+        for (int64_t at = hi; at > 0 && at >= lo; at--) nd->start.right = tm_nd_push(nd, cells[at - lo], nd->start.right);
+        nd->start.symbol = (lo <= 0 && 0 <= hi) ? cells[-lo] : 0;
+    }
+    free(cells);
+    free(entry);
+    return ok ? 1 : -1;
+}
+
+// Expand one level: every successor of frontier[0 .. count) not seen before is
+// appended to *next (grown as needed) and counted in the return value.
+// *generated counts every successor and *accepted the halting ones (which are
+// counted, not queued).
+static inline uint64_t tm_nd_expand(TmNondet *nd, const TmConfig *frontier, uint64_t count,
+                                    TmConfig **next, uint64_t *next_capacity,
+                                    uint64_t *generated, uint64_t *accepted) {
+    uint64_t added = 0;
+    for (uint64_t i = 0; i < count; i++) {
+        TmConfig c = frontier[i];
+        uint32_t entry = c.state * nd->num_symbols + c.symbol;
+        for (uint32_t k = nd->first[entry]; k < nd->first[entry + 1]; k++) {
+            const TmRule *r = &nd->rules[k];
+            TmConfig s = {c.left, c.right, r->next, r->write, 0};
+            (*generated)++;
+            if (r->next == nd->num_states) {
+                (*accepted)++;
+                continue;
+            }
+            if (r->move == 1) { // The written cell joins the left half; the right half's first cell comes under the head
+                s.left = tm_nd_push(nd, r->write, c.left);
+                s.symbol = nd->node_symbol[c.right];
+                s.right = nd->node_rest[c.right];
+            } else if (r->move == -1) {
+                s.right = tm_nd_push(nd, r->write, c.right);
+                s.symbol = nd->node_symbol[c.left];
+                s.left = nd->node_rest[c.left];
+            }
+            if (!tm_nd_insert(nd, s)) continue;
+            if (added == *next_capacity) {
+                *next_capacity = *next_capacity ? *next_capacity * 2 : TM_ND_MIN_SLOTS;
+                *next = realloc(*next, *next_capacity * sizeof(TmConfig));
+            }
+            (*next)[added++] = s;
+        }
+    }
+    return added;
+}
+
+#endif
@@ -0,0 +1,86 @@
+// Result file tool: summary, records, and the merge of a sharded run (tm_results.h)
+
+// Result files come from ittm_dovetail --results=FILE, with --enumerate or
+// --load, and one per shard under --shard=I/N.
+//   tm_results info FILE           header, counts, leaders and the start of the halting bitmap
+//   tm_results list FILE           one line per record: key, verdict, steps, marks
+//   tm_results merge OUT FILE...   shards 0 .. N - 1 of one run into the unsharded file
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tm_results.h"
+
+#define BITS_SHOWN 64 // Halting bits printed by info
+
+// A key as text: the path ("3.1.7", "root" for the root) or the machine's index
+char *format_key(char *buf, const TmResHeader *h, const uint8_t *key) {
+    if (h->kind == TM_RES_LOAD) {
+        sprintf(buf, "%llu", (unsigned long long)tm_res_key_index(key));
+        return buf;
+    }
+    char *p = buf;
+    for (int i = 0; i < TM_RES_KEY && key[i]; i++) p += sprintf(p, i ? ".%d" : "%d", key[i] - 1);
+    if (p == buf) strcpy(buf, "root");
+    return buf;
+}
+
+int info(const char *path) {
+    TmResReader r;
+    char key[TM_RES_KEY * 4 + 8];
+    if (!tm_res_open(&r, path)) return 1;
+    const TmResHeader *h = &r.header;
+    const TmResCounts *c = &r.counts;
+    if (h->kind == TM_RES_ENUMERATE) {
+        printf("%s: %u-state %u-symbol enumeration, %llu steps each", path, h->num_states, h->num_symbols,
+               (unsigned long long)h->budget);
+    } else {
+        printf("%s: %llu loaded machines (fingerprint %016llx), %llu stages", path, (unsigned long long)h->population,
+               (unsigned long long)h->fingerprint, (unsigned long long)h->budget);
+    }
+    if (h->shards > 1) printf(", shard %u of %u (split depth %u)", h->shard, h->shards, h->split);
+    printf("\n%llu records: %llu halting, %llu never halt, %llu undecided\n", (unsigned long long)c->records,
+           (unsigned long long)c->halting, (unsigned long long)c->never, (unsigned long long)c->undecided);
+    for (int i = 0; i < 2; i++) {
+        if (!c->leaders[i].value) continue;
+        printf("Most %s: %llu  %s %s\n", i ? "marks" : "steps", (unsigned long long)c->leaders[i].value,
+               format_key(key, h, c->leaders[i].key), c->leaders[i].table);
+    }
+    printf("Halting bitmap:\n");
+    for (uint64_t i = 0; i < c->records && i < BITS_SHOWN; i++) {
+        printf("%d", tm_res_halts(&r, i));
+        if (i % 8 == 7) printf(" ");
+    }
+    printf(c->records > BITS_SHOWN ? "...\n" : "\n");
+    tm_res_close_reader(&r);
+    return 0;
+}
+
+int list(const char *path) {
+    static const char *verdicts[] = {"?", "halts", "never", "undecided"};
+    TmResReader r;
+    TmResRecord rec;
+    char key[TM_RES_KEY * 4 + 8];
+    if (!tm_res_open(&r, path)) return 1;
+    while (tm_res_next(&r, &rec)) {
+        printf("%s %s %llu %llu\n", format_key(key, &r.header, rec.key), rec.verdict <= 3 ? verdicts[rec.verdict] : "?",
+               (unsigned long long)rec.steps, (unsigned long long)rec.marks);
+    }
+    int ok = r.next == r.counts.records;
+    if (!ok) printf("%s: record %llu is damaged.\n", path, (unsigned long long)r.next);
+    tm_res_close_reader(&r);
+    return !ok;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc == 3 && strcmp(argv[1], "info") == 0) return info(argv[2]);
+    if (argc == 3 && strcmp(argv[1], "list") == 0) return list(argv[2]);
+    if (argc >= 4 && strcmp(argv[1], "merge") == 0) {
+        if (!tm_res_merge(argv[2], argv + 3, argc - 3)) return 1;
+        return info(argv[2]);
+    }
+    printf("Usage: %s info FILE\n", argv[0]);
+    printf("       %s list FILE\n", argv[0]);
+    printf("       %s merge OUT FILE...\n", argv[0]);
+    return 2;
+}
@@ -0,0 +1,381 @@
+// Sorted result files for sharded runs, and the merge that puts the shards back together
+
+// A sharded run splits a machine population into shards that separate
+// processes, on one box or many, run on their own. Each writes a result
+// file: one record per machine sorted by key, a halting bitmap over the
+// records, counts, and its leaders (most steps, most marks among halting
+// machines). tm_res_merge() takes a complete set of shard files and writes
+// the file an unsharded run would have written, byte for byte: a k-way
+// merge of the records, the shards' halting bits carried along in merged
+// order, counts summed and the leaders compared (ties go to the smaller
+// key, as an unsharded run keeps the first it meets).
+//
+// Keys (TM_RES_KEY bytes, compared with memcmp):
+//   enumeration (tm_enum.h): the node's path, each child index plus one,
+//     zero padded, so key order is the enumeration's depth-first order
+//   loaded machines: the machine's index in the population, big-endian
+// On disk a key drops its trailing zeros and steps and marks are LEB128
+// (7 bits a byte, low first), so a record is a dozen bytes or so rather
+// than the 81 of a fixed layout: shard files are cheap to move between boxes.
+//
+// File layout, integers little-endian:
+//   "TMRES001", u8 kind, u16 states, u16 symbols, u64 budget,
+//   u64 population, u64 fingerprint, u32 shard, u32 shards, u32 split
+//   records: u8 key length, key bytes, u8 verdict, LEB128 steps, LEB128 marks
+//   halting bitmap: bit i (of byte i / 8, bit i % 8) set when record i halts
+//   trailer: u64 records, halting, never halts, undecided; two leaders
+//   (u64 value, key, rule table text of TM_RES_TABLE bytes); "TMRESEND"
+
+#ifndef TM_RESULTS_H
+#define TM_RESULTS_H
+
+#include "tm_core.h"
+#include "tm_enum.h"
+
+#define TM_RES_KEY TM_ENUM_MAX_ENTRIES   // Key bytes (the longest path)
+#define TM_RES_TABLE (TM_ENUM_MAX_ENTRIES * 4 + 1) // Leader rule table text
+#define TM_RES_RECORD_MIN 4              // Fewest record bytes on disk (the root)
+#define TM_RES_HEADER 49                 // Header bytes on disk
+#define TM_RES_TRAILER (32 + 2 * (8 + TM_RES_KEY + TM_RES_TABLE) + 8)
+
+#define TM_RES_ENUMERATE 1         // Kinds: tree-normal-form enumeration
+#define TM_RES_LOAD 2              // Kinds: a population of loaded machines
+
+#define TM_RES_HALTS 1             // Verdicts
+#define TM_RES_NEVER 2             // Proven never to halt
+#define TM_RES_UNDECIDED 3         // Budget spent
+
+typedef struct {
+    uint8_t kind;
+    uint16_t num_states, num_symbols; // Enumeration size (0 for loaded machines)
+    uint64_t budget;           // Steps per machine (enumeration) or stages (loaded machines)
+    uint64_t population;       // Loaded machines in the whole population (0 for enumeration)
+    uint64_t fingerprint;      // Hash of the whole population, so shards of different inputs do not merge
+    uint32_t shard, shards;    // 0 of 1: the whole population
+    uint32_t split;            // Enumeration: depth whose nodes were dealt out (0 unsharded)
+} TmResHeader;
+
+typedef struct {
+    uint8_t key[TM_RES_KEY];
+    uint8_t verdict;
+    uint64_t steps, marks;     // Halting machines: steps including the halting one; otherwise where the run stopped
+} TmResRecord;
+
+typedef struct {
+    uint64_t value;            // Steps or marks (0: no halting machine yet)
+    uint8_t key[TM_RES_KEY];
+    char table[TM_RES_TABLE];  // Enumeration: the machine in standard text ("" for loaded machines)
+} TmResLeader;
+
+typedef struct {
+    uint64_t records, halting, never, undecided;
+    TmResLeader leaders[2];    // Most steps, most marks
+} TmResCounts;
+
+typedef struct {
+    FILE *f;
+    TmResHeader header;
+    TmResCounts counts;
+    uint8_t *bitmap;
+    uint64_t bitmap_bytes;
+    uint8_t last[TM_RES_KEY];  // Key of the last record, to check the order
+} TmResWriter;
+
+typedef struct {
+    FILE *f;
+    TmResHeader header;
+    TmResCounts counts;
+    uint8_t *bitmap;
+    uint64_t next;             // Index of the next record tm_res_next() reads
+    long records_end;          // File offset of the bitmap, where the records stop
+} TmResReader;
+
+// Key of an enumeration node: its path, each child index plus one
+static inline void tm_res_path_key(const TmEnumNode *n, uint8_t *key) {
+    memset(key, 0, TM_RES_KEY);
+    for (int i = 0; i < n->depth; i++) key[i] = n->path[i] + 1;
+}
+
+// Key of a loaded machine: its population index, big-endian
+static inline void tm_res_index_key(uint64_t index, uint8_t *key) {
+    memset(key, 0, TM_RES_KEY);
+    for (int i = 0; i < 8; i++) key[i] = index >> (56 - 8 * i);
+}
+
+static inline uint64_t tm_res_key_index(const uint8_t *key) {
+    uint64_t index = 0;
+    for (int i = 0; i < 8; i++) index = index << 8 | key[i];
+    return index;
+}
+
+// An enumeration node's record from its run's TM_ENUM_* result
+static inline void tm_res_enum_record(const TmEnum *en, const TmEnumNode *n, int result, TmResRecord *r) {
+    tm_res_path_key(n, r->key);
+    r->verdict = result == TM_ENUM_AT_UNDEFINED ? TM_RES_HALTS : result == TM_ENUM_NEVER_HALTS ? TM_RES_NEVER : TM_RES_UNDECIDED;
+    r->steps = n->steps + (result == TM_ENUM_AT_UNDEFINED);
+    r->marks = result == TM_ENUM_AT_UNDEFINED ? tm_enum_halt_marks(en, n) : n->marks;
+}
+
+static inline int tm_res_create(TmResWriter *w, const char *path, const TmResHeader *header) {
+    memset(w, 0, sizeof(*w));
+    w->f = fopen(path, "wb");
+    if (!w->f) {
+        perror(path);
+        return 0;
+    }
+    w->header = *header;
+    fwrite("TMRES001", 1, 8, w->f);
+    tm_put_le(w->f, header->kind, 1);
+    tm_put_le(w->f, header->num_states, 2);
+    tm_put_le(w->f, header->num_symbols, 2);
+    tm_put_le(w->f, header->budget, 8);
+    tm_put_le(w->f, header->population, 8);
+    tm_put_le(w->f, header->fingerprint, 8);
+    tm_put_le(w->f, header->shard, 4);
+    tm_put_le(w->f, header->shards, 4);
+    tm_put_le(w->f, header->split, 4);
+    return 1;
+}
+
+// Whether a halting record would take over leader i (0: steps, 1: marks)
+static inline int tm_res_leads(const TmResCounts *c, int i, const TmResRecord *r) {
+    return r->verdict == TM_RES_HALTS && (i ? r->marks : r->steps) > c->leaders[i].value;
+}
+
+// Append a record (keys must increase). For an enumeration node, n gives a
+// new leader's rule table, with the entry under the head as its halt rule;
+// NULL leaves the text empty.
+static inline void tm_res_put(TmResWriter *w, const TmResRecord *r, const TmEnumNode *n) {
+    if (w->counts.records / 8 >= w->bitmap_bytes) {
+        uint64_t bytes = w->bitmap_bytes ? w->bitmap_bytes * 2 : 4096;
+        w->bitmap = realloc(w->bitmap, bytes);
+        memset(w->bitmap + w->bitmap_bytes, 0, bytes - w->bitmap_bytes);
+        w->bitmap_bytes = bytes;
+    }
+    for (int i = 0; i < 2; i++) {
+        if (!tm_res_leads(&w->counts, i, r)) continue;
+        TmResLeader *l = &w->counts.leaders[i];
+        l->value = i ? r->marks : r->steps;
+        memcpy(l->key, r->key, TM_RES_KEY);
+        memset(l->table, 0, TM_RES_TABLE);
+        if (n) {
+            TmRule rules[TM_ENUM_MAX_ENTRIES];
+            memcpy(rules, n->rules, sizeof(rules));
+            rules[n->state * w->header.num_symbols + tm_enum_read(n, n->position)] =
+                (TmRule){w->header.num_symbols > 1, 1, w->header.num_states};
+            tm_enum_format(l->table, rules, w->header.num_states, w->header.num_symbols);
+        }
+    }
+    if (r->verdict == TM_RES_HALTS) w->bitmap[w->counts.records / 8] |= 1 << (w->counts.records % 8);
+    w->counts.records++;
+    w->counts.halting += r->verdict == TM_RES_HALTS;
+    w->counts.never += r->verdict == TM_RES_NEVER;
+    w->counts.undecided += r->verdict == TM_RES_UNDECIDED;
+    memcpy(w->last, r->key, TM_RES_KEY);
+    int length = TM_RES_KEY;
+    while (length && !r->key[length - 1]) length--;
+    fputc(length, w->f);
+    fwrite(r->key, 1, length, w->f);
+    fputc(r->verdict, w->f);
+    tm_put_leb128(w->f, r->steps);
+    tm_put_leb128(w->f, r->marks);
+}
+
+// Write the bitmap and trailer; returns 0 if anything failed to write
+static inline int tm_res_close(TmResWriter *w) {
+    const TmResCounts *c = &w->counts;
+    fwrite(w->bitmap, 1, (c->records + 7) / 8, w->f);
+    tm_put_le(w->f, c->records, 8);
+    tm_put_le(w->f, c->halting, 8);
+    tm_put_le(w->f, c->never, 8);
+    tm_put_le(w->f, c->undecided, 8);
+    for (int i = 0; i < 2; i++) {
+        tm_put_le(w->f, c->leaders[i].value, 8);
+        fwrite(c->leaders[i].key, 1, TM_RES_KEY, w->f);
+        fwrite(c->leaders[i].table, 1, TM_RES_TABLE, w->f);
+    }
+    fwrite("TMRESEND", 1, 8, w->f);
+    int ok = !ferror(w->f);
+    ok &= fclose(w->f) == 0;
+    free(w->bitmap);
+    return ok;
+}
+
+static inline void tm_res_close_reader(TmResReader *r) {
+    if (r->f) fclose(r->f);
+    free(r->bitmap);
+    r->f = NULL;
+    r->bitmap = NULL;
+}
+
+// Open a result file: header, trailer and bitmap are read, records are read in order by tm_res_next()
+static inline int tm_res_open(TmResReader *r, const char *path) {
+    char magic[8];
+    memset(r, 0, sizeof(*r));
+    r->f = fopen(path, "rb");
+    if (!r->f) {
+        perror(path);
+        return 0;
+    }
+    TmResHeader *h = &r->header;
+    int ok = fread(magic, 1, 8, r->f) == 8 && memcmp(magic, "TMRES001", 8) == 0;
+    if (ok) {
+        h->kind = tm_get_le(r->f, 1);
+        h->num_states = tm_get_le(r->f, 2);
+        h->num_symbols = tm_get_le(r->f, 2);
+        h->budget = tm_get_le(r->f, 8);
+        h->population = tm_get_le(r->f, 8);
+        h->fingerprint = tm_get_le(r->f, 8);
+        h->shard = tm_get_le(r->f, 4);
+        h->shards = tm_get_le(r->f, 4);
+        h->split = tm_get_le(r->f, 4);
+        ok = fseek(r->f, -(long)TM_RES_TRAILER, SEEK_END) == 0;
+    }
+    long size = ok ? ftell(r->f) + TM_RES_TRAILER : 0;
+    if (ok) {
+        TmResCounts *c = &r->counts;
+        c->records = tm_get_le(r->f, 8);
+        c->halting = tm_get_le(r->f, 8);
+        c->never = tm_get_le(r->f, 8);
+        c->undecided = tm_get_le(r->f, 8);
+        for (int i = 0; i < 2; i++) {
+            c->leaders[i].value = tm_get_le(r->f, 8);
+            ok &= fread(c->leaders[i].key, 1, TM_RES_KEY, r->f) == TM_RES_KEY;
+            ok &= fread(c->leaders[i].table, 1, TM_RES_TABLE, r->f) == TM_RES_TABLE;
+            c->leaders[i].table[TM_RES_TABLE - 1] = '\0';
+        }
+        ok &= fread(magic, 1, 8, r->f) == 8 && memcmp(magic, "TMRESEND", 8) == 0 && c->records < (1ULL << 48) &&
+              (uint64_t)size >= TM_RES_HEADER + c->records * TM_RES_RECORD_MIN + (c->records + 7) / 8 + TM_RES_TRAILER;
+    }
+    if (ok) {
+        uint64_t bytes = (r->counts.records + 7) / 8;
+        r->bitmap = malloc(bytes + 1);
+        r->records_end = size - TM_RES_TRAILER - (long)bytes;
+        ok = fseek(r->f, r->records_end, SEEK_SET) == 0 &&
+             fread(r->bitmap, 1, bytes, r->f) == bytes && fseek(r->f, TM_RES_HEADER, SEEK_SET) == 0;
+    }
+    if (!ok) {
+        printf("%s is not a result file.\n", path);
+        tm_res_close_reader(r);
+    }
+    return ok;
+}
+
+// The next record in key order; 0 after the last, or at a record that runs
+// past the bitmap (the merge then finds the counts short)
+static inline int tm_res_next(TmResReader *r, TmResRecord *rec) {
+    if (r->next == r->counts.records) return 0;
+    int length = fgetc(r->f);
+    if (length < 0 || length > TM_RES_KEY) return 0;
+    memset(rec->key, 0, TM_RES_KEY);
+    if (fread(rec->key, 1, length, r->f) != (size_t)length) return 0;
+    rec->verdict = fgetc(r->f);
+    if (!tm_get_leb128(r->f, &rec->steps) || !tm_get_leb128(r->f, &rec->marks) || ftell(r->f) > r->records_end) {
+        return 0;
+    }
+    r->next++;
+    return 1;
+}
+
+// Halting bit of record i
+static inline int tm_res_halts(const TmResReader *r, uint64_t i) {
+    return (r->bitmap[i / 8] >> (i % 8)) & 1;
+}
+
+// Merge a complete set of shard files (shards 0 .. N - 1 of one split, one
+// file each) into out. Returns 0 with a message if they do not belong
+// together or disagree with themselves.
+static inline int tm_res_merge(const char *out, char **paths, int count) {
+    TmResReader *in = calloc(count, sizeof(TmResReader));
+    TmResRecord *head = calloc(count, sizeof(TmResRecord));
+    uint8_t *seen = calloc(count, 1);
+    int *live = calloc(count, sizeof(int)), ok = 1, opened = 0;
+    for (; ok && opened < count; opened++) ok = tm_res_open(&in[opened], paths[opened]);
+    if (!ok) opened--;
+    for (int i = 0; ok && i < count; i++) {
+        const TmResHeader *a = &in[0].header, *b = &in[i].header;
+        if (b->kind != a->kind || b->num_states != a->num_states || b->num_symbols != a->num_symbols ||
+            b->budget != a->budget || b->population != a->population || b->fingerprint != a->fingerprint ||
+            b->split != a->split || b->shards != a->shards) {
+            printf("%s and %s are not shards of the same run.\n", paths[0], paths[i]);
+            ok = 0;
+        } else if (b->shards != (uint32_t)count || b->shard >= b->shards || seen[b->shard]) {
+            printf("%s: shard %u of %u; merging needs each of the %u shards once.\n", paths[i], b->shard, b->shards,
+                   b->shards);
+            ok = 0;
+        } else {
+            seen[b->shard] = 1;
+            live[i] = tm_res_next(&in[i], &head[i]);
+        }
+    }
+    TmResWriter w;
+    if (ok) {
+        TmResHeader h = in[0].header;
+        h.shard = h.split = 0;
+        h.shards = 1;
+        ok = tm_res_create(&w, out, &h);
+    }
+    if (ok) {
+        TmResCounts sum;
+        memset(&sum, 0, sizeof(sum));
+        for (;;) { // Smallest key at the head of any shard
+            int best = -1;
+            for (int i = 0; i < count; i++) {
+                if (live[i] && (best < 0 || memcmp(head[i].key, head[best].key, TM_RES_KEY) < 0)) best = i;
+            }
+            if (best < 0) break;
+            if (w.counts.records && memcmp(head[best].key, w.last, TM_RES_KEY) <= 0) {
+                printf("%s: a key out of order or in two shards.\n", paths[best]);
+                ok = 0;
+                break;
+            }
+            if (tm_res_halts(&in[best], in[best].next - 1) != (head[best].verdict == TM_RES_HALTS)) {
+                printf("%s: halting bitmap disagrees with record %llu.\n", paths[best],
+                       (unsigned long long)(in[best].next - 1));
+                ok = 0;
+                break;
+            }
+            tm_res_put(&w, &head[best], NULL);
+            live[best] = tm_res_next(&in[best], &head[best]);
+        }
+        memset(w.counts.leaders, 0, sizeof(w.counts.leaders)); // Taken from the shards, with their text
+        for (int i = 0; ok && i < count; i++) {
+            const TmResCounts *c = &in[i].counts;
+            if (in[i].next != c->records) {
+                printf("%s: record %llu is damaged.\n", paths[i], (unsigned long long)in[i].next);
+                ok = 0;
+                break;
+            }
+            sum.records += c->records;
+            sum.halting += c->halting;
+            sum.never += c->never;
+            sum.undecided += c->undecided;
+            for (int l = 0; l < 2; l++) { // Larger value, or the same from a smaller key
+                const TmResLeader *a = &c->leaders[l], *b = &w.counts.leaders[l];
+                if (a->value > b->value || (a->value && a->value == b->value && memcmp(a->key, b->key, TM_RES_KEY) < 0)) {
+                    w.counts.leaders[l] = *a;
+                }
+            }
+        }
+        if (ok && (sum.records != w.counts.records || sum.halting != w.counts.halting || sum.never != w.counts.never ||
+                   sum.undecided != w.counts.undecided)) {
+            printf("Shard counts disagree with their records.\n");
+            ok = 0;
+        }
+        if (ok && w.header.kind == TM_RES_LOAD && w.counts.records != w.header.population) {
+            printf("The shards hold %llu of %llu machines.\n", (unsigned long long)w.counts.records,
+                   (unsigned long long)w.header.population);
+            ok = 0;
+        }
+        ok = tm_res_close(&w) && ok;
+        if (!ok) remove(out);
+    }
+    for (int i = 0; i < opened; i++) tm_res_close_reader(&in[i]);
+    free(in);
+    free(head);
+    free(seen);
+    free(live);
+    return ok;
+}
+
+#endif
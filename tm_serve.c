@@ -0,0 +1,134 @@
+// Simulation server and its client: batches of machines over a Unix socket (tm_serve.h)
+
+// The server keeps its workers, decided machines and macro tables between
+// batches, so a pipeline pays for startup once rather than per run.
+//   tm_serve serve SOCKET [--workers=N] [--db=PATH]
+//       Listen until SIGINT or SIGTERM. --db keeps decided machines in PATH
+//       across restarts.
+//   tm_serve submit SOCKET [--engine=plain|hashlife|exptape[=K]] [--steps=N] FILE...
+//       Send the machines in FILE... (tm_read_text format, as written by the
+//       tm_* programs' --export; - reads stdin) as one batch and print the
+//       verdict lines as they arrive. Exits 1 unless the batch completes.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tm_serve.h"
+
+#define DEFAULT_WORKERS 4 // --workers unless given (or online CPUs, if more)
+
+TmServer server;
+
+void stop(int sig) {
+    (void)sig;
+    server.stopping = 1;
+}
+
+int serve(const char *path, int workers, const char *db_path) {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = stop; // No SA_RESTART: accept() returns EINTR
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    if (!tm_serve_open(&server, path, workers, db_path)) return 1;
+    printf("Serving on %s with %d workers", path, workers);
+    if (db_path) printf(", %llu decided machines from %s", (unsigned long long)server.stored, db_path);
+    printf("\n");
+    fflush(stdout);
+    tm_serve_run(&server);
+    tm_serve_close(&server); // Every connection's thread has ended, so the batch counts are final
+    printf("Stopped: %llu batches, %llu machines, %llu answered from the database, %llu decided machines kept, "
+           "%llu macro tables reused\n", (unsigned long long)server.batches, (unsigned long long)server.machines,
+           (unsigned long long)server.hits, (unsigned long long)server.stored, (unsigned long long)server.table_reuses);
+    return 0;
+}
+
+typedef struct {
+    int fd;
+    char **files;
+    int num_files;
+    int ok;
+} Sender;
+
+// Stream the files to the server, then close the sending side to end the batch
+void *send_files(void *arg) {
+    Sender *snd = arg;
+    char buf[1 << 16];
+    snd->ok = 1;
+    for (int i = 0; i < snd->num_files && snd->ok; i++) {
+        FILE *f = strcmp(snd->files[i], "-") == 0 ? stdin : fopen(snd->files[i], "r");
+        if (!f) {
+            perror(snd->files[i]);
+            snd->ok = 0;
+            break;
+        }
+        size_t n;
+        while (snd->ok && (n = fread(buf, 1, sizeof(buf), f)) > 0) {
+            for (size_t sent = 0; sent < n;) {
+                ssize_t w = send(snd->fd, buf + sent, n - sent, MSG_NOSIGNAL);
+                if (w <= 0) {
+                    snd->ok = 0;
+                    break;
+                }
+                sent += w;
+            }
+        }
+        if (f != stdin) fclose(f);
+    }
+    shutdown(snd->fd, SHUT_WR);
+    return NULL;
+}
+
+// Replies are read while the files are still going out, so neither side
+// waits on the other's full socket buffer
+int submit(const char *path, const char *engine, unsigned long long steps, char **files, int num_files) {
+    int fd = tm_serve_connect(path);
+    if (fd < 0) return 1;
+    char line[TM_SERVE_LINE];
+    int n = snprintf(line, sizeof(line), "batch %s %llu\n", engine, steps);
+    if (send(fd, line, n, MSG_NOSIGNAL) != n) {
+        perror(path);
+        close(fd);
+        return 1;
+    }
+    Sender snd = {fd, files, num_files, 0};
+    pthread_t sender;
+    pthread_create(&sender, NULL, send_files, &snd);
+    FILE *in = fdopen(fd, "r");
+    int done = 0;
+    while (fgets(line, sizeof(line), in)) {
+        fputs(line, stdout);
+        done |= strncmp(line, "done ", 5) == 0;
+    }
+    pthread_join(sender, NULL);
+    fclose(in);
+    return done && snd.ok ? 0 : 1;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc >= 3 && strcmp(argv[1], "serve") == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        int workers = cpus > DEFAULT_WORKERS ? cpus : DEFAULT_WORKERS;
+        const char *db_path = NULL;
+        int a;
+        for (a = 3; a < argc; a++) {
+            if (strncmp(argv[a], "--workers=", 10) == 0) workers = atoi(argv[a] + 10);
+            else if (strncmp(argv[a], "--db=", 5) == 0) db_path = argv[a] + 5;
+            else break;
+        }
+        if (a == argc && workers >= 1) return serve(argv[2], workers, db_path);
+    } else if (argc >= 3 && strcmp(argv[1], "submit") == 0) {
+        const char *engine = "plain";
+        unsigned long long steps = 0;
+        int a;
+        for (a = 3; a < argc && strncmp(argv[a], "--", 2) == 0; a++) {
+            if (strncmp(argv[a], "--engine=", 9) == 0) engine = argv[a] + 9;
+            else if (strncmp(argv[a], "--steps=", 8) == 0) steps = strtoull(argv[a] + 8, NULL, 10);
+            else break;
+        }
+        if (a < argc && strncmp(argv[a], "--", 2) != 0) return submit(argv[2], engine, steps, argv + a, argc - a);
+    }
+    printf("Usage: %s serve SOCKET [--workers=N] [--db=PATH]\n", argv[0]);
+    printf("       %s submit SOCKET [--engine=plain|hashlife|exptape[=K]] [--steps=N] FILE...\n", argv[0]);
+    return 2;
+}
@@ -0,0 +1,767 @@
+// Local simulation service: worker threads, decided machines and warm macro tables behind a Unix socket
+
+// A server listens on a Unix domain socket and takes one batch per
+// connection: a line "batch ENGINE STEPS", then machines in the
+// tm_read_text() format, then the client closes its side. ENGINE is plain
+// (the tm_core kernels), hashlife (tm_hashlife.h) or exptape=K (tm_exptape.h
+// on K-cell macro cells); STEPS is the budget per machine (macro steps for
+// exptape), 0 for the engine's default. A machine is queued as soon as its
+// "end" line arrives, and its line goes back as soon as a worker decides it,
+// in completion order:
+//   verdict INDEX RESULT STEPS MARKS SOURCE
+// RESULT is halted, never (proven never to halt), running (budget spent),
+// overflow (an exptape count outgrew TmBig) or malformed (which includes a
+// tape wider than TM_SERVE_TAPE_CELLS cells and any "tapefile" line: the
+// server opens no file a client names); SOURCE is run or db. The
+// batch ends with "done MACHINES HALTED DB_HITS SECONDS".
+//
+// Each connection has a thread that polls its socket both ways: it reads
+// and queues machines, and sends the replies workers add to the
+// connection's buffer (waking it through a pipe). Workers never touch a
+// socket, so a client that writes its whole batch before reading anything,
+// or stops reading, holds up no one but itself. A reply is shorter than the
+// machine it answers, so the buffer stays below what the client sent.
+//
+// What stays warm from one batch to the next:
+//   - Each worker keeps its arena, so tapes and rule tables come off its
+//     free lists. Tapes wider than a page go back to malloc when freed, and
+//     an arena that grew past TM_SERVE_ARENA_KEEP is released after the job.
+//   - Decided machines. A halt (with its steps and marks) or a proof of
+//     non-halting is a fact about the machine whatever the engine or budget,
+//     so it is kept under a 128-bit hash of the machine (states, symbols,
+//     rules, state and the tape relative to the head) and answered without
+//     a run. With a database file, verdicts are appended as they are reached
+//     and loaded at start.
+//   - Macro tables. exptape's macro-cell rules depend only on the rule table
+//     and the block, so the largest table built for a rule table is kept
+//     (TM_SERVE_TABLES slots, by hash) and a later machine with the same
+//     rules, on any tape, starts from a copy of it.
+
+#ifndef TM_SERVE_H
+#define TM_SERVE_H
+
+#include <signal.h>
+#include <time.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "tm_core.h"
+#include "tm_hashlife.h"
+#include "tm_exptape.h"
+
+#define TM_SERVE_QUEUE 4096        // Machines queued before a connection's thread waits
+#define TM_SERVE_DB_MIN 1024       // Initial decided-machine slots (a power of two)
+#define TM_SERVE_TABLES 256        // Macro tables kept (direct-mapped by rules hash)
+#define TM_SERVE_LINE 512          // Longest reply line
+#define TM_SERVE_READ 65536        // Bytes read from a socket at a time
+#define TM_SERVE_TAPE_CELLS (1 << 26) // Widest span a machine's start and tape lines may give
+#define TM_SERVE_ARENA_KEEP (1 << 20) // Page bytes a worker's arena keeps from one job to the next
+#define TM_SERVE_CLOSE_WAIT 5      // Seconds tm_serve_close() gives clients to take their last replies
+#define TM_SERVE_PLAIN_STEPS 100000000ULL       // Default budgets per engine
+#define TM_SERVE_HASHLIFE_STEPS 1000000000000ULL
+#define TM_SERVE_EXPTAPE_STEPS 100000000ULL
+
+#define TM_SERVE_PLAIN 0           // Engines
+#define TM_SERVE_HASHLIFE 1
+#define TM_SERVE_EXPTAPE 2
+
+#define TM_SERVE_HALTED 1          // Results (halted and never are stored)
+#define TM_SERVE_NEVER 2
+#define TM_SERVE_RUNNING 3
+#define TM_SERVE_OVERFLOW 4
+#define TM_SERVE_MALFORMED 5
+
+typedef struct {
+    uint64_t key[2];               // Hash of the machine (key[0] = 0: empty slot)
+    uint8_t result;                // TM_SERVE_*
+    uint8_t pad[7];
+    char steps[TM_BIG_DIGITS];     // Decimal and exact; "-" for never
+    char marks[TM_BIG_DIGITS];
+} TmServeVerdict;
+
+typedef struct {
+    uint64_t key;                  // Hash of the rule table (0 = empty slot)
+    int block;
+    TmExpRuleSlot *slots;
+    uint32_t mask, count;
+} TmServeTable;
+
+struct TmServer;
+
+typedef struct TmServeConn {
+    struct TmServer *server;
+    struct TmServeConn *prev, *next; // Open connections (queue_lock)
+    int fd;
+    int wake[2];                   // Pipe that wakes the connection's thread for new replies
+    int engine, block;
+    uint64_t budget;
+    uint32_t machines, answered, halted, hits;
+    int input_done;                // No more machines will be queued
+    int cut;                       // Batch refused or cut short: no done line, not counted
+    int finished;                  // done line added
+    int gone;                      // The client stopped reading: replies are dropped
+    int woken;                     // A byte is waiting in the pipe
+    char *out;                     // Replies not sent yet: out[out_sent .. out_length)
+    size_t out_sent, out_length, out_capacity;
+    double start, secs;
+    pthread_mutex_t lock;          // Replies and everything above
+    char *line, *text;             // Connection thread only: the partial line, the machine so far
+    size_t line_length, line_capacity, text_length, text_capacity;
+    int started, content;          // Batch line read; the machine has a nonblank line
+} TmServeConn;
+
+typedef struct {
+    TmServeConn *conn;
+    uint32_t index;
+    char *text;                    // The machine's lines, through "end"
+    size_t length;
+} TmServeJob;
+
+typedef struct {
+    struct TmServer *server;
+    Arena arena;                   // Kept across jobs (up to TM_SERVE_ARENA_KEEP)
+    pthread_t thread;
+} TmServeWorker;
+
+typedef struct TmServer {
+    const char *path;
+    int listen_fd;
+    volatile sig_atomic_t stopping; // Set (from a signal handler, say) to end tm_serve_run()
+    int num_workers;
+    TmServeWorker *workers;
+    TmServeJob queue[TM_SERVE_QUEUE]; // Ring of jobs waiting for a worker
+    uint32_t queue_head, queue_count;
+    int closing;
+    pthread_mutex_t queue_lock;    // Also guards the batch counts and the connections
+    pthread_cond_t not_empty, not_full;
+    TmServeConn *conns;            // Connections whose threads are running
+    pthread_cond_t conns_gone;     // Signalled as each one ends
+    TmServeVerdict *verdicts;      // Decided machines, open addressing
+    uint64_t capacity, stored;
+    int db_fd;                     // Database file, -1 without one
+    pthread_mutex_t db_lock;
+    TmServeTable tables[TM_SERVE_TABLES];
+    pthread_mutex_t table_lock;
+    uint64_t batches, machines, hits, table_reuses;
+} TmServer;
+
+static inline double tm_serve_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Two independent 64-bit lanes, so a stored verdict is found by 128 bits
+static inline void tm_serve_absorb(uint64_t h[2], uint64_t x) {
+    h[0] = tm_mix64(h[0] ^ x);
+    h[1] = tm_mix64(h[1] + x * 0x9E3779B97F4A7C15ULL);
+}
+
+// Hash the machine into key; returns the hash of its rule table alone.
+// Blank cells are not hashed, so the key does not depend on how far the
+// tape happens to be allocated.
+static inline uint64_t tm_serve_key(const TmMachine *m, uint64_t key[2]) {
+    uint64_t h[2] = {0x243F6A8885A308D3ULL, 0x13198A2E03707344ULL};
+    tm_serve_absorb(h, m->num_states | (uint64_t)m->num_symbols << 16);
+    for (int i = 0; i < m->num_states * m->num_symbols; i++) {
+        const TmRule *r = &m->rules[i];
+        tm_serve_absorb(h, r->write | (uint64_t)(uint8_t)r->move << 8 | (uint64_t)r->next << 16);
+    }
+    uint64_t rules_key = h[0] ? h[0] : 1;
+    tm_serve_absorb(h, m->state);
+    for (uint64_t i = 0; i < m->length; i++) {
+        if (m->cells[i]) tm_serve_absorb(h, (uint64_t)(m->origin + (int64_t)i - m->position) << 8 | m->cells[i]);
+    }
+    key[0] = h[0] ? h[0] : 1;
+    key[1] = h[1];
+    return rules_key;
+}
+
+// Slot holding the key, or the empty slot where it belongs (db_lock held)
+static inline TmServeVerdict *tm_serve_probe(TmServer *s, const uint64_t key[2]) {
+    uint64_t mask = s->capacity - 1;
+    for (uint64_t i = key[0] & mask;; i = (i + 1) & mask) {
+        TmServeVerdict *slot = &s->verdicts[i];
+        if (slot->key[0] == 0 || (slot->key[0] == key[0] && slot->key[1] == key[1])) return slot;
+    }
+}
+
+// Add a verdict to the table, doubling it past half full (db_lock held); 0 if it was there
+static inline int tm_serve_insert(TmServer *s, const TmServeVerdict *v) {
+    if (2 * (s->stored + 1) > s->capacity) {
+        TmServeVerdict *old = s->verdicts;
+        uint64_t old_capacity = s->capacity;
+        s->capacity *= 2;
+        s->verdicts = calloc(s->capacity, sizeof(TmServeVerdict));
+        for (uint64_t i = 0; i < old_capacity; i++) {
+            if (old[i].key[0]) *tm_serve_probe(s, old[i].key) = old[i];
+        }
+        free(old);
+    }
+    TmServeVerdict *slot = tm_serve_probe(s, v->key);
+    if (slot->key[0]) return 0;
+    *slot = *v;
+    s->stored++;
+    return 1;
+}
+
+// Fill in v from the table if the machine was decided before
+static inline int tm_serve_lookup(TmServer *s, TmServeVerdict *v) {
+    pthread_mutex_lock(&s->db_lock);
+    TmServeVerdict *slot = tm_serve_probe(s, v->key);
+    int found = slot->key[0] != 0;
+    if (found) *v = *slot;
+    pthread_mutex_unlock(&s->db_lock);
+    return found;
+}
+
+// Keep a decided verdict, appending it to the database file if there is one
+static inline void tm_serve_store(TmServer *s, const TmServeVerdict *v) {
+    pthread_mutex_lock(&s->db_lock);
+    if (tm_serve_insert(s, v) && s->db_fd >= 0 && write(s->db_fd, v, sizeof(*v)) != sizeof(*v)) {
+        perror("Decided-machine database");
+    }
+    pthread_mutex_unlock(&s->db_lock);
+}
+
+// Open (or create) the database file and load its verdicts. A torn last
+// record (a write cut short) is cut off, so later appends stay aligned;
+// records that are not a halted or never verdict are skipped.
+static inline int tm_serve_load_db(TmServer *s, const char *db_path) {
+    char magic[8];
+    s->db_fd = open(db_path, O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (s->db_fd < 0) {
+        perror(db_path);
+        return 0;
+    }
+    ssize_t n = read(s->db_fd, magic, sizeof(magic));
+    if (n == 0) {
+        return write(s->db_fd, "TMSRVDB1", 8) == 8;
+    }
+    if (n != 8 || memcmp(magic, "TMSRVDB1", 8) != 0) {
+        printf("%s is not a decided-machine database.\n", db_path);
+        close(s->db_fd);
+        s->db_fd = -1;
+        return 0;
+    }
+    TmServeVerdict v;
+    off_t whole = 8;
+    uint64_t skipped = 0;
+    while (read(s->db_fd, &v, sizeof(v)) == sizeof(v)) {
+        whole += sizeof(v);
+        if (!v.key[0] || (v.result != TM_SERVE_HALTED && v.result != TM_SERVE_NEVER)) {
+            skipped++;
+            continue;
+        }
+        v.steps[TM_BIG_DIGITS - 1] = v.marks[TM_BIG_DIGITS - 1] = '\0';
+        tm_serve_insert(s, &v);
+    }
+    if (ftruncate(s->db_fd, whole) != 0) {
+        perror(db_path);
+        return 0;
+    }
+    if (skipped) printf("%s: skipped %llu records that hold no verdict.\n", db_path, (unsigned long long)skipped);
+    return 1;
+}
+
+// Start an exptape run from the macro table kept for its rules, if that one is larger
+static inline void tm_serve_table_get(TmServer *s, uint64_t rules_key, TmExpTape *e) {
+    TmServeTable *t = &s->tables[rules_key % TM_SERVE_TABLES];
+    pthread_mutex_lock(&s->table_lock);
+    if (t->key == rules_key && t->block == e->block && t->count > e->rules_cached) {
+        free(e->rule_cache);
+        e->rule_cache = malloc(((size_t)t->mask + 1) * sizeof(TmExpRuleSlot));
+        memcpy(e->rule_cache, t->slots, ((size_t)t->mask + 1) * sizeof(TmExpRuleSlot));
+        e->rule_mask = t->mask;
+        e->rules_cached = t->count;
+        s->table_reuses++;
+    }
+    pthread_mutex_unlock(&s->table_lock);
+}
+
+// Keep a run's macro table if it outgrew the one kept for its rules (or replaces another rule table's)
+static inline void tm_serve_table_put(TmServer *s, uint64_t rules_key, const TmExpTape *e) {
+    TmServeTable *t = &s->tables[rules_key % TM_SERVE_TABLES];
+    pthread_mutex_lock(&s->table_lock);
+    if (t->key != rules_key || t->block != e->block || e->rules_cached > t->count) {
+        free(t->slots);
+        t->slots = malloc(((size_t)e->rule_mask + 1) * sizeof(TmExpRuleSlot));
+        memcpy(t->slots, e->rule_cache, ((size_t)e->rule_mask + 1) * sizeof(TmExpRuleSlot));
+        t->key = rules_key;
+        t->block = e->block;
+        t->mask = e->rule_mask;
+        t->count = e->rules_cached;
+    }
+    pthread_mutex_unlock(&s->table_lock);
+}
+
+// Run a machine under the batch's engine and budget
+static inline void tm_serve_simulate(TmServer *s, const TmServeConn *c, TmMachine *m, uint64_t rules_key,
+                                     TmServeVerdict *v) {
+    if (c->engine == TM_SERVE_PLAIN) {
+        tm_kernel(m)(m, c->budget);
+        uint64_t marks = 0;
+        for (uint64_t i = 0; i < m->length; i++) marks += m->cells[i] != 0;
+        v->result = m->halted ? TM_SERVE_HALTED : TM_SERVE_RUNNING;
+        sprintf(v->steps, "%llu", (unsigned long long)m->steps);
+        sprintf(v->marks, "%llu", (unsigned long long)marks);
+    } else if (c->engine == TM_SERVE_HASHLIFE) {
+        TmHashlife h;
+        tm_hl_init(&h, m, 0);
+        tm_hl_run_until(&h, c->budget);
+        v->result = h.halted ? TM_SERVE_HALTED : h.looping ? TM_SERVE_NEVER : TM_SERVE_RUNNING;
+        tm_hl_format_steps(v->steps, h.steps);
+        sprintf(v->marks, "%llu", (unsigned long long)tm_hl_marks(&h));
+        tm_hl_free(&h);
+    } else {
+        TmExpTape e;
+        if (!tm_exp_init(&e, m, c->block)) { // Too many macro cells for this machine's symbols
+            v->result = TM_SERVE_MALFORMED;
+            return;
+        }
+        tm_serve_table_get(s, rules_key, &e);
+        tm_exp_run(&e, c->budget);
+        v->result = e.halted ? TM_SERVE_HALTED : e.infinite ? TM_SERVE_NEVER :
+                    e.overflow ? TM_SERVE_OVERFLOW : TM_SERVE_RUNNING;
+        tm_big_format(v->steps, e.steps);
+        tm_big_format(v->marks, tm_exp_marks(&e));
+        tm_serve_table_put(s, rules_key, &e);
+        tm_exp_free(&e);
+    }
+    if (v->result == TM_SERVE_NEVER) { // Steps to a proof differ by engine; the verdict does not
+        strcpy(v->steps, "-");
+        strcpy(v->marks, "-");
+    }
+}
+
+// Add a reply for the connection's thread to send, and wake it (c->lock held)
+static inline void tm_serve_reply(TmServeConn *c, const char *buf, size_t length) {
+    if (!c->gone) {
+        if (c->out_length + length > c->out_capacity) {
+            c->out_capacity = (c->out_length + length) * 2;
+            c->out = realloc(c->out, c->out_capacity);
+        }
+        memcpy(c->out + c->out_length, buf, length);
+        c->out_length += length;
+    }
+    if (!c->woken) {
+        c->woken = 1;
+        ssize_t n = write(c->wake[1], "w", 1); // Nonblocking: a full pipe is already a wakeup
+        (void)n;
+    }
+}
+
+// Send what the socket takes without waiting; a client that stopped reading gets nothing more
+static inline void tm_serve_flush(TmServeConn *c) {
+    pthread_mutex_lock(&c->lock);
+    while (c->out_sent < c->out_length && !c->gone) {
+        ssize_t n = send(c->fd, c->out + c->out_sent, c->out_length - c->out_sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) break;
+        if (n <= 0) c->gone = 1;
+        else c->out_sent += n;
+    }
+    if (c->out_sent == c->out_length || c->gone) {
+        c->out_sent = c->out_length = 0;
+    } else if (c->out_sent >= TM_SERVE_READ) { // Keep the unsent tail at the front
+        memmove(c->out, c->out + c->out_sent, c->out_length - c->out_sent);
+        c->out_length -= c->out_sent;
+        c->out_sent = 0;
+    }
+    pthread_mutex_unlock(&c->lock);
+}
+
+// Close a connection whose replies are all out, counting its batch unless
+// it was cut. The server is last touched as the connection leaves its list
+// (under queue_lock, before its descriptors close), so tm_serve_close() can
+// free the server after that.
+static inline void tm_serve_finish(TmServeConn *c) {
+    TmServer *s = c->server;
+    if (!c->cut) {
+        printf("Batch of %u machines: %u halted, %u from the database, %.3f s\n", c->machines, c->halted, c->hits,
+               c->secs);
+        fflush(stdout);
+    }
+    pthread_mutex_lock(&s->queue_lock);
+    if (!c->cut) {
+        s->batches++;
+        s->machines += c->machines;
+        s->hits += c->hits;
+    }
+    if (c->prev) c->prev->next = c->next;
+    else s->conns = c->next;
+    if (c->next) c->next->prev = c->prev;
+    pthread_cond_signal(&s->conns_gone);
+    pthread_mutex_unlock(&s->queue_lock);
+    close(c->fd);
+    close(c->wake[0]);
+    close(c->wake[1]);
+    free(c->out);
+    free(c->line);
+    free(c->text);
+    pthread_mutex_destroy(&c->lock);
+    free(c);
+}
+
+// Parse, look up or run one machine, and add its line to the connection's replies
+static inline void tm_serve_job(TmServeWorker *w, TmServeJob *job) {
+    static const char *results[] = {"", "halted", "never", "running", "overflow", "malformed"};
+    TmServer *s = w->server;
+    TmServeConn *c = job->conn;
+    TmServeVerdict v;
+    TmMachine m;
+    int from_db = 0;
+    memset(&v, 0, sizeof(v));
+    FILE *f = fmemopen(job->text, job->length, "r");
+    if (f && tm_read_text_limited(f, &m, &w->arena, TM_SERVE_TAPE_CELLS, 0) == 1) {
+        uint64_t rules_key = tm_serve_key(&m, v.key);
+        from_db = tm_serve_lookup(s, &v);
+        if (!from_db) {
+            tm_serve_simulate(s, c, &m, rules_key, &v);
+            if (v.result == TM_SERVE_HALTED || v.result == TM_SERVE_NEVER) tm_serve_store(s, &v);
+        }
+        tm_free_tape(&m);
+        arena_free(&w->arena, m.rules, (size_t)m.num_states * m.num_symbols * sizeof(TmRule));
+    } else {
+        v.result = TM_SERVE_MALFORMED;
+    }
+    if (f) fclose(f);
+    free(job->text);
+    if (w->arena.reserved > TM_SERVE_ARENA_KEEP) arena_free_all(&w->arena); // Nothing in it is live now
+    if (v.result == TM_SERVE_MALFORMED) {
+        strcpy(v.steps, "-");
+        strcpy(v.marks, "-");
+    }
+    char line[TM_SERVE_LINE];
+    int n = snprintf(line, sizeof(line), "verdict %u %s %s %s %s\n", job->index, results[v.result], v.steps, v.marks,
+                     from_db ? "db" : "run");
+    pthread_mutex_lock(&c->lock);
+    c->answered++;
+    c->halted += v.result == TM_SERVE_HALTED;
+    c->hits += from_db;
+    tm_serve_reply(c, line, n);
+    pthread_mutex_unlock(&c->lock);
+}
+
+static inline void *tm_serve_worker(void *arg) {
+    TmServeWorker *w = arg;
+    TmServer *s = w->server;
+    for (;;) {
+        pthread_mutex_lock(&s->queue_lock);
+        while (!s->queue_count && !s->closing) pthread_cond_wait(&s->not_empty, &s->queue_lock);
+        if (!s->queue_count) { // Closing and drained
+            pthread_mutex_unlock(&s->queue_lock);
+            return NULL;
+        }
+        TmServeJob job = s->queue[s->queue_head];
+        s->queue_head = (s->queue_head + 1) % TM_SERVE_QUEUE;
+        s->queue_count--;
+        pthread_cond_signal(&s->not_full);
+        pthread_mutex_unlock(&s->queue_lock);
+        tm_serve_job(w, &job);
+    }
+}
+
+// Queue a machine, waiting while the queue is full; 0 once the server is closing
+static inline int tm_serve_push(TmServer *s, const TmServeJob *job) {
+    pthread_mutex_lock(&s->queue_lock);
+    while (s->queue_count == TM_SERVE_QUEUE && !s->closing) pthread_cond_wait(&s->not_full, &s->queue_lock);
+    int ok = !s->closing;
+    if (ok) {
+        s->queue[(s->queue_head + s->queue_count) % TM_SERVE_QUEUE] = *job;
+        s->queue_count++;
+        pthread_cond_signal(&s->not_empty);
+    }
+    pthread_mutex_unlock(&s->queue_lock);
+    return ok;
+}
+
+// Engine and budget from the batch line's words
+static inline int tm_serve_engine(TmServeConn *c, const char *engine, uint64_t budget) {
+    c->block = 1;
+    if (strcmp(engine, "plain") == 0) {
+        c->engine = TM_SERVE_PLAIN;
+        c->budget = budget ? budget : TM_SERVE_PLAIN_STEPS;
+    } else if (strcmp(engine, "hashlife") == 0) {
+        c->engine = TM_SERVE_HASHLIFE;
+        c->budget = budget ? budget : TM_SERVE_HASHLIFE_STEPS;
+    } else if (strcmp(engine, "exptape") == 0 || strncmp(engine, "exptape=", 8) == 0) {
+        c->engine = TM_SERVE_EXPTAPE;
+        c->budget = budget ? budget : TM_SERVE_EXPTAPE_STEPS;
+        if (engine[7]) c->block = atoi(engine + 8);
+        if (c->block < 1) return 0;
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+// Queue a machine's text as the connection's next job; 0 (the batch is cut) once the server is closing
+static inline int tm_serve_submit_job(TmServeConn *c, char *text, size_t length) {
+    TmServeJob job = {c, 0, text, length};
+    pthread_mutex_lock(&c->lock);
+    job.index = c->machines++;
+    pthread_mutex_unlock(&c->lock);
+    if (tm_serve_push(c->server, &job)) return 1;
+    free(text);
+    pthread_mutex_lock(&c->lock);
+    c->machines--;
+    c->cut = c->input_done = 1;
+    pthread_mutex_unlock(&c->lock);
+    return 0;
+}
+
+// One line of input (NUL-terminated): the batch line first, then machine
+// text, queued at each "end" line
+static inline void tm_serve_line(TmServeConn *c, const char *line, size_t n) {
+    char engine[32], word[16];
+    unsigned long long budget;
+    if (!c->started) {
+        c->started = 1;
+        if (sscanf(line, "batch %31s %llu", engine, &budget) != 2 || !tm_serve_engine(c, engine, budget)) {
+            static const char error[] = "error expected \"batch plain|hashlife|exptape[=K] STEPS\"\n";
+            pthread_mutex_lock(&c->lock);
+            tm_serve_reply(c, error, sizeof(error) - 1);
+            c->cut = c->input_done = 1;
+            pthread_mutex_unlock(&c->lock);
+        }
+        return;
+    }
+    if (c->text_length + n + 1 > c->text_capacity) {
+        c->text_capacity = (c->text_length + n + 1) * 2;
+        c->text = realloc(c->text, c->text_capacity);
+    }
+    memcpy(c->text + c->text_length, line, n + 1);
+    c->text_length += n;
+    if (sscanf(line, " %15s", word) != 1) return;
+    c->content = 1;
+    if (strcmp(word, "end") == 0) {
+        tm_serve_submit_job(c, c->text, c->text_length);
+        c->text = NULL;
+        c->text_length = c->text_capacity = c->content = 0;
+    }
+}
+
+// Bytes read from the client, cut into lines (a partial last line waits for the rest)
+static inline void tm_serve_input(TmServeConn *c, const char *buf, size_t n) {
+    if (c->line_length + n + 2 > c->line_capacity) {
+        c->line_capacity = (c->line_length + n + 2) * 2;
+        c->line = realloc(c->line, c->line_capacity);
+    }
+    memcpy(c->line + c->line_length, buf, n);
+    size_t start = 0, end = c->line_length + n;
+    for (size_t i = c->line_length; i < end && !c->input_done; i++) {
+        if (c->line[i] != '\n') continue;
+        char next = c->line[i + 1];
+        c->line[i + 1] = '\0';
+        tm_serve_line(c, c->line + start, i + 1 - start);
+        c->line[i + 1] = next;
+        start = i + 1;
+    }
+    memmove(c->line, c->line + start, end - start);
+    c->line_length = end - start;
+}
+
+// The client closed its side (or the connection failed). Text after the
+// last "end" is queued too, so it comes back malformed.
+static inline void tm_serve_input_end(TmServeConn *c) {
+    if (!c->input_done && (c->line_length || !c->started)) {
+        if (c->line_length + 1 > c->line_capacity) c->line = realloc(c->line, c->line_capacity = c->line_length + 1);
+        c->line[c->line_length] = '\0';
+        tm_serve_line(c, c->line, c->line_length);
+        c->line_length = 0;
+    }
+    if (!c->input_done && c->content) {
+        tm_serve_submit_job(c, c->text, c->text_length);
+        c->text = NULL;
+    }
+    pthread_mutex_lock(&c->lock);
+    c->input_done = 1;
+    pthread_mutex_unlock(&c->lock);
+}
+
+// One connection's thread: read and queue machines, send replies as workers
+// add them, and close once every machine is answered and sent
+static inline void *tm_serve_conn(void *arg) {
+    TmServeConn *c = arg;
+    char buf[TM_SERVE_READ];
+    for (;;) {
+        pthread_mutex_lock(&c->lock);
+        c->woken = 0;
+        int done = c->input_done && c->answered == c->machines;
+        if (done && !c->finished) {
+            c->finished = 1;
+            c->secs = tm_serve_now() - c->start;
+            if (!c->cut) {
+                int n = snprintf(buf, sizeof(buf), "done %u %u %u %.3f\n", c->machines, c->halted, c->hits, c->secs);
+                tm_serve_reply(c, buf, n);
+            }
+        }
+        int pending = c->out_length > c->out_sent && !c->gone;
+        int reading = !c->input_done;
+        pthread_mutex_unlock(&c->lock);
+        if (done && !pending) break;
+        struct pollfd p[2] = {{reading || pending ? c->fd : -1, (reading ? POLLIN : 0) | (pending ? POLLOUT : 0), 0},
+                              {c->wake[0], POLLIN, 0}};
+        if (poll(p, 2, -1) < 0) continue; // EINTR
+        if (p[1].revents) {
+            while (read(c->wake[0], buf, sizeof(buf)) > 0) {}
+        }
+        if (pending && p[0].revents & (POLLOUT | POLLERR | POLLHUP)) tm_serve_flush(c);
+        if (reading && p[0].revents & (POLLIN | POLLERR | POLLHUP)) {
+            ssize_t n = recv(c->fd, buf, sizeof(buf), MSG_DONTWAIT);
+            if (n > 0) tm_serve_input(c, buf, n);
+            else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) tm_serve_input_end(c);
+        }
+    }
+    tm_serve_finish(c);
+    return NULL;
+}
+
+// Start a thread with SIGINT and SIGTERM blocked, so they reach the thread in tm_serve_run()
+static inline int tm_serve_spawn(pthread_t *thread, void *(*fn)(void *), void *arg) {
+    sigset_t block, old;
+    sigemptyset(&block);
+    sigaddset(&block, SIGINT);
+    sigaddset(&block, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &block, &old);
+    int r = pthread_create(thread, NULL, fn, arg);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    return r == 0;
+}
+
+// Listen on path (replacing a stale socket), load the database if db_path
+// is given, and start the workers. Returns 0 with a message on failure.
+static inline int tm_serve_open(TmServer *s, const char *path, int num_workers, const char *db_path) {
+    struct sockaddr_un addr;
+    memset(s, 0, sizeof(*s));
+    s->path = path;
+    s->db_fd = -1;
+    s->capacity = TM_SERVE_DB_MIN;
+    s->verdicts = calloc(s->capacity, sizeof(TmServeVerdict));
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        printf("Socket path %s is too long.\n", path);
+        return 0;
+    }
+    if (db_path && !tm_serve_load_db(s, db_path)) return 0;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    s->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path);
+    if (s->listen_fd < 0 || bind(s->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(s->listen_fd, 64) != 0) {
+        perror(path);
+        return 0;
+    }
+    pthread_mutex_init(&s->queue_lock, NULL);
+    pthread_mutex_init(&s->db_lock, NULL);
+    pthread_mutex_init(&s->table_lock, NULL);
+    pthread_cond_init(&s->not_empty, NULL);
+    pthread_cond_init(&s->not_full, NULL);
+    pthread_cond_init(&s->conns_gone, NULL);
+    s->num_workers = num_workers;
+    s->workers = calloc(num_workers, sizeof(TmServeWorker));
+    for (int i = 0; i < num_workers; i++) {
+        s->workers[i].server = s;
+        if (!tm_serve_spawn(&s->workers[i].thread, tm_serve_worker, &s->workers[i])) {
+            printf("Could not start worker %d.\n", i);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Accept connections, a thread each, until stopping is set
+static inline void tm_serve_run(TmServer *s) {
+    while (!s->stopping) {
+        int fd = accept(s->listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            perror("accept");
+            break;
+        }
+        TmServeConn *c = calloc(1, sizeof(TmServeConn));
+        pthread_t thread;
+        c->server = s;
+        c->fd = fd;
+        c->start = tm_serve_now();
+        pthread_mutex_init(&c->lock, NULL);
+        if (pipe(c->wake) != 0) {
+            perror("pipe");
+            close(fd);
+            free(c);
+            continue;
+        }
+        fcntl(c->wake[0], F_SETFL, O_NONBLOCK);
+        fcntl(c->wake[1], F_SETFL, O_NONBLOCK);
+        pthread_mutex_lock(&s->queue_lock); // Listed before its thread can finish and unlist it
+        c->next = s->conns;
+        if (s->conns) s->conns->prev = c;
+        s->conns = c;
+        pthread_mutex_unlock(&s->queue_lock);
+        if (!tm_serve_spawn(&thread, tm_serve_conn, c)) {
+            c->cut = 1;
+            tm_serve_finish(c);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+}
+
+// Wake every connection's thread after shutting its socket down (queue_lock held)
+static inline void tm_serve_shutdown_conns(TmServer *s, int how) {
+    for (TmServeConn *c = s->conns; c; c = c->next) {
+        shutdown(c->fd, how);
+        ssize_t n = write(c->wake[1], "w", 1);
+        (void)n;
+    }
+}
+
+// Stop listening, let the workers finish what is queued, and free everything
+// once every connection's thread has ended. Batches still being read are cut
+// short; replies go out to clients that take them within TM_SERVE_CLOSE_WAIT
+// seconds, after which the rest are dropped.
+static inline void tm_serve_close(TmServer *s) {
+    close(s->listen_fd);
+    unlink(s->path);
+    pthread_mutex_lock(&s->queue_lock);
+    s->closing = 1;
+    pthread_cond_broadcast(&s->not_empty);
+    pthread_cond_broadcast(&s->not_full);
+    tm_serve_shutdown_conns(s, SHUT_RD); // Reading threads see the end of their input
+    pthread_mutex_unlock(&s->queue_lock);
+    for (int i = 0; i < s->num_workers; i++) {
+        pthread_join(s->workers[i].thread, NULL);
+        arena_free_all(&s->workers[i].arena);
+    }
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += TM_SERVE_CLOSE_WAIT;
+    pthread_mutex_lock(&s->queue_lock);
+    while (s->conns && pthread_cond_timedwait(&s->conns_gone, &s->queue_lock, &deadline) == 0) {}
+    tm_serve_shutdown_conns(s, SHUT_RDWR); // Clients that stopped reading: sends fail, replies are dropped
+    while (s->conns) pthread_cond_wait(&s->conns_gone, &s->queue_lock);
+    pthread_mutex_unlock(&s->queue_lock);
+    for (int i = 0; i < TM_SERVE_TABLES; i++) free(s->tables[i].slots);
+    free(s->workers);
+    free(s->verdicts);
+    if (s->db_fd >= 0) close(s->db_fd);
+}
+
+// Connect to a server's socket; -1 with a message if none is listening
+static inline int tm_serve_connect(const char *path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        perror(path);
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+#endif
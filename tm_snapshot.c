@@ -0,0 +1,102 @@
+// Tape snapshot tool: summary, any window, and diffs between two snapshots (tm_snapshot.h)
+
+// Snapshots come from --snapshot in the tm_* programs and ittm_dovetail --load.
+//   tm_snapshot info FILE             head, state, steps, stored blocks and marks
+//   tm_snapshot window FILE POS COUNT cells POS .. POS + COUNT - 1, decoding only their blocks
+//   tm_snapshot diff A B              differing head fields and blocks (hashes first); exit 1 if any
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tm_snapshot.h"
+
+#define WINDOW_MAX (1 << 20) // Most cells one window prints
+
+void print_head(const char *path, const TmSnapReader *r) {
+    printf("%s: %u symbols, state %u%s, position %lld, %llu steps, %llu blocks of %d cells stored\n", path,
+           r->num_symbols, r->head.state, r->head.halted ? " (halted)" : "", (long long)r->head.position,
+           (unsigned long long)r->head.steps, (unsigned long long)r->num_blocks, TM_SNAP_BLOCK);
+}
+
+int info(const char *path) {
+    TmSnapReader r;
+    if (!tm_snap_open(&r, path)) return 1;
+    print_head(path, &r);
+    uint64_t marks = 0;
+    for (uint64_t i = 0; i < r.num_blocks; i++) { // Streams through every block once
+        if (!tm_snap_block(&r, i)) {
+            printf("%s: block %llu is malformed.\n", path, (unsigned long long)i);
+            tm_snap_close_reader(&r);
+            return 1;
+        }
+        for (int c = 0; c < TM_SNAP_BLOCK; c++) marks += r.cells[c] != 0;
+    }
+    if (r.num_blocks) {
+        printf("Stored positions %lld .. %lld, %llu nonblank cells\n", (long long)(r.index[0].block * TM_SNAP_BLOCK),
+               (long long)((r.index[r.num_blocks - 1].block + 1) * TM_SNAP_BLOCK - 1), (unsigned long long)marks);
+    }
+    tm_snap_close_reader(&r);
+    return 0;
+}
+
+int window(const char *path, long long pos, long long count) {
+    TmSnapReader r;
+    if (count < 1 || count > WINDOW_MAX) {
+        printf("COUNT must be 1-%d.\n", WINDOW_MAX);
+        return 1;
+    }
+    if (!tm_snap_open(&r, path)) return 1;
+    uint8_t *cells = malloc(count);
+    int ok = tm_snap_window(&r, pos, count, cells);
+    if (ok) {
+        for (long long i = 0; i < count; i++) {
+            printf(pos + i == r.head.position ? "[%d]" : "%d", cells[i]);
+            printf(i + 1 < count ? " " : "\n");
+        }
+    } else {
+        printf("%s: malformed block in the window.\n", path);
+    }
+    free(cells);
+    tm_snap_close_reader(&r);
+    return !ok;
+}
+
+int diff(const char *path_a, const char *path_b) {
+    TmSnapReader a, b;
+    if (!tm_snap_open(&a, path_a)) return 1;
+    if (!tm_snap_open(&b, path_b)) {
+        tm_snap_close_reader(&a);
+        return 1;
+    }
+    int differ = 0;
+    if (a.head.position != b.head.position || a.head.state != b.head.state || a.head.halted != b.head.halted ||
+        a.head.steps != b.head.steps || a.num_symbols != b.num_symbols) {
+        print_head(path_a, &a);
+        print_head(path_b, &b);
+        differ = 1;
+    }
+    int64_t first = 0, blocks = tm_snap_diff(&a, &b, &first);
+    if (blocks < 0) {
+        printf("Malformed block in %s or %s.\n", path_a, path_b);
+        differ = 1;
+    } else if (blocks > 0) {
+        printf("Tapes differ in %lld blocks, first at position %lld\n", (long long)blocks, (long long)first);
+        differ = 1;
+    } else {
+        printf("Tapes are the same (%llu and %llu blocks stored)\n", (unsigned long long)a.num_blocks,
+               (unsigned long long)b.num_blocks);
+    }
+    tm_snap_close_reader(&a);
+    tm_snap_close_reader(&b);
+    return differ;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc == 3 && strcmp(argv[1], "info") == 0) return info(argv[2]);
+    if (argc == 5 && strcmp(argv[1], "window") == 0) return window(argv[2], atoll(argv[3]), atoll(argv[4]));
+    if (argc == 4 && strcmp(argv[1], "diff") == 0) return diff(argv[2], argv[3]);
+    printf("Usage: %s info FILE\n", argv[0]);
+    printf("       %s window FILE POS COUNT\n", argv[0]);
+    printf("       %s diff A B\n", argv[0]);
+    return 2;
+}
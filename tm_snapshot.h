@@ -0,0 +1,355 @@
+// Compressed tape snapshots: streaming writer, random-access reader, block-level diff
+
+// A snapshot holds a machine's tape, head, state and step count. The tape is
+// cut at absolute positions into blocks of TM_SNAP_BLOCK cells (block k is
+// positions k * TM_SNAP_BLOCK onward, so two snapshots' blocks line up
+// whatever their extent); blocks that are all blank are not stored. Each
+// stored block is encoded the smaller of two ways: runs (a symbol byte and
+// a LEB128 count) or cells bit-packed at 1, 2, 4 or 8 bits each.
+//
+// File layout, integers little-endian:
+//   "TMSNAP01", u32 block cells, u16 symbols
+//   blocks: u8 encoding, u32 payload bytes, payload
+//   index: per block i64 block number, u64 file offset, u64 hash of its cells
+//   trailer: i64 position, u64 steps, u16 state, u8 halted, u64 blocks,
+//            u64 index offset, "TMSNAPIX"
+// The writer streams: cells go in by increasing position and each block is
+// written as soon as the next one starts. A reader loads the index only, so
+// a window decodes just the blocks it covers, and two snapshots diff by
+// comparing block hashes and decoding only blocks that differ.
+
+#ifndef TM_SNAPSHOT_H
+#define TM_SNAPSHOT_H
+
+#include "tm_core.h"
+
+#define TM_SNAP_BLOCK 65536        // Cells per block
+#define TM_SNAP_RUNS 0             // Block encodings: runs of (symbol, LEB128 count)
+#define TM_SNAP_PACKED 1           // Cells at the snapshot's bits per cell
+#define TM_SNAP_MAX_PAYLOAD (TM_SNAP_BLOCK * 2) // Runs never take more than two bytes a cell
+
+typedef struct {
+    int64_t block;             // Block number (positions block * TM_SNAP_BLOCK onward)
+    uint64_t offset;           // File offset of its encoding byte
+    uint64_t hash;             // Of its TM_SNAP_BLOCK decoded cells
+} TmSnapIndex;
+
+typedef struct {
+    int64_t position;
+    uint64_t steps;
+    uint16_t state;
+    uint8_t halted;
+} TmSnapHead;
+
+typedef struct {
+    FILE *f;
+    uint16_t num_symbols;
+    int bits;                  // Bits per cell when packed
+    int64_t block;             // Block being filled, INT64_MIN before the first cell
+    uint8_t *cells;            // Its cells
+    uint8_t *payload;
+    TmSnapIndex *index;
+    uint64_t num_blocks, capacity;
+    uint64_t bytes;            // Written so far
+} TmSnapWriter;
+
+typedef struct {
+    FILE *f;
+    uint16_t num_symbols;
+    int bits;
+    TmSnapHead head;
+    TmSnapIndex *index;
+    uint64_t num_blocks;
+    int64_t cached;            // Block held in cells, INT64_MIN if none
+    uint8_t *cells;
+    uint8_t *payload;
+} TmSnapReader;
+
+static inline uint64_t tm_snap_hash(const uint8_t *cells) {
+    uint64_t h = 0x9e3779b97f4a7c15ULL;
+    for (int i = 0; i < TM_SNAP_BLOCK; i += 8) {
+        uint64_t x;
+        memcpy(&x, cells + i, 8);
+        h = (h ^ x) * 0xff51afd7ed558ccdULL;
+        h ^= h >> 32;
+    }
+    return h;
+}
+
+// Bits per packed cell for a symbol count: 1, 2, 4 or 8
+static inline int tm_snap_bits(int num_symbols) {
+    int bits = 1;
+    while ((1 << bits) < num_symbols) bits *= 2;
+    return bits;
+}
+
+static inline int tm_snap_create(TmSnapWriter *w, const char *path, int num_symbols) {
+    memset(w, 0, sizeof(*w));
+    w->f = fopen(path, "wb");
+    if (!w->f) {
+        perror(path);
+        return 0;
+    }
+    w->num_symbols = num_symbols;
+    w->bits = tm_snap_bits(num_symbols);
+    w->block = INT64_MIN;
+    w->cells = calloc(TM_SNAP_BLOCK, 1);
+    w->payload = malloc(TM_SNAP_MAX_PAYLOAD);
+    fwrite("TMSNAP01", 1, 8, w->f);
+    tm_put_le(w->f, TM_SNAP_BLOCK, 4);
+    tm_put_le(w->f, num_symbols, 2);
+    w->bytes = 14;
+    return 1;
+}
+
+// Encode and write the block being filled (nothing if it is all blank)
+static inline void tm_snap_flush(TmSnapWriter *w) {
+    if (w->block == INT64_MIN) return;
+    const uint8_t *c = w->cells;
+    uint64_t runs = 0;
+    int blank = 1;
+    for (int i = 0; i < TM_SNAP_BLOCK;) { // Runs encoding, kept if smaller than packed
+        int j = i;
+        while (j < TM_SNAP_BLOCK && c[j] == c[i]) j++;
+        blank &= c[i] == 0;
+        w->payload[runs++] = c[i];
+        runs += tm_leb128_encode(w->payload + runs, j - i);
+        i = j;
+    }
+    if (!blank) {
+        uint64_t packed = (uint64_t)TM_SNAP_BLOCK * w->bits / 8;
+        int encoding = runs <= packed ? TM_SNAP_RUNS : TM_SNAP_PACKED;
+        if (encoding == TM_SNAP_PACKED) {
+            memset(w->payload, 0, packed);
+            for (int i = 0; i < TM_SNAP_BLOCK; i++) {
+                w->payload[(uint64_t)i * w->bits / 8] |= c[i] << ((i * w->bits) % 8);
+            }
+        }
+        uint64_t size = encoding == TM_SNAP_RUNS ? runs : packed;
+        if (w->num_blocks == w->capacity) {
+            w->capacity = w->capacity ? w->capacity * 2 : 64;
+            w->index = realloc(w->index, w->capacity * sizeof(TmSnapIndex));
+        }
+        w->index[w->num_blocks++] = (TmSnapIndex){w->block, w->bytes, tm_snap_hash(c)};
+        fputc(encoding, w->f);
+        tm_put_le(w->f, size, 4);
+        fwrite(w->payload, 1, size, w->f);
+        w->bytes += 5 + size;
+    }
+    memset(w->cells, 0, TM_SNAP_BLOCK);
+}
+
+// Append count cells from position pos on (positions only ever increase)
+static inline void tm_snap_put(TmSnapWriter *w, int64_t pos, const uint8_t *cells, uint64_t count) {
+    while (count) {
+        int64_t block = pos >= 0 ? pos / TM_SNAP_BLOCK : -((-pos - 1) / TM_SNAP_BLOCK) - 1;
+        if (block != w->block) {
+            tm_snap_flush(w);
+            w->block = block;
+        }
+        uint64_t at = pos - block * TM_SNAP_BLOCK, n = TM_SNAP_BLOCK - at;
+        if (n > count) n = count;
+        memcpy(w->cells + at, cells, n);
+        pos += n;
+        cells += n;
+        count -= n;
+    }
+}
+
+// Write the last block, the index and the trailer; returns 0 on a write error
+static inline int tm_snap_close(TmSnapWriter *w, const TmSnapHead *head) {
+    tm_snap_flush(w);
+    uint64_t index_offset = w->bytes;
+    for (uint64_t i = 0; i < w->num_blocks; i++) {
+        tm_put_le(w->f, w->index[i].block, 8);
+        tm_put_le(w->f, w->index[i].offset, 8);
+        tm_put_le(w->f, w->index[i].hash, 8);
+    }
+    tm_put_le(w->f, head->position, 8);
+    tm_put_le(w->f, head->steps, 8);
+    tm_put_le(w->f, head->state, 2);
+    tm_put_le(w->f, head->halted, 1);
+    tm_put_le(w->f, w->num_blocks, 8);
+    tm_put_le(w->f, index_offset, 8);
+    fwrite("TMSNAPIX", 1, 8, w->f);
+    int ok = !ferror(w->f);
+    ok &= fclose(w->f) == 0;
+    free(w->cells);
+    free(w->payload);
+    free(w->index);
+    return ok;
+}
+
+// A machine's whole tape, head and state
+static inline int tm_snap_save(const char *path, const TmMachine *m) {
+    TmSnapWriter w;
+    if (!tm_snap_create(&w, path, m->num_symbols)) return 0;
+    tm_snap_put(&w, m->origin, m->cells, m->length);
+    TmSnapHead head = {m->position, m->steps, m->state, m->halted};
+    if (!tm_snap_close(&w, &head)) {
+        printf("%s: write failed.\n", path);
+        return 0;
+    }
+    return 1;
+}
+
+static inline void tm_snap_close_reader(TmSnapReader *r) {
+    if (r->f) fclose(r->f);
+    free(r->index);
+    free(r->cells);
+    free(r->payload);
+    memset(r, 0, sizeof(*r));
+}
+
+// Open a snapshot: header, trailer and index only; returns 0 with a message if malformed
+static inline int tm_snap_open(TmSnapReader *r, const char *path) {
+    char magic[8];
+    memset(r, 0, sizeof(*r));
+    r->f = fopen(path, "rb");
+    if (!r->f) {
+        perror(path);
+        return 0;
+    }
+    const int trailer = 8 + 8 + 2 + 1 + 8 + 8 + 8;
+    int ok = fread(magic, 1, 8, r->f) == 8 && memcmp(magic, "TMSNAP01", 8) == 0 &&
+             tm_get_le(r->f, 4) == TM_SNAP_BLOCK;
+    r->num_symbols = tm_get_le(r->f, 2);
+    uint64_t index_offset = 0;
+    if (ok && fseek(r->f, -trailer, SEEK_END) == 0) {
+        r->head.position = tm_get_le(r->f, 8);
+        r->head.steps = tm_get_le(r->f, 8);
+        r->head.state = tm_get_le(r->f, 2);
+        r->head.halted = tm_get_le(r->f, 1);
+        r->num_blocks = tm_get_le(r->f, 8);
+        index_offset = tm_get_le(r->f, 8);
+        ok = fread(magic, 1, 8, r->f) == 8 && memcmp(magic, "TMSNAPIX", 8) == 0 && r->num_blocks < (1ULL << 40);
+    } else {
+        ok = 0;
+    }
+    if (ok && fseek(r->f, index_offset, SEEK_SET) == 0) {
+        r->index = malloc((r->num_blocks + 1) * sizeof(TmSnapIndex));
+        for (uint64_t i = 0; i < r->num_blocks; i++) {
+            r->index[i].block = tm_get_le(r->f, 8);
+            r->index[i].offset = tm_get_le(r->f, 8);
+            r->index[i].hash = tm_get_le(r->f, 8);
+            ok &= i == 0 || r->index[i].block > r->index[i - 1].block;
+        }
+        ok &= !feof(r->f);
+    } else {
+        ok = 0;
+    }
+    if (!ok) {
+        printf("%s: not a tape snapshot.\n", path);
+        tm_snap_close_reader(r);
+        return 0;
+    }
+    r->bits = tm_snap_bits(r->num_symbols);
+    r->cached = INT64_MIN;
+    r->cells = malloc(TM_SNAP_BLOCK);
+    r->payload = malloc(TM_SNAP_MAX_PAYLOAD);
+    return 1;
+}
+
+// Index entry of a block, or -1 if the block is blank
+static inline int64_t tm_snap_find(const TmSnapReader *r, int64_t block) {
+    uint64_t lo = 0, hi = r->num_blocks;
+    while (lo < hi) {
+        uint64_t mid = (lo + hi) / 2;
+        if (r->index[mid].block < block) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo < r->num_blocks && r->index[lo].block == block ? (int64_t)lo : -1;
+}
+
+// Decode stored block i into r->cells; returns 0 if it is malformed
+static inline int tm_snap_block(TmSnapReader *r, uint64_t i) {
+    if (r->cached == r->index[i].block) return 1;
+    r->cached = INT64_MIN;
+    if (fseek(r->f, r->index[i].offset, SEEK_SET) != 0) return 0;
+    int encoding = fgetc(r->f);
+    uint64_t size = tm_get_le(r->f, 4);
+    if (size > TM_SNAP_MAX_PAYLOAD || fread(r->payload, 1, size, r->f) != size) return 0;
+    if (encoding == TM_SNAP_PACKED) {
+        if (size != (uint64_t)TM_SNAP_BLOCK * r->bits / 8) return 0;
+        for (int c = 0; c < TM_SNAP_BLOCK; c++) {
+            r->cells[c] = (r->payload[(uint64_t)c * r->bits / 8] >> ((c * r->bits) % 8)) & ((1 << r->bits) - 1);
+        }
+    } else if (encoding == TM_SNAP_RUNS) {
+        uint64_t p = 0, at = 0;
+        while (p < size) {
+            uint8_t symbol = r->payload[p++];
+            uint64_t count;
+            if (!tm_leb128_decode(r->payload, size, &p, &count) || count > TM_SNAP_BLOCK - at) return 0;
+            memset(r->cells + at, symbol, count);
+            at += count;
+        }
+        if (at != TM_SNAP_BLOCK) return 0;
+    } else {
+        return 0;
+    }
+    r->cached = r->index[i].block;
+    return 1;
+}
+
+// count cells from pos on into out (blank outside the stored blocks); returns 0 if a block is malformed
+static inline int tm_snap_window(TmSnapReader *r, int64_t pos, uint64_t count, uint8_t *out) {
+    while (count) {
+        int64_t block = pos >= 0 ? pos / TM_SNAP_BLOCK : -((-pos - 1) / TM_SNAP_BLOCK) - 1;
+        uint64_t at = pos - block * TM_SNAP_BLOCK, n = TM_SNAP_BLOCK - at;
+        if (n > count) n = count;
+        int64_t i = tm_snap_find(r, block);
+        if (i < 0) {
+            memset(out, 0, n);
+        } else {
+            if (!tm_snap_block(r, i)) return 0;
+            memcpy(out, r->cells + at, n);
+        }
+        pos += n;
+        out += n;
+        count -= n;
+    }
+    return 1;
+}
+
+// Blocks whose cells differ between two snapshots, found by hash and
+// confirmed by decoding; *first is the lowest position that differs (left
+// alone if none). Returns -1 if a block is malformed.
+static inline int64_t tm_snap_diff(TmSnapReader *a, TmSnapReader *b, int64_t *first) {
+    uint8_t *other = malloc(TM_SNAP_BLOCK);
+    int64_t differ = 0;
+    uint64_t i = 0, j = 0;
+    while (i < a->num_blocks || j < b->num_blocks) {
+        int64_t ka = i < a->num_blocks ? a->index[i].block : INT64_MAX;
+        int64_t kb = j < b->num_blocks ? b->index[j].block : INT64_MAX;
+        int64_t block = ka < kb ? ka : kb;
+        if (ka == kb && a->index[i].hash == b->index[j].hash) {
+            i++, j++;
+            continue;
+        }
+        // Decode both sides (blank where one has no block) and compare cells
+        if (ka == block) {
+            if (!tm_snap_block(a, i)) break;
+            memcpy(other, a->cells, TM_SNAP_BLOCK);
+        } else {
+            memset(other, 0, TM_SNAP_BLOCK);
+        }
+        if (kb == block) {
+            if (!tm_snap_block(b, j)) break;
+        } else {
+            memset(b->cells, 0, TM_SNAP_BLOCK);
+            b->cached = INT64_MIN;
+        }
+        int c = 0;
+        while (c < TM_SNAP_BLOCK && other[c] == b->cells[c]) c++;
+        if (c < TM_SNAP_BLOCK) {
+            if (!differ) *first = block * TM_SNAP_BLOCK + c;
+            differ++;
+        }
+        i += ka == block;
+        j += kb == block;
+    }
+    free(other);
+    return i < a->num_blocks || j < b->num_blocks ? -1 : differ; // Stopped early on a malformed block
+}
+
+#endif